@@ -1,3 +1,4 @@
+import numpy as np
 import yaml
 from pandas import DataFrame
 from pandas import Series
@@ -5,6 +6,45 @@ from pandas import Series
 
 LOG_COLUMNS = ['timestamp', 'level', 'source', 'function', 'data']
 
+SYSCLK_FREQUENCY_HZ = 72000000
+
+# Telemetry frames (see `src/telemetry.h`)
+TELEMETRY_SYNC = 0xa5
+TELEMETRY_HEADER_SIZE = 7
+TELEMETRY_CRC_SIZE = 2
+TELEMETRY_RECORDS = {
+    1: ('control', [
+        ('encoder_left', '<u2'),
+        ('encoder_right', '<u2'),
+        ('gyro_z_raw', '<i2'),
+        ('power_left', '<i2'),
+        ('power_right', '<i2'),
+    ]),
+    2: ('sensors', [
+        ('side_left', '<u2'),
+        ('side_right', '<u2'),
+        ('front_left', '<u2'),
+        ('front_right', '<u2'),
+    ]),
+}
+# Recorder frames, with a batch of control records each
+TELEMETRY_RECORDER = 3
+TELEMETRY_RECORDS_PER_FRAME = 16
+TELEMETRY_RECORDER_FIELDS = [
+    ('first', '<u4'),
+    ('count', '<u2'),
+    ('frequency', '<u2'),
+    ('records', TELEMETRY_RECORDS[1][1], TELEMETRY_RECORDS_PER_FRAME),
+]
+# Fixed point fields scale (distances have 16 fractional bits)
+TELEMETRY_SCALES = {
+    'sensors': 1 / 2 ** 16,
+}
+CRC16_TABLE = np.array([
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+], dtype=np.uint16)
+
 
 def log_as_dataframe(log):
     """
@@ -38,3 +78,153 @@ def filter_dataframe(df, dictionary):
     for key, value in dictionary.items():
         df = df[df[key] == value]
     return df
+
+
+def telemetry_crc(frames):
+    """
+    Calculate the CRC-16/CCITT-FALSE of each row of a 2D `uint8` array.
+
+    All rows are processed at once, one column at a time.
+    """
+    crc = np.full(len(frames), 0xffff, dtype=np.uint16)
+    for column in frames.T:
+        for nibble in (column >> 4, column & 0x0f):
+            crc = (crc << 4) ^ CRC16_TABLE[(crc >> 12) ^ nibble]
+    return crc
+
+
+def telemetry_frames(buffer, record_type, fields=None):
+    """
+    Find all the valid frames of a record type in a `uint8` array.
+
+    The payload `fields` default to the ones in `TELEMETRY_RECORDS`.
+
+    Return the frames positions in the buffer and the frames, as a 2D array.
+    Candidate frames with a wrong CRC are discarded.
+    """
+    if fields is None:
+        fields = TELEMETRY_RECORDS[record_type][1]
+    payload = np.dtype(fields).itemsize
+    size = TELEMETRY_HEADER_SIZE + payload + TELEMETRY_CRC_SIZE
+    n = max(len(buffer) - size + 1, 0)
+    starts = np.flatnonzero((buffer[:n] == TELEMETRY_SYNC) &
+                            (buffer[1:n + 1] == record_type) &
+                            (buffer[2:n + 2] == payload))
+    frames = buffer[starts[:, None] + np.arange(size)]
+    crc = frames[:, -2].astype(np.uint16) | \
+        (frames[:, -1].astype(np.uint16) << 8)
+    valid = telemetry_crc(frames[:, 1:-2]) == crc
+    return starts[valid], frames[valid]
+
+
+def unwrap_cycles(cycles):
+    """
+    Convert wrapping 32 bits clock cycle counters, in stream order, into
+    seconds elapsed since the first one.
+    """
+    if not len(cycles):
+        return np.empty(0)
+    elapsed = np.diff(cycles.astype(np.int64)) % 2 ** 32
+    return np.concatenate([[0], np.cumsum(elapsed)]) / SYSCLK_FREQUENCY_HZ
+
+
+def decode_telemetry(data):
+    """
+    Decode a binary telemetry stream into a DataFrame for each record type.
+
+    Timestamps are converted to seconds since the first valid frame in the
+    stream, whatever its type.
+    """
+    buffer = np.frombuffer(bytes(data), dtype=np.uint8)
+    found = {key: telemetry_frames(buffer, key) for key in TELEMETRY_RECORDS}
+    starts = np.concatenate([x[0] for x in found.values()])
+    frames = [x[1] for x in found.values()]
+    cycles = np.concatenate([
+        np.ascontiguousarray(x[:, 3:7]).view('<u4').ravel() for x in frames])
+    order = np.argsort(starts, kind='stable')
+    timestamps = np.empty(len(starts))
+    timestamps[order] = unwrap_cycles(cycles[order])
+    offsets = np.cumsum([0] + [len(x) for x in frames])
+    result = {}
+    for i, (name, fields) in enumerate(TELEMETRY_RECORDS.values()):
+        payload = np.ascontiguousarray(frames[i][:, 7:-2])
+        df = DataFrame(payload.view(np.dtype(fields)).ravel())
+        df = df * TELEMETRY_SCALES.get(name, 1)
+        df.index = timestamps[offsets[i]:offsets[i + 1]]
+        df.index.name = 'timestamp'
+        result[name] = df
+    result['recorder'] = decode_recorder(buffer)
+    return result
+
+
+def decode_recorder(buffer):
+    """
+    Reconstruct the full rate control trace from the last recorder dump in a
+    `uint8` array.
+
+    A dump starts when the index of the first record in a frame does not
+    increase. The result has a row for each control loop iteration in the
+    dump, indexed by the seconds since the recorder started. Records lost
+    (i.e.: frames with a wrong CRC) are left as `NaN`.
+    """
+    fields = TELEMETRY_RECORDS[1][1]
+    _, frames = telemetry_frames(buffer, TELEMETRY_RECORDER,
+                                 TELEMETRY_RECORDER_FIELDS)
+    payloads = np.ascontiguousarray(frames[:, 7:-2])
+    decoded = payloads.view(np.dtype(TELEMETRY_RECORDER_FIELDS)).ravel()
+    restarts = np.flatnonzero(np.diff(decoded['first'].astype(np.int64)) <= 0)
+    if len(restarts):
+        decoded = decoded[restarts[-1] + 1:]
+    if not len(decoded):
+        df = DataFrame(np.empty(0, dtype=np.dtype(fields)))
+        df.index.name = 'timestamp'
+        return df
+    ticks = np.concatenate([frame['first'] + np.arange(frame['count'])
+                            for frame in decoded])
+    records = np.concatenate([frame['records'][:frame['count']]
+                              for frame in decoded])
+    df = DataFrame(records, index=ticks)
+    df = df.reindex(np.arange(ticks[0], ticks[-1] + 1))
+    df.index = df.index / decoded['frequency'][-1]
+    df.index.name = 'timestamp'
+    return df
+
+
+def next_chunk_size(buffer, start):
+    """
+    Return the size of the next complete telemetry frame or text line in the
+    buffer, or `0` if it is incomplete.
+    """
+    if buffer[start] != TELEMETRY_SYNC:
+        end = buffer.find(b'\n', start)
+        return end + 1 - start if end >= 0 else 0
+    if len(buffer) - start < TELEMETRY_HEADER_SIZE:
+        return 0
+    size = TELEMETRY_HEADER_SIZE + buffer[start + 2] + TELEMETRY_CRC_SIZE
+    return size if len(buffer) - start >= size else 0
+
+
+def split_stream(buffer):
+    """
+    Split a received byte stream into text log lines and telemetry frames.
+
+    Telemetry frames always start with `TELEMETRY_SYNC`, which never starts a
+    text log line.
+
+    Return the list of text lines (without the line break), the telemetry
+    frames bytes and the remaining (incomplete) bytes.
+    """
+    lines = []
+    telemetry = bytearray()
+    start = 0
+    while start < len(buffer):
+        size = next_chunk_size(buffer, start)
+        if not size:
+            break
+        chunk = buffer[start:start + size]
+        if chunk[0] == TELEMETRY_SYNC:
+            telemetry += chunk
+        else:
+            lines.append(chunk[:-1])
+        start += size
+    return lines, bytes(telemetry), buffer[start:]
@@ -21,9 +21,16 @@ from osbrain import (
     run_nameserver,
 )
 
+from analysis import decode_telemetry
 from analysis import explode_yaml_series
 from analysis import filter_dataframe
 from analysis import log_as_dataframe
+from analysis import split_stream
+from setpoints import load_commands
+from setpoints import read_trajectory
+from tuning import expand_grid
+from tuning import rank
+from tuning import variant_command
 
 
 matplotlib.interactive(True)
@@ -67,6 +74,7 @@ def plot_top_bottom(df, top, bottom, title=''):
 class Proxy(Agent):
     def on_init(self):
         self.log = []
+        self.telemetry = bytearray()
         self.buffer = b''
         self.log_filter = None
         self.filtered = None
@@ -111,10 +119,9 @@ class Proxy(Agent):
 
     def process_received(self, received):
         self.buffer += received
-        if b'\n' not in self.buffer:
-            return 0
-        splits = self.buffer.split(b'\n')
-        for message in splits[:-1]:
+        splits, telemetry, self.buffer = split_stream(self.buffer)
+        self.telemetry += telemetry
+        for message in splits:
             fields = message.split(b',')
             log = [x.decode('utf-8') for x in fields[:4]]
             try:
@@ -134,8 +141,7 @@ class Proxy(Agent):
                 self.log_filter = None
             self.log.append(log)
             self.publish(log)
-        self.buffer = splits[-1]
-        return len(splits) - 1
+        return len(splits)
 
     def send_bt(self, message):
         for retry in range(3):
@@ -187,6 +193,113 @@ class Proxy(Agent):
             return 0.
         return float(result[-1])
 
+    def get_profile(self, timeout=0.5):
+        """Get the SysTick handler profiling statistics."""
+        start = len(self.log)
+        self.send_bt('profile\0')
+        t0 = time.time()
+        while time.time() - t0 < timeout:
+            self.receive()
+        return [json.loads(log[-1]) for log in self.log[start:]
+                if log[3] == 'log_profiler']
+
+    def get_telemetry(self):
+        """Get the decoded telemetry records, a DataFrame for each type."""
+        return decode_telemetry(self.telemetry)
+
+    def get_serial_statistics(self, timeout=0.5):
+        """Get the serial transmission statistics."""
+        self.filter_next(function='log_serial_statistics')
+        self.send_bt('serial\0')
+        result = self.wait_filtered(timeout=timeout)
+        if result is None:
+            return {}
+        return json.loads(result[-1])
+
+    def get_tuning_variants(self):
+        """Get the number of variants queued in the tuning session."""
+        self.filter_next(function='log_tuning_variants')
+        self.send_bt('tuning\0')
+        result = self.wait_filtered()
+        if result is None:
+            return 0
+        return json.loads(result[-1])['variants']
+
+    def load_tuning_variants(self, commands, timeout=1.):
+        """
+        Clear the tuning session and queue the variants, waiting for each one
+        to be acknowledged before sending the next one. The load only succeeds
+        if all the variants are queued after the last one.
+        """
+        result = None
+        for command in ['tuning clear'] + commands:
+            self.filter_next(function='log_tuning_variants')
+            self.send_bt(command + '\0')
+            result = self.wait_filtered(timeout=timeout)
+            if result is None:
+                return False
+        return json.loads(result[-1])['variants'] == len(commands)
+
+    def get_tuning_results(self, count, timeout):
+        """Wait for the tuning session summary rows."""
+        start = len(self.log)
+        t0 = time.time()
+        rows = []
+        while len(rows) < count and time.time() - t0 < timeout:
+            self.receive()
+            rows = [json.loads(log[-1]) for log in self.log[start:]
+                    if log[3] == 'log_tuning_result']
+        return rows
+
+    def get_trajectory_results(self, timeout):
+        """Wait for the trajectory playback tracking errors."""
+        start = len(self.log)
+        t0 = time.time()
+        while time.time() - t0 < timeout:
+            self.receive()
+            functions = [log[3] for log in self.log[start:]]
+            if 'log_trajectory_result' in functions:
+                break
+        return [json.loads(log[-1]) for log in self.log[start:]
+                if log[3] in ('log_trajectory_tracking',
+                              'log_trajectory_result')]
+
+    def load_trajectory(self, commands, timeout=1.):
+        """
+        Clear the trajectory and load it, waiting for each chunk to be
+        acknowledged before sending the next one. The load only succeeds if
+        no setpoints are missing after the last chunk.
+        """
+        result = None
+        for command in ['trajectory clear'] + commands:
+            self.filter_next(function='log_trajectory_length')
+            self.send_bt(command + '\0')
+            result = self.wait_filtered(timeout=timeout)
+            if result is None:
+                return False
+        return json.loads(result[-1])['missing'] == 0
+
+    def get_sensors_schedule(self, schedule=None):
+        """Get (or set) the sensors schedule."""
+        self.filter_next(function='log_sensors_schedule')
+        if schedule:
+            self.send_bt('sensors schedule %s\0' % schedule)
+        else:
+            self.send_bt('sensors schedule\0')
+        result = self.wait_filtered()
+        if result is None:
+            return {}
+        return json.loads(result[-1])
+
+    def get_sensors_walls(self):
+        """Get the walls detected, as (present, confidence, samples)."""
+        self.filter_next(function='log_sensors_walls')
+        self.send_bt('sensors walls\0')
+        result = self.wait_filtered()
+        if result is None:
+            return {}
+        return json.loads(result[-1])
+
     def get_configuration_variables(self):
         self.filter_next(function='log_configuration_variables')
         self.send_bt('configuration_variables\0')
@@ -199,6 +312,11 @@ class Proxy(Agent):
 class Bulebule(cmd.Cmd):
     prompt = '>>> '
     LOG_SUBCOMMANDS = ['all', 'clear', 'save']
+    TELEMETRY_SUBCOMMANDS = ['on', 'off', 'dump', 'clear', 'save']
+    TUNING_SUBCOMMANDS = ['grid', 'run', 'clear']
+    TRAJECTORY_SUBCOMMANDS = ['load', 'run', 'clear']
+    SENSORS_SUBCOMMANDS = ['walls', 'schedule']
+    SCHEDULE_SUBCOMMANDS = ['all', 'side', 'front', 'auto']
     PLOT_SUBCOMMANDS = ['linear_speed_profile', 'angular_speed_profile']
     MOVE_SUBCOMMANDS = list('OFLRBMHElrbskj')
     RUN_SUBCOMMANDS = [
@@ -255,6 +373,114 @@ class Bulebule(cmd.Cmd):
         """Get configuration variables."""
         pprint(self.proxy.get_configuration_variables())
 
+    def do_profile(self, extra):
+        """Get (or reset) the SysTick handler profiling statistics."""
+        if extra == 'reset':
+            self.proxy.send_bt('profile reset\0')
+        else:
+            pprint(self.proxy.get_profile())
+
+    def do_serial(self, extra):
+        """Get (or reset) the serial transmission statistics."""
+        if extra == 'reset':
+            self.proxy.send_bt('serial reset\0')
+        else:
+            pprint(self.proxy.get_serial_statistics())
+
+    def do_telemetry(self, extra):
+        """Start, stop, dump, clear, save or summarize the binary telemetry."""
+        if extra in ('on', 'off', 'dump'):
+            self.proxy.send_bt('telemetry %s\0' % extra)
+        elif extra == 'clear':
+            self.proxy.set_attr(telemetry=bytearray())
+        elif extra == 'save':
+            fname = 'telemetry.pkl'
+            pickle.dump(self.proxy.get_telemetry(), open(fname, 'wb'))
+            print('Saved telemetry as "%s".' % fname)
+        else:
+            for name, df in self.proxy.get_telemetry().items():
+                print('%s: %d records' % (name, len(df)))
+
+    def complete_telemetry(self, text, line, begidx, endidx):
+        return complete_subcommands(text, self.TELEMETRY_SUBCOMMANDS)
+
+    def do_sensors(self, extra):
+        """Get the walls detected, or get (or set) the sensors schedule."""
+        args = extra.split()
+        if args == ['walls']:
+            pprint(self.proxy.get_sensors_walls())
+        elif args[:1] == ['schedule'] and len(args) <= 2:
+            schedule = args[1] if len(args) == 2 else None
+            if schedule and schedule not in self.SCHEDULE_SUBCOMMANDS:
+                print('Invalid schedule "%s"!' % schedule)
+                return
+            pprint(self.proxy.get_sensors_schedule(schedule))
+        else:
+            print('Invalid sensors command "%s"!' % extra)
+
+    def complete_sensors(self, text, line, begidx, endidx):
+        if line.split()[1:2] == ['schedule']:
+            return complete_subcommands(text, self.SCHEDULE_SUBCOMMANDS)
+        return complete_subcommands(text, self.SENSORS_SUBCOMMANDS)
+
+    def do_settings(self, extra):
+        """Save (or erase) the current settings in the robot flash."""
+        if extra in ('save', 'erase'):
+            self.proxy.send_bt('settings %s\0' % extra)
+        else:
+            print('Invalid settings command "%s"!' % extra)
+
+    def do_tuning(self, extra):
+        """Queue a grid of variants, or run them and rank the results."""
+        command, _, arguments = extra.partition(' ')
+        if command == 'grid':
+            try:
+                variants = expand_grid(arguments)
+            except ValueError as error:
+                print(error)
+                return
+            commands = [variant_command(variant) for variant in variants]
+            if not self.proxy.load_tuning_variants(commands):
+                print('Tuning variant not acknowledged, grid aborted')
+                return
+            print('Queued %d variants.' % len(variants))
+        elif command == 'run' and arguments.isdigit():
+            count = self.proxy.get_tuning_variants()
+            self.proxy.send_bt('tuning run %s\0' % arguments)
+            rows = self.proxy.get_tuning_results(count, timeout=60. * count)
+            for row in rank(rows):
+                print(row)
+        elif command == 'clear':
+            self.proxy.send_bt('tuning clear\0')
+        else:
+            print('Invalid tuning command "%s"!' % extra)
+
+    def complete_tuning(self, text, line, begidx, endidx):
+        return complete_subcommands(text, self.TUNING_SUBCOMMANDS)
+
+    def do_trajectory(self, extra):
+        """Load a trajectory from a CSV file, play it back or clear it."""
+        command, _, arguments = extra.partition(' ')
+        if command == 'load':
+            try:
+                commands = load_commands(*read_trajectory(arguments))
+            except (OSError, KeyError, ValueError) as error:
+                print(error)
+                return
+            if not self.proxy.load_trajectory(commands):
+                print('Trajectory chunk not acknowledged, load aborted')
+        elif command == 'run':
+            self.proxy.send_bt('trajectory run\0')
+            for row in self.proxy.get_trajectory_results(timeout=60.):
+                print(row)
+        elif command == 'clear':
+            self.proxy.send_bt('trajectory clear\0')
+        else:
+            print('Invalid trajectory command "%s"!' % extra)
+
+    def complete_trajectory(self, text, line, begidx, endidx):
+        return complete_subcommands(text, self.TRAJECTORY_SUBCOMMANDS)
+
     def do_set(self, line):
         """Set robot variables."""
         if any(line.startswith(x) for x in self.SET_SUBCOMMANDS):
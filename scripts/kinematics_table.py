@@ -0,0 +1,205 @@
+"""
+Generate the speed and turn profiles tables as a C header.
+
+Profiles are generated for a fixed set of force levels, the same ones the
+user can select at configuration time (see `hmi_configure_force()`):
+
+- Linear profiles: trapezoidal acceleration and deceleration, with the
+  braking factor (`1 / (2 * deceleration)`) to get braking distances with a
+  single multiplication.
+- Turn profiles: slalom turns as modelled in `scripts/notebooks/trajectory.py`
+  (sinusoidal transitions and constant angular velocity arc), with their
+  durations in control loop ticks.
+
+A quarter sine wave table is shared by all turn transitions.
+"""
+import argparse
+import math
+
+from log_table import write_if_changed
+from move_costs import CELL
+from move_costs import MASS
+from move_costs import MAX_ANGULAR_VELOCITY
+from move_costs import MOMENT_OF_INERTIA
+from move_costs import TURNS
+from move_costs import WHEELS_SEPARATION
+from move_costs import turn_speed
+
+
+SINE_SIZE = 129
+
+# Slalom turns radius, small enough for the 90-degree turn to fit in a cell
+RADIUS = 0.06
+
+
+HEADER = """\
+/* Generated by `scripts/kinematics_table.py`, do not edit */
+#ifndef __KINEMATICS_TABLE_H
+#define __KINEMATICS_TABLE_H
+
+#define KINEMATICS_TABLE_FREQUENCY_HZ {frequency}
+#define KINEMATICS_FORCE_MIN {force_min}
+#define KINEMATICS_FORCE_STEP {force_step}
+#define KINEMATICS_FORCE_LEVELS {levels}
+#define KINEMATICS_SINE_SIZE {sine_size}
+
+/** Quarter sine wave, from 0 to PI / 2 */
+static const float kinematics_sine[KINEMATICS_SINE_SIZE] = {{
+{sine}}};
+
+/** Linear profiles by force level */
+static const struct linear_profile
+    linear_profiles[KINEMATICS_FORCE_LEVELS] = {{
+{linear}}};
+
+/** Turn profiles by force level and turn angle */
+static const struct turn_profile
+    turn_profiles[KINEMATICS_FORCE_LEVELS][TURN_ANGLES] = {{
+{turns}}};
+
+#endif /* __KINEMATICS_TABLE_H */
+"""
+
+
+def force_levels(force_min, force_step, levels):
+    return [force_min + i * force_step for i in range(levels)]
+
+
+def linear_profile(force):
+    """
+    Return the linear acceleration, deceleration and braking factor with the
+    given force applied on each wheel.
+    """
+    acceleration = 2 * force / MASS
+    return {
+        'acceleration': acceleration,
+        'deceleration': acceleration,
+        'braking_factor': 1 / (2 * acceleration),
+    }
+
+
+def turn_displacement(profile, frequency):
+    """
+    Integrate a turn profile, tick by tick, as the control loop follows it.
+
+    Return the forward and lateral displacements, in meters.
+    """
+    transition = profile['transition_ticks']
+    end = 2 * transition + profile['arc_ticks']
+    angle = x = y = 0.
+    for tick in range(end):
+        phase = min(tick, end - tick, transition)
+        angular_velocity = profile['max_angular_velocity'] * \
+            math.sin(phase / transition * math.pi / 2)
+        x += profile['linear_velocity'] * math.cos(angle) / frequency
+        y += profile['linear_velocity'] * math.sin(angle) / frequency
+        angle += angular_velocity / frequency
+    return x, y
+
+
+def turn_profile(angle, force, radius, frequency):
+    """
+    Return the slalom turn linear and maximum angular velocities, with the
+    transition and arc durations in ticks, as in `turn_profile()`.
+
+    Turns too short to reach the maximum angular velocity are limited as in
+    `Simulator.inplace()`, reducing the linear velocity to keep the radius.
+
+    For 90-degree turns, also return the straight distances to travel before
+    and after the turn to go from one cell border to the next.
+    """
+    linear_velocity = turn_speed(radius, force)
+    max_angular_acceleration = force * WHEELS_SEPARATION / MOMENT_OF_INERTIA
+    max_angular_velocity = min(linear_velocity / radius, MAX_ANGULAR_VELOCITY,
+                               math.sqrt(math.radians(angle) / 2 *
+                                         max_angular_acceleration))
+    linear_velocity = min(linear_velocity, max_angular_velocity * radius)
+    transition = max_angular_velocity / max_angular_acceleration * math.pi / 2
+    transition_angle = 2 * transition * max_angular_velocity / math.pi
+    arc = (math.radians(angle) - 2 * transition_angle) / max_angular_velocity
+    profile = {
+        'linear_velocity': linear_velocity,
+        'max_angular_velocity': max_angular_velocity,
+        'transition_ticks': max(round(transition * frequency), 1),
+        'arc_ticks': max(round(arc * frequency), 0),
+        'before': 0.,
+        'after': 0.,
+    }
+    if angle == 90:
+        x, y = turn_displacement(profile, frequency)
+        profile['before'] = CELL / 2 - x
+        profile['after'] = CELL / 2 - y
+        if min(profile['before'], profile['after']) < 0:
+            raise ValueError('Turn radius too big for the cell')
+    return profile
+
+
+def sine_table(size=SINE_SIZE):
+    return [math.sin(i / (size - 1) * math.pi / 2) for i in range(size)]
+
+
+def format_floats(values, indent=4, per_line=6):
+    """
+    Format floats as a C initializer list.
+    """
+    items = ['%.6f' % value for value in values]
+    lines = []
+    for i in range(0, len(items), per_line):
+        lines.append(' ' * indent + ', '.join(items[i:i + per_line]) + ',')
+    lines[-1] = lines[-1].rstrip(',')
+    return '\n'.join(lines)
+
+
+def format_linear(profile):
+    return '    {{{acceleration:.6f}, {deceleration:.6f}, ' \
+        '{braking_factor:.6f}}}'.format(**profile)
+
+
+def format_turn(profile):
+    return '{{{linear_velocity:.6f}, {max_angular_velocity:.6f}, ' \
+        '{transition_ticks}, {arc_ticks}, {before:.6f}, ' \
+        '{after:.6f}}}'.format(**profile)
+
+
+def generate(force_min, force_step, levels, radius, frequency):
+    """
+    Return the C header contents.
+    """
+    forces = force_levels(force_min, force_step, levels)
+    linear = [format_linear(linear_profile(force)) for force in forces]
+    turns = []
+    for force in forces:
+        profiles = [format_turn(turn_profile(angle, force, radius, frequency))
+                    for angle in TURNS]
+        turns.append('    {\n        ' + ',\n        '.join(profiles) +
+                     '}')
+    return HEADER.format(
+        frequency=frequency,
+        force_min=force_min,
+        force_step=force_step,
+        levels=levels,
+        sine_size=SINE_SIZE,
+        sine=format_floats(sine_table()),
+        linear=',\n'.join(linear),
+        turns=',\n'.join(turns))
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--force-min', type=float, default=0.1,
+                        help='Lowest force level, in newtons')
+    parser.add_argument('--force-step', type=float, default=0.05,
+                        help='Force step between levels, in newtons')
+    parser.add_argument('--force-levels', type=int, default=9)
+    parser.add_argument('--radius', type=float, default=RADIUS,
+                        help='Slalom turns radius, in meters')
+    parser.add_argument('--frequency', type=int, default=1000,
+                        help='Control loop frequency, in hertz')
+    parser.add_argument('--output', help='Output file (default: stdout)')
+    args = parser.parse_args()
+    header = generate(args.force_min, args.force_step, args.force_levels,
+                      args.radius, args.frequency)
+    if args.output:
+        write_if_changed(args.output, header)
+    else:
+        print(header, end='')
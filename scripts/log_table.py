@@ -0,0 +1,122 @@
+"""
+Generate the sensors log conversion table as a C header.
+
+The table stores `log(x)` in fixed point (`uint16_t`) for `x` values from `0`
+to `ADC_RESOLUTION` in steps of size `step`. The firmware linearly
+interpolates between consecutive entries.
+"""
+import argparse
+import math
+import os
+
+
+ADC_RESOLUTION = 4096
+Q = 12
+
+
+HEADER = """\
+/* Generated by `scripts/log_table.py`, do not edit */
+#ifndef __LOG_TABLE_H
+#define __LOG_TABLE_H
+
+#include <stdint.h>
+
+#define LOG_TABLE_STEP {step}
+#define LOG_TABLE_SIZE {size}
+#define LOG_TABLE_Q {q}
+
+static const uint16_t log_table[LOG_TABLE_SIZE] = {{
+{values}}};
+
+#endif /* __LOG_TABLE_H */
+"""
+
+
+def log_table(step, q=Q):
+    """
+    Return the list of fixed point log values, one for each step.
+
+    The first entry, which would be `log(0)`, is set to `log(step)`. The
+    firmware enforces a minimum difference of `step` anyway.
+    """
+    if step < 1 or ADC_RESOLUTION % step:
+        raise ValueError('Step must be a divisor of %s' % ADC_RESOLUTION)
+    size = ADC_RESOLUTION // step + 1
+    return [round(math.log(max(i * step, step)) * (1 << q))
+            for i in range(size)]
+
+
+def interpolate(table, step, diff):
+    """
+    Interpolate the table as the firmware does, with integer arithmetic.
+    """
+    diff = max(diff, step)
+    index, fraction = divmod(diff, step)
+    low = table[index]
+    high = table[index + 1] if fraction else low
+    return low + (high - low) * fraction // step
+
+
+def accuracy(step, q=Q):
+    """
+    Return the maximum and mean absolute errors of the interpolated table
+    compared to `log()`, for all valid differences.
+    """
+    table = log_table(step, q)
+    errors = [abs(interpolate(table, step, diff) / (1 << q) - math.log(diff))
+              for diff in range(step, ADC_RESOLUTION)]
+    return max(errors), sum(errors) / len(errors)
+
+
+def format_values(values, width=80, indent=4):
+    """
+    Format values as a C initializer list, wrapped at `width` columns.
+    """
+    items = ['%d,' % value for value in values]
+    items[-1] = items[-1].rstrip(',')
+    column = max(len(item) for item in items) + 1
+    per_line = (width - indent) // column
+    lines = []
+    for i in range(0, len(items), per_line):
+        chunk = items[i:i + per_line]
+        line = ' '.join(item.ljust(column - 1) for item in chunk[:-1])
+        lines.append(' ' * indent + (line + ' ' + chunk[-1]).strip())
+    return '\n'.join(lines)
+
+
+def generate(step, q=Q):
+    """
+    Return the C header contents.
+    """
+    values = log_table(step, q)
+    return HEADER.format(step=step, size=len(values), q=q,
+                         values=format_values(values))
+
+
+def write_if_changed(fname, contents):
+    """
+    Write the file only if the contents changed, to avoid rebuilds.
+    """
+    if os.path.exists(fname):
+        with open(fname) as f:
+            if f.read() == contents:
+                return
+    with open(fname, 'w') as f:
+        f.write(contents)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--step', type=int, default=8)
+    parser.add_argument('--output', help='Output file (default: stdout)')
+    parser.add_argument('--accuracy', action='store_true',
+                        help='Print the table accuracy compared to log()')
+    args = parser.parse_args()
+    if args.accuracy:
+        max_error, mean_error = accuracy(args.step)
+        print('Step %d (%d bytes): max error %.6f, mean error %.6f' % (
+            args.step, 2 * len(log_table(args.step)), max_error, mean_error))
+    elif args.output:
+        write_if_changed(args.output, generate(args.step))
+    else:
+        print(generate(args.step), end='')
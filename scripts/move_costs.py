@@ -0,0 +1,183 @@
+"""
+Generate the run planner move costs as a C header.
+
+Costs are traversal times, in milliseconds, of each kind of move:
+
+- Straights of any length, in cells, accelerating up to the speed limit and
+  braking back to the turn speed.
+- Diagonals of any length, in half diagonals (`CELL_DIAGONAL`), with the same
+  profile as straights.
+- Slalom turns of 45, 90, 135 and 180 degrees at the turn speed, modelled as
+  in `scripts/notebooks/trajectory.py`. The nominal distance of the turn which
+  is not covered by the slalom itself is traversed at the turn speed.
+
+The planner adds the costs of consecutive moves, so all moves start and end
+at the turn speed.
+"""
+import argparse
+import math
+
+from log_table import format_values
+from log_table import write_if_changed
+
+
+CELL = 0.18
+CELL_DIAGONAL = 0.1273
+MASS = 0.11
+MOMENT_OF_INERTIA = 0.000125
+WHEELS_SEPARATION = 0.065
+MAX_ANGULAR_VELOCITY = 20.
+LINEAR_SPEED_LIMIT = 2.
+
+# Nominal distance, following the cells centerline, of each turn
+TURNS = {
+    45: CELL / 2 + CELL_DIAGONAL / 2,
+    90: CELL,
+    135: CELL + CELL_DIAGONAL / 2,
+    180: 2 * CELL,
+}
+
+
+HEADER = """\
+/* Generated by `scripts/move_costs.py`, do not edit */
+#ifndef __MOVE_COSTS_H
+#define __MOVE_COSTS_H
+
+#include <stdint.h>
+
+#define MOVE_COSTS_MAZE_SIZE {maze_size}
+#define MOVE_COSTS_STRAIGHT_SIZE {straight_size}
+#define MOVE_COSTS_DIAGONAL_SIZE {diagonal_size}
+
+/** Turn speed, in millimeters per second */
+#define MOVE_COSTS_TURN_SPEED {turn_speed}
+
+/** Slalom turns traversal time, in milliseconds */
+{turns}
+
+/** Straight traversal time by number of cells, in milliseconds */
+static const uint16_t move_costs_straight[MOVE_COSTS_STRAIGHT_SIZE] = {{
+{straight}}};
+
+/** Diagonal traversal time by number of half diagonals, in milliseconds */
+static const uint16_t move_costs_diagonal[MOVE_COSTS_DIAGONAL_SIZE] = {{
+{diagonal}}};
+
+#endif /* __MOVE_COSTS_H */
+"""
+
+
+def turn_speed(radius, force):
+    """
+    Return the linear speed of a slalom turn with the given radius and
+    maximum lateral force.
+    """
+    return math.sqrt(2 * force * radius / MASS)
+
+
+def turn_time(angle, radius, force):
+    """
+    Return the time, in seconds, to complete a slalom turn.
+
+    The angular velocity follows the same profile as `turn_profile()`: a
+    sinusoidal transition, a constant velocity arc and a sinusoidal
+    transition back to zero.
+    """
+    speed = turn_speed(radius, force)
+    max_angular_velocity = min(speed / radius, MAX_ANGULAR_VELOCITY)
+    max_angular_acceleration = force * WHEELS_SEPARATION / MOMENT_OF_INERTIA
+    duration = max_angular_velocity / max_angular_acceleration * math.pi
+    transition_angle = duration * max_angular_velocity / math.pi
+    arc = (math.radians(angle) - 2 * transition_angle) / max_angular_velocity
+    if arc < 0:
+        raise ValueError('Turn of %d degrees is too short' % angle)
+    return duration + arc
+
+
+def turn_cost(angle, radius, force):
+    """
+    Return the time, in seconds, to complete a turn move, including the part
+    of its nominal distance not covered by the slalom.
+    """
+    time = turn_time(angle, radius, force)
+    speed = turn_speed(radius, force)
+    remainder = max(TURNS[angle] - speed * time, 0.)
+    return time + remainder / speed
+
+
+def straight_time(distance, speed, acceleration, limit):
+    """
+    Return the time, in seconds, to travel a distance starting and ending at
+    the given speed, accelerating and braking up to the speed limit.
+    """
+    ramp = (limit ** 2 - speed ** 2) / acceleration
+    if distance >= ramp:
+        return 2 * (limit - speed) / acceleration + (distance - ramp) / limit
+    peak = math.sqrt(speed ** 2 + acceleration * distance)
+    return 2 * (peak - speed) / acceleration
+
+
+def milliseconds(seconds):
+    return round(seconds * 1000)
+
+
+def move_costs(maze_size, radius, force, acceleration, limit):
+    """
+    Return a dictionary with the straight, diagonal and turn costs, in
+    milliseconds.
+    """
+    speed = turn_speed(radius, force)
+    if speed > limit:
+        raise ValueError('Turn speed exceeds the speed limit')
+    return {
+        'straight': [milliseconds(straight_time(cells * CELL, speed,
+                                                acceleration, limit))
+                     for cells in range(maze_size)],
+        'diagonal': [milliseconds(straight_time(cells * CELL_DIAGONAL, speed,
+                                                acceleration, limit))
+                     for cells in range(2 * maze_size)],
+        'turns': {angle: milliseconds(turn_cost(angle, radius, force))
+                  for angle in TURNS},
+        'turn_speed': round(speed * 1000),
+    }
+
+
+def generate(maze_size, radius, force, acceleration, limit):
+    """
+    Return the C header contents.
+    """
+    costs = move_costs(maze_size, radius, force, acceleration, limit)
+    if max(max(costs['straight']), max(costs['diagonal'])) >= 2 ** 16:
+        raise ValueError('Costs must fit in an `uint16_t`')
+    turns = '\n'.join('#define MOVE_COSTS_TURN_%d %d' % (angle, cost)
+                      for angle, cost in costs['turns'].items())
+    return HEADER.format(
+        maze_size=maze_size,
+        straight_size=len(costs['straight']),
+        diagonal_size=len(costs['diagonal']),
+        turn_speed=costs['turn_speed'],
+        turns=turns,
+        straight=format_values(costs['straight']),
+        diagonal=format_values(costs['diagonal']))
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--maze-size', type=int, default=16)
+    parser.add_argument('--radius', type=float, default=CELL / 2,
+                        help='Slalom turns radius, in meters')
+    parser.add_argument('--force', type=float, default=0.25,
+                        help='Maximum force in turns, in newtons')
+    parser.add_argument('--acceleration', type=float, default=5.,
+                        help='Linear acceleration, in meters per second^2')
+    parser.add_argument('--speed-limit', type=float,
+                        default=LINEAR_SPEED_LIMIT,
+                        help='Linear speed limit, in meters per second')
+    parser.add_argument('--output', help='Output file (default: stdout)')
+    args = parser.parse_args()
+    header = generate(args.maze_size, args.radius, args.force,
+                      args.acceleration, args.speed_limit)
+    if args.output:
+        write_if_changed(args.output, header)
+    else:
+        print(header, end='')
@@ -0,0 +1,67 @@
+"""
+Encode host-computed trajectories for the robot to play back (see
+`src/trajectory.c`).
+
+A trajectory is a sequence of linear (m/s) and angular (rad/s) speeds, one
+per control loop iteration, like the turn profiles computed with
+`scripts/notebooks/trajectory.py`. Speeds are sent as fixed point
+`int16_t` values, in mm/s and mrad/s, with 4 lowercase hexadecimal digits
+each, in chunks of at most half the robot serial reception buffer:
+
+    trajectory load <index> <linear><angular><linear><angular>...
+
+Each chunk must be acknowledged before sending the next one, so the commands
+in flight never exceed the reception buffer.
+"""
+import csv
+
+
+# Same as `TRAJECTORY_SPEED_SCALE` and `TRAJECTORY_MAX_SETPOINTS`
+SPEED_SCALE = 1000
+MAX_SETPOINTS = 512
+
+# Same as `RECEIVE_BUFFER_SIZE`
+RECEIVE_BUFFER_SIZE = 256
+
+# Setpoints per command, so commands fit `RECEIVE_BUFFER_SIZE / 2`
+CHUNK = 13
+
+
+def encode_speed(speed):
+    """
+    Return the hexadecimal digits of a speed, in fixed point.
+    """
+    value = round(speed * SPEED_SCALE)
+    if not -2 ** 15 <= value < 2 ** 15:
+        raise ValueError('Speed %f out of range' % speed)
+    return '%04x' % (value & 0xffff)
+
+
+def load_commands(linear, angular, chunk=CHUNK):
+    """
+    Return the commands that load a trajectory in the robot.
+    """
+    if len(linear) != len(angular):
+        raise ValueError('Linear and angular speeds lengths differ')
+    if len(linear) > MAX_SETPOINTS:
+        raise ValueError('Too many setpoints (%d, maximum is %d)' %
+                         (len(linear), MAX_SETPOINTS))
+    digits = [encode_speed(v) + encode_speed(w)
+              for v, w in zip(linear, angular)]
+    return ['trajectory load %d %s' % (i, ''.join(digits[i:i + chunk]))
+            for i in range(0, len(digits), chunk)]
+
+
+def read_trajectory(path):
+    """
+    Read the linear and angular speeds from a CSV file, with a row for each
+    control loop iteration and `linear_velocity` and `angular_velocity`
+    columns (i.e.: a saved turn profile DataFrame).
+    """
+    linear = []
+    angular = []
+    with open(path, newline='') as trajectory:
+        for row in csv.DictReader(trajectory):
+            linear.append(float(row['linear_velocity']))
+            angular.append(float(row['angular_velocity']))
+    return linear, angular
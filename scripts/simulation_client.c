@@ -1,5 +1,6 @@
 #include "solve.h"
 #include "search.h"
+#include "state_frame.h"
 
 #include <assert.h>
 #include <stdbool.h>
@@ -10,7 +11,18 @@
 
 #include <zmq.h>
 
+#define MAZE_AREA (MAZE_SIZE * MAZE_SIZE)
+
+/** Maximum number of steps batched per state frame */
+#define MAX_BATCH 64
+
 static void *requester;
+static void *pusher;
+
+static struct state_frame frame;
+static uint8_t sent_distances[MAZE_AREA];
+static uint8_t sent_walls[MAZE_AREA];
+static uint8_t buffer[STATE_FRAME_SIZE(MAZE_AREA, MAX_BATCH)];
 
 static void wait_response()
 {
@@ -32,36 +44,56 @@ static char encoded_direction(void)
 	return 'X';
 }
 
+/**
+ * @brief Push the pending state frame, if any.
+ *
+ * PUSH sockets queue frames until the server reads them, so the client only
+ * blocks when the queue is full.
+ */
+static void flush_state(void)
+{
+	if (!frame.steps)
+		return;
+	zmq_send(pusher, frame.buffer, frame.length, 0);
+	state_frame_clear(&frame);
+}
+
+/**
+ * @brief Add the current state to the state frame.
+ *
+ * Only the cells changed since the previous step are sent, and the frame is
+ * pushed once it batches the configured number of steps (see
+ * `src/simulation/state_frame.c`).
+ */
 void send_state()
 {
-	char state[2 * (MAZE_SIZE * MAZE_SIZE + 1) + 4];
+	uint8_t distances[MAZE_AREA];
+	uint8_t walls[MAZE_AREA];
 	int x;
 
-	state[0] = 'S';
-	state[1] = search_position() % MAZE_SIZE;
-	state[2] = search_position() / MAZE_SIZE;
-	state[3] = encoded_direction();
-	state[4] = 'C';
-	for (x=0; x<MAZE_SIZE*MAZE_SIZE; x++) {
-		state[x + 5] =
-		    read_cell_distance_value(x);
+	for (x = 0; x < MAZE_AREA; x++) {
+		distances[x] = read_cell_distance_value(x);
+		walls[x] = read_cell_walls_value(x);
 	}
-	state[261] = 'C';
-	for (x=0; x<MAZE_SIZE*MAZE_SIZE; x++) {
-		state[x + 262] =
-		    read_cell_walls_value(x);
-	}
-
-	zmq_send(requester, state, 518, 0);
-	wait_response();
+	if (state_frame_add_step(&frame, search_position() % MAZE_SIZE,
+				 search_position() / MAZE_SIZE,
+				 encoded_direction(), distances, walls))
+		flush_state();
 }
 
+/**
+ * @brief Request the walls around the mouse.
+ *
+ * The only synchronous round trip, as the search needs the walls to go on.
+ * Pending states are pushed first, so the server sees them in order.
+ */
 struct walls_around read_walls(void)
 {
 	char walls[3] = { 0 };
 	char position_state[4];
 	struct walls_around walls_readings;
 
+	flush_state();
 	position_state[0] = 'W';
 	position_state[1] = search_position() % MAZE_SIZE;
 	position_state[2] = search_position() / MAZE_SIZE;
@@ -76,15 +108,29 @@ struct walls_around read_walls(void)
 	return walls_readings;
 }
 
-int main(void)
+/**
+ * Usage: `simulation_client [BATCH]`, with BATCH the number of steps per
+ * state frame (1 by default, up to 64).
+ *
+ * Wall requests go through a REQ socket on port 6574, state frames through a
+ * PUSH socket on port 6575.
+ */
+int main(int argc, char **argv)
 {
 	int rc;
+	int batch = argc > 1 ? atoi(argv[1]) : 1;
 	void *context = zmq_ctx_new();
-	char buffer[256];
+
+	assert(batch > 0 && batch <= MAX_BATCH);
+	state_frame_init(&frame, MAZE_SIZE, batch, sent_distances, sent_walls,
+			 buffer);
 
 	requester = zmq_socket(context, ZMQ_REQ);
 	rc = zmq_connect(requester, "tcp://127.0.0.1:6574");
 	assert(rc == 0);
+	pusher = zmq_socket(context, ZMQ_PUSH);
+	rc = zmq_connect(pusher, "tcp://127.0.0.1:6575");
+	assert(rc == 0);
 	zmq_send(requester, "reset", 5, 0);
 	wait_response();
 
@@ -96,6 +142,10 @@ int main(void)
 	set_target_goal();
 	set_distances();
 	send_state();
+	flush_state();
 
+	zmq_close(pusher);
+	zmq_close(requester);
+	zmq_ctx_destroy(context);
 	return 0;
 }
@@ -0,0 +1,138 @@
+"""
+Decode the simulation state frames (see `src/simulation/state_frame.c`).
+
+Frames start with a header:
+
+- Type: `K` for keyframes (the first step includes all the cells) or `D`.
+- Maze size, in cells per side.
+- Sequence number, as a little endian `uint16`.
+- Number of steps batched in the frame.
+
+Each step includes the mouse X, Y and direction, the number of changed cells
+as a little endian `uint16` and, for each changed cell, its index as a little
+endian `uint16`, its distance and its walls.
+
+Use `StateDecoder` to keep the maze state up to date from a sequence of
+frames, and to detect lost frames (i.e.: dropped by a PUB socket).
+"""
+import struct
+import sys
+
+
+HEADER = struct.Struct('<cBHB')
+STEP_HEADER = struct.Struct('<BBcH')
+CELL = struct.Struct('<HBB')
+
+
+def decode_step(frame, offset):
+    """
+    Decode the step starting at `offset`.
+
+    Return the step and the offset of the next one.
+    """
+    x, y, direction, changes = STEP_HEADER.unpack_from(frame, offset)
+    offset += STEP_HEADER.size
+    cells = [CELL.unpack_from(frame, offset + i * CELL.size)
+             for i in range(changes)]
+    step = {
+        'x': x,
+        'y': y,
+        'direction': direction.decode(),
+        'cells': cells,
+    }
+    return step, offset + changes * CELL.size
+
+
+def decode(frame):
+    """
+    Decode a frame.
+
+    Return the header as a dictionary, with the steps as a list of
+    dictionaries with the mouse position and direction and the changed cells
+    as `(index, distance, walls)` tuples.
+    """
+    try:
+        kind, maze_size, sequence, count = HEADER.unpack_from(frame)
+        offset = HEADER.size
+        steps = []
+        for i in range(count):
+            step, offset = decode_step(frame, offset)
+            steps.append(step)
+    except struct.error as error:
+        raise ValueError('Truncated frame') from error
+    if kind not in (b'K', b'D'):
+        raise ValueError('Unknown frame type %r' % kind)
+    if offset != len(frame):
+        raise ValueError('Frame size does not match its contents')
+    return {
+        'keyframe': kind == b'K',
+        'maze_size': maze_size,
+        'sequence': sequence,
+        'steps': steps,
+    }
+
+
+class StateDecoder:
+    """
+    Apply frames to the maze state.
+
+    Delta frames are ignored until the first keyframe, and again after a
+    lost frame, until the next keyframe.
+    """
+    def __init__(self):
+        self.maze_size = None
+        self.distances = None
+        self.walls = None
+        self.position = None
+        self.direction = None
+        self.synchronized = False
+        self.lost = 0
+        self._sequence = None
+
+    def _check_sequence(self, sequence):
+        """
+        Count the frames lost since the previous one, if any.
+        """
+        if self._sequence is not None:
+            lost = (sequence - self._sequence - 1) % 2 ** 16
+            if lost:
+                self.synchronized = False
+                self.lost += lost
+        self._sequence = sequence
+
+    def apply(self, frame):
+        """
+        Apply a frame and return the decoded frame.
+        """
+        decoded = decode(frame)
+        self._check_sequence(decoded['sequence'])
+        if decoded['keyframe']:
+            area = decoded['maze_size'] ** 2
+            self.maze_size = decoded['maze_size']
+            self.distances = [0] * area
+            self.walls = [0] * area
+            self.synchronized = True
+        if not self.synchronized:
+            return decoded
+        for step in decoded['steps']:
+            for index, distance, walls in step['cells']:
+                self.distances[index] = distance
+                self.walls[index] = walls
+            self.position = (step['x'], step['y'])
+            self.direction = step['direction']
+        return decoded
+
+
+if __name__ == '__main__':
+    import zmq
+
+    address = sys.argv[1] if len(sys.argv) > 1 else 'tcp://127.0.0.1:6574'
+    context = zmq.Context()
+    subscriber = context.socket(zmq.SUB)
+    subscriber.connect(address)
+    subscriber.setsockopt(zmq.SUBSCRIBE, b'')
+    decoder = StateDecoder()
+    while True:
+        decoded = decoder.apply(subscriber.recv())
+        print(decoded['sequence'], len(decoded['steps']), decoder.position,
+              decoder.direction, 'lost=%d' % decoder.lost)
@@ -1,10 +1,40 @@
+import struct
+
+import numpy as np
 from pandas import DataFrame
 from pandas import Series
 
+from analysis import decode_recorder
+from analysis import decode_telemetry
 from analysis import explode_yaml_series
 from analysis import filter_dataframe
 from analysis import log_as_dataframe
 from analysis import LOG_COLUMNS
+from analysis import split_stream
+from analysis import SYSCLK_FREQUENCY_HZ
+from analysis import telemetry_crc
+
+
+def crc16(data):
+    """
+    Bitwise CRC-16/CCITT-FALSE, as reference.
+    """
+    crc = 0xffff
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = (crc << 1) ^ 0x1021 if crc & 0x8000 else crc << 1
+            crc &= 0xffff
+    return crc
+
+
+def telemetry_frame(record_type, cycles, fmt, *values):
+    """
+    Build a telemetry frame as the firmware does.
+    """
+    payload = struct.pack(fmt, *values)
+    body = struct.pack('<BBI', record_type, len(payload), cycles) + payload
+    return b'\xa5' + body + struct.pack('<H', crc16(body))
 
 
 def test_log_as_dataframe_empty():
@@ -52,3 +82,125 @@ def test_filter_dataframe():
     # No results
     result = filter_dataframe(df, {'a': 1, 'b': 2, 'c': 1})
     assert len(result) == 0
+
+
+def corrupt(frame):
+    """
+    Flip all the bits of the last byte of a frame.
+    """
+    return frame[:-1] + bytes([frame[-1] ^ 0xff])
+
+
+def test_telemetry_crc():
+    """
+    Test the vectorised CRC with the standard check value.
+    """
+    frames = np.frombuffer(b'123456789' * 3, dtype=np.uint8).reshape(3, 9)
+    assert list(telemetry_crc(frames)) == [0x29b1] * 3
+    assert crc16(b'123456789') == 0x29b1
+
+
+def test_decode_telemetry():
+    """
+    Decode a stream with different record types and a corrupted frame.
+    """
+    period = SYSCLK_FREQUENCY_HZ // 1000
+    stream = b''.join([
+        telemetry_frame(1, 100, '<HHhhh', 1, 2, -3, 400, -400),
+        telemetry_frame(2, 100 + period, '<HHHH', 2 ** 15, 0, 2 ** 16 - 1,
+                        2 ** 14),
+        corrupt(telemetry_frame(1, 100 + 2 * period, '<HHhhh', 5, 6, 7, 8, 9)),
+        b'garbage',
+        telemetry_frame(1, 100 + 3 * period, '<HHhhh', 65535, 0, 0, 0, 0),
+    ])
+    result = decode_telemetry(stream)
+    control = result['control']
+    assert list(control.columns) == ['encoder_left', 'encoder_right',
+                                     'gyro_z_raw', 'power_left',
+                                     'power_right']
+    assert control.index.name == 'timestamp'
+    assert list(control.index) == [0., 0.003]
+    assert list(control.iloc[0]) == [1, 2, -3, 400, -400]
+    assert control['encoder_left'].iloc[1] == 65535
+    sensors = result['sensors']
+    assert list(sensors.index) == [0.001]
+    assert list(sensors.iloc[0]) == [0.5, 0., (2 ** 16 - 1) / 2 ** 16, 0.25]
+
+
+def test_decode_telemetry_wrap():
+    """
+    Clock cycle counters wrap around.
+    """
+    stream = telemetry_frame(2, 2 ** 32 - 36000, '<HHHH', 0, 0, 0, 0) + \
+        telemetry_frame(2, 36000, '<HHHH', 0, 0, 0, 0)
+    sensors = decode_telemetry(stream)['sensors']
+    assert list(sensors.index) == [0., 72000 / SYSCLK_FREQUENCY_HZ]
+
+
+def test_decode_telemetry_empty():
+    """
+    An empty stream results in empty DataFrames.
+    """
+    result = decode_telemetry(b'')
+    assert len(result['control']) == 0
+    assert len(result['sensors']) == 0
+
+
+def recorder_frame(first, records, frequency=1000):
+    """
+    Build a recorder frame, zero padded, as the firmware does.
+    """
+    padded = records + [(0, 0, 0, 0, 0)] * (16 - len(records))
+    values = [value for record in padded for value in record]
+    return telemetry_frame(3, 0, '<IHH' + 'HHhhh' * 16, first, len(records),
+                           frequency, *values)
+
+
+def test_decode_recorder():
+    """
+    Only the last dump is decoded, with a row per control loop iteration and
+    lost records left as `NaN`.
+    """
+    records = [(i, 2 * i, -i, 100 + i, -100 - i) for i in range(40)]
+    stream = b''.join([
+        recorder_frame(600, [(9, 9, 9, 9, 9)]),
+        recorder_frame(500, records[:16], frequency=2000),
+        corrupt(recorder_frame(516, records[16:32], frequency=2000)),
+        recorder_frame(532, records[32:], frequency=2000),
+    ])
+    buffer = np.frombuffer(stream, dtype=np.uint8)
+    recorder = decode_recorder(buffer)
+    assert list(recorder.columns) == ['encoder_left', 'encoder_right',
+                                      'gyro_z_raw', 'power_left',
+                                      'power_right']
+    assert recorder.index.name == 'timestamp'
+    assert len(recorder) == 40
+    assert recorder.index[0] == 0.25
+    assert recorder.index[1] - recorder.index[0] == 1 / 2000
+    assert list(recorder.iloc[1]) == [1, 2, -1, 101, -101]
+    assert recorder.iloc[16:32].isnull().all().all()
+    assert list(recorder.iloc[-1]) == [39, 78, -39, 139, -139]
+    assert decode_telemetry(stream)['recorder'].equals(recorder)
+
+
+def test_decode_recorder_empty():
+    recorder = decode_recorder(np.frombuffer(b'', dtype=np.uint8))
+    assert len(recorder) == 0
+    assert len(recorder.columns) == 5
+
+
+def test_split_stream():
+    """
+    Text lines and telemetry frames are separated, incomplete data remains.
+    """
+    frame = telemetry_frame(2, 0, '<HHHH', 10, 10, 10, 10)
+    received = b'0.1,INFO,a.c:1,f,1\n' + frame + b'0.2,INFO,a.c:2,f,2\n' + \
+        frame[:5]
+    lines, telemetry, rest = split_stream(received)
+    assert lines == [b'0.1,INFO,a.c:1,f,1', b'0.2,INFO,a.c:2,f,2']
+    assert telemetry == frame
+    assert rest == frame[:5]
+    lines, telemetry, rest = split_stream(rest + frame[5:] + b'0.3')
+    assert lines == []
+    assert telemetry == frame
+    assert rest == b'0.3'
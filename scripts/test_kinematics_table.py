@@ -0,0 +1,95 @@
+import math
+
+import pytest
+from pytest import approx
+
+from kinematics_table import force_levels
+from kinematics_table import generate
+from kinematics_table import linear_profile
+from kinematics_table import sine_table
+from kinematics_table import turn_displacement
+from kinematics_table import turn_profile
+from move_costs import CELL
+
+
+def test_force_levels():
+    """
+    Force levels start at the minimum force with a fixed step.
+    """
+    assert force_levels(0.1, 0.05, 3) == approx([0.1, 0.15, 0.2])
+
+
+def test_linear_profile():
+    """
+    Braking distance with the braking factor must match the kinematics.
+    """
+    profile = linear_profile(0.25)
+    speed = 1.5
+    assert speed ** 2 * profile['braking_factor'] == \
+        approx(speed ** 2 / (2 * profile['deceleration']))
+
+
+def test_turn_profile_angle():
+    """
+    The integrated angular velocity profile must match the turn angle.
+    """
+    frequency = 10000
+    profile = turn_profile(90, 0.25, 0.06, frequency)
+    transition = profile['transition_ticks'] / frequency
+    arc = profile['arc_ticks'] / frequency
+    angle = profile['max_angular_velocity'] * (arc + 4 * transition / math.pi)
+    assert angle == approx(math.pi / 2, rel=1e-2)
+
+
+def test_turn_profile_short():
+    """
+    Turns too short to reach the maximum angular velocity keep the angle and
+    the radius, with a lower linear velocity.
+    """
+    frequency = 10000
+    long = turn_profile(90, 0.1, 0.06, frequency)
+    short = turn_profile(45, 0.1, 0.06, frequency)
+    assert short['arc_ticks'] == 0
+    assert short['linear_velocity'] < long['linear_velocity']
+    assert short['linear_velocity'] / short['max_angular_velocity'] == \
+        approx(0.06)
+    angle = short['max_angular_velocity'] * 4 * \
+        short['transition_ticks'] / frequency / math.pi
+    assert angle == approx(math.pi / 4, rel=1e-2)
+
+
+def test_turn_profile_fits_cell():
+    """
+    The 90-degree turn goes from one cell border to the next.
+    """
+    frequency = 1000
+    profile = turn_profile(90, 0.25, 0.06, frequency)
+    x, y = turn_displacement(profile, frequency)
+    assert profile['before'] > 0 and profile['after'] > 0
+    assert profile['before'] + x == approx(CELL / 2)
+    assert profile['after'] + y == approx(CELL / 2)
+    with pytest.raises(ValueError):
+        turn_profile(90, 0.25, 0.09, frequency)
+
+
+def test_sine_table():
+    """
+    The quarter sine wave table includes both ends.
+    """
+    table = sine_table(5)
+    assert table[0] == 0.
+    assert table[-1] == approx(1.)
+    assert table[2] == approx(math.sqrt(2) / 2)
+
+
+def test_generate():
+    """
+    Test the generated C header.
+    """
+    header = generate(0.1, 0.05, 9, 0.06, 1000)
+    assert '#define KINEMATICS_TABLE_FREQUENCY_HZ 1000\n' in header
+    assert '#define KINEMATICS_FORCE_LEVELS 9\n' in header
+    assert max(len(line) for line in header.splitlines()) <= 80
+    linear = header[header.index('linear_profiles['):]
+    linear = linear[:linear.index('};')]
+    assert linear.count('{') == 10
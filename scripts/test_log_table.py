@@ -0,0 +1,75 @@
+import math
+
+import pytest
+
+from log_table import accuracy
+from log_table import generate
+from log_table import interpolate
+from log_table import log_table
+from log_table import Q
+
+
+def test_log_table_size():
+    """
+    The table must include the last step to interpolate the highest readings.
+    """
+    assert len(log_table(4)) == 1025
+    assert len(log_table(64)) == 65
+
+
+def test_log_table_invalid_step():
+    """
+    Steps which are not divisors of the ADC resolution are not allowed.
+    """
+    with pytest.raises(ValueError):
+        log_table(3)
+    with pytest.raises(ValueError):
+        log_table(0)
+
+
+def test_log_table_fits_uint16():
+    """
+    All values must fit in an `uint16_t`.
+    """
+    assert max(log_table(1)) < 2 ** 16
+
+
+def test_interpolate():
+    """
+    Interpolated values must match the table on steps and lie in between
+    otherwise.
+    """
+    table = log_table(8)
+    assert interpolate(table, 8, 16) == table[2]
+    assert table[2] < interpolate(table, 8, 20) < table[3]
+    # Minimum difference enforced
+    assert interpolate(table, 8, 0) == interpolate(table, 8, 8)
+    # Highest reading
+    assert interpolate(table, 8, 4095) <= table[-1]
+
+
+def test_accuracy():
+    """
+    The interpolated table must be more accurate than the original table
+    (step of 4, no interpolation).
+    """
+    original = [abs(math.log(max(diff // 4 * 4, 4)) - math.log(diff))
+                for diff in range(4, 4096)]
+    max_error, mean_error = accuracy(8)
+    assert max_error < max(original)
+    assert mean_error < sum(original) / len(original)
+    assert abs(interpolate(log_table(8), 8, 2000) / (1 << Q) -
+               math.log(2000)) < 0.001
+
+
+def test_generate():
+    """
+    Test the generated C header.
+    """
+    header = generate(64)
+    assert '#define LOG_TABLE_STEP 64\n' in header
+    assert '#define LOG_TABLE_SIZE 65\n' in header
+    assert '#define LOG_TABLE_Q 12\n' in header
+    assert max(len(line) for line in header.splitlines()) <= 80
+    values = header[header.index('{'):header.index('}')]
+    assert values.count(',') == 64
@@ -0,0 +1,75 @@
+import pytest
+from pytest import approx
+
+from move_costs import CELL
+from move_costs import generate
+from move_costs import move_costs
+from move_costs import straight_time
+from move_costs import turn_cost
+from move_costs import turn_speed
+from move_costs import turn_time
+
+
+def test_straight_time_constant_speed():
+    """
+    Without room to accelerate, straights are traversed at constant speed.
+    """
+    assert straight_time(1., 2., 5., 2.) == approx(0.5)
+
+
+def test_straight_time_speed_limit():
+    """
+    Long straights reach the speed limit and are faster than the turn speed,
+    short ones do not reach it.
+    """
+    long = straight_time(10 * CELL, 0.5, 5., 2.)
+    assert long < 10 * CELL / 0.5
+    assert long == approx(2 * 1.5 / 5. + (10 * CELL - 3.75 / 5.) / 2.)
+    short = straight_time(CELL, 0.5, 5., 2.)
+    assert CELL / 2. < short < CELL / 0.5
+
+
+def test_turn_time():
+    """
+    Wider turns take longer at the same speed and too short turns for the
+    transition are not allowed.
+    """
+    assert turn_time(45, 0.09, 0.25) < turn_time(90, 0.09, 0.25) < \
+        turn_time(180, 0.09, 0.25)
+    with pytest.raises(ValueError):
+        turn_time(45, 0.01, 0.25)
+
+
+def test_turn_cost():
+    """
+    Turn costs include the nominal distance not covered by the slalom.
+    """
+    assert turn_cost(90, 0.09, 0.25) >= turn_time(90, 0.09, 0.25)
+    assert turn_cost(90, 0.09, 0.25) >= CELL / turn_speed(0.09, 0.25) / 2
+
+
+def test_move_costs():
+    """
+    Costs grow with the distance and turn speed must not exceed the limit.
+    """
+    costs = move_costs(16, 0.09, 0.25, 5., 2.)
+    assert len(costs['straight']) == 16
+    assert len(costs['diagonal']) == 32
+    assert costs['straight'][0] == costs['diagonal'][0] == 0
+    assert costs['straight'] == sorted(costs['straight'])
+    assert costs['diagonal'] == sorted(costs['diagonal'])
+    assert costs['turns'][45] < costs['turns'][135] < costs['turns'][180]
+    with pytest.raises(ValueError):
+        move_costs(16, 0.09, 0.25, 5., 0.5)
+
+
+def test_generate():
+    """
+    Test the generated C header.
+    """
+    header = generate(16, 0.09, 0.25, 5., 2.)
+    assert '#define MOVE_COSTS_MAZE_SIZE 16\n' in header
+    assert '#define MOVE_COSTS_STRAIGHT_SIZE 16\n' in header
+    assert '#define MOVE_COSTS_DIAGONAL_SIZE 32\n' in header
+    assert '#define MOVE_COSTS_TURN_90 ' in header
+    assert max(len(line) for line in header.splitlines()) <= 80
@@ -0,0 +1,77 @@
+import os
+
+import pytest
+
+from setpoints import CHUNK
+from setpoints import MAX_SETPOINTS
+from setpoints import RECEIVE_BUFFER_SIZE
+from setpoints import SPEED_SCALE
+from setpoints import encode_speed
+from setpoints import load_commands
+from setpoints import read_trajectory
+
+
+SRC = os.path.join(os.path.dirname(__file__), '..', 'src')
+
+
+@pytest.mark.parametrize('speed,digits', [
+    (0., '0000'),
+    (1.5, '05dc'),
+    (-1., 'fc18'),
+    (-32.768, '8000'),
+])
+def test_encode_speed(speed, digits):
+    assert encode_speed(speed) == digits
+
+
+def test_encode_speed_range():
+    with pytest.raises(ValueError):
+        encode_speed(32.768)
+
+
+def test_load_commands():
+    """
+    Setpoints are split in chunks, each one with the index of the first.
+    """
+    linear = [0.1 * i for i in range(5)]
+    angular = [-0.1 * i for i in range(5)]
+    commands = load_commands(linear, angular, chunk=2)
+    assert commands == [
+        'trajectory load 0 000000000064ff9c',
+        'trajectory load 2 00c8ff38012cfed4',
+        'trajectory load 4 0190fe70',
+    ]
+
+
+def test_load_commands_fit():
+    """
+    Commands, with the terminator, fit half the robot reception buffer.
+    """
+    size = MAX_SETPOINTS
+    longest = max(len(command) for command in
+                  load_commands([1.] * size, [1.] * size))
+    header = open(os.path.join(SRC, 'serial.h')).read()
+    assert '#define RECEIVE_BUFFER_SIZE %d\n' % RECEIVE_BUFFER_SIZE in header
+    assert longest + 1 <= RECEIVE_BUFFER_SIZE // 2
+    assert len(load_commands([0.] * CHUNK, [0.] * CHUNK)) == 1
+    assert len(load_commands([0.] * (CHUNK + 1), [0.] * (CHUNK + 1))) == 2
+
+
+def test_load_commands_invalid():
+    with pytest.raises(ValueError):
+        load_commands([0.], [0., 0.])
+    with pytest.raises(ValueError):
+        load_commands([0.] * (MAX_SETPOINTS + 1), [0.] * (MAX_SETPOINTS + 1))
+
+
+def test_read_trajectory(tmpdir):
+    path = tmpdir.join('turn.csv')
+    path.write('time,linear_velocity,angular_velocity\n'
+               '0.001,0.5,0.0\n0.002,0.5,1.25\n')
+    assert read_trajectory(str(path)) == ([0.5, 0.5], [0., 1.25])
+
+
+def test_firmware_constants():
+    header = open(os.path.join(SRC, 'trajectory.h')).read()
+    assert '#define TRAJECTORY_MAX_SETPOINTS %d\n' % MAX_SETPOINTS in header
+    assert '#define TRAJECTORY_SPEED_SCALE %d.\n' % SPEED_SCALE in header
@@ -0,0 +1,86 @@
+import struct
+
+import pytest
+
+from state_frames import decode
+from state_frames import StateDecoder
+
+
+def frame(kind, sequence, steps, maze_size=16):
+    """
+    Build a frame as `src/simulation/state_frame.c` does.
+    """
+    data = struct.pack('<cBHB', kind, maze_size, sequence, len(steps))
+    for x, y, direction, cells in steps:
+        data += struct.pack('<BBcH', x, y, direction, len(cells))
+        for cell in cells:
+            data += struct.pack('<HBB', *cell)
+    return data
+
+
+def test_decode():
+    """
+    Steps are decoded in order, with their changed cells.
+    """
+    decoded = decode(frame(b'D', 7, [
+        (0, 1, b'N', [(16, 3, 0x12)]),
+        (0, 2, b'N', []),
+    ]))
+    assert not decoded['keyframe']
+    assert decoded['sequence'] == 7
+    assert decoded['steps'][0] == {
+        'x': 0, 'y': 1, 'direction': 'N', 'cells': [(16, 3, 0x12)]}
+    assert decoded['steps'][1]['cells'] == []
+
+
+def test_decode_big_maze():
+    """
+    Cell indexes beyond one byte are supported for bigger mazes.
+    """
+    decoded = decode(frame(b'K', 0, [(31, 31, b'E', [(1023, 1, 2)])],
+                           maze_size=32))
+    assert decoded['maze_size'] == 32
+    assert decoded['steps'][0]['cells'] == [(1023, 1, 2)]
+
+
+def test_decode_invalid():
+    """
+    Unknown types and truncated frames are rejected.
+    """
+    with pytest.raises(ValueError):
+        decode(frame(b'S', 0, []))
+    with pytest.raises(ValueError):
+        decode(frame(b'D', 0, [(0, 0, b'N', [(1, 2, 3)])])[:-1])
+    with pytest.raises(ValueError):
+        decode(frame(b'D', 0, []) + b'\x00')
+
+
+def test_decoder_apply():
+    """
+    Deltas update the state from the last keyframe.
+    """
+    decoder = StateDecoder()
+    decoder.apply(frame(b'K', 0, [(0, 0, b'N', [(0, 5, 1), (1, 4, 2)])]))
+    decoder.apply(frame(b'D', 1, [(0, 1, b'E', [(1, 6, 3)])]))
+    assert decoder.distances[:2] == [5, 6]
+    assert decoder.walls[:2] == [1, 3]
+    assert decoder.position == (0, 1)
+    assert decoder.direction == 'E'
+    assert decoder.lost == 0
+
+
+def test_decoder_lost_frames():
+    """
+    Deltas are ignored after a lost frame until the next keyframe.
+    """
+    decoder = StateDecoder()
+    decoder.apply(frame(b'D', 3, [(0, 0, b'N', [(0, 5, 1)])]))
+    assert not decoder.synchronized
+    decoder.apply(frame(b'K', 4, [(0, 0, b'N', [(0, 5, 1)])]))
+    decoder.apply(frame(b'D', 6, [(0, 1, b'N', [(0, 9, 9)])]))
+    assert decoder.lost == 1
+    assert not decoder.synchronized
+    assert decoder.distances[0] == 5
+    decoder.apply(frame(b'K', 7, [(0, 2, b'N', [(0, 7, 1)])]))
+    assert decoder.synchronized
+    assert decoder.distances[0] == 7
@@ -0,0 +1,71 @@
+import os
+import re
+
+import pytest
+
+from tuning import MAX_VARIANTS
+from tuning import PARAMETERS
+from tuning import expand_grid
+from tuning import rank
+from tuning import variant_command
+
+
+SRC = os.path.join(os.path.dirname(__file__), '..', 'src')
+
+
+def test_expand_grid():
+    """
+    Every combination of values is a variant, in order.
+    """
+    variants = expand_grid('kp_linear=6,8 kd_linear=12,16 '
+                           'linear_speed_limit=1.5')
+    assert variants == [
+        {'kp_linear': 6., 'kd_linear': 12., 'linear_speed_limit': 1.5},
+        {'kp_linear': 6., 'kd_linear': 16., 'linear_speed_limit': 1.5},
+        {'kp_linear': 8., 'kd_linear': 12., 'linear_speed_limit': 1.5},
+        {'kp_linear': 8., 'kd_linear': 16., 'linear_speed_limit': 1.5},
+    ]
+
+
+@pytest.mark.parametrize('spec', [
+    'kp_lineal=6',
+    'kp_linear',
+    'kp_linear=',
+    'kp_linear=6 kp_linear=8',
+    'kp_linear=1,2,3,4,5 kd_linear=1,2,3,4',
+])
+def test_expand_grid_invalid(spec):
+    """
+    Unknown, empty or repeated parameters and oversized grids are rejected.
+    """
+    with pytest.raises(ValueError):
+        expand_grid(spec)
+
+
+def test_variant_command():
+    assert variant_command({'kp_linear': 8., 'linear_speed_limit': 1.5}) == \
+        'tuning add kp_linear=8 linear_speed_limit=1.5'
+
+
+def test_rank():
+    """
+    Rows are sorted by the metric, with collisions last.
+    """
+    rows = [
+        {'variant': 0, 'linear_rms': 0.01, 'collision': True},
+        {'variant': 1, 'linear_rms': 0.03, 'collision': False},
+        {'variant': 2, 'linear_rms': 0.02, 'collision': False},
+    ]
+    assert [row['variant'] for row in rank(rows)] == [2, 1, 0]
+
+
+def test_firmware_parameters():
+    """
+    Parameters and limits must match the firmware.
+    """
+    source = open(os.path.join(SRC, 'tuning.c')).read()
+    names = re.findall(r'CONTROL_PARAMETER\((\w+)\),', source)
+    names += re.findall(r'{"(\w+)",', source)
+    assert names == PARAMETERS
+    header = open(os.path.join(SRC, 'tuning.h')).read()
+    assert '#define TUNING_MAX_VARIANTS %d\n' % MAX_VARIANTS in header
@@ -0,0 +1,69 @@
+"""
+Build tuning session grids and rank their results (see `src/tuning.c`).
+
+A grid is specified as space separated `name=value[,value...]` items, with
+names from `PARAMETERS`. Every combination of values is queued in the robot
+as a variant, leaving the parameters not included with the values in use:
+
+    kp_linear=6,8,10 kd_linear=12,16 linear_speed_limit=1.5
+
+The robot runs the same test move with each variant and only sends back a
+summary row for each one, with the RMS tracking errors, the overshoot and
+the time it took.
+"""
+import itertools
+
+
+PARAMETERS = [
+    'kp_linear',
+    'kd_linear',
+    'kp_angular',
+    'kd_angular',
+    'kp_angular_front',
+    'ki_angular_front',
+    'kp_angular_side',
+    'ki_angular_side',
+    'kp_angular_diagonal',
+    'ki_angular_diagonal',
+    'linear_speed_limit',
+]
+
+# Same as `TUNING_MAX_VARIANTS`
+MAX_VARIANTS = 16
+
+
+def expand_grid(spec):
+    """
+    Return the list of variants of a grid specification, as dictionaries.
+    """
+    names = []
+    values = []
+    for item in spec.split():
+        name, _, listed = item.partition('=')
+        if name not in PARAMETERS or not listed:
+            raise ValueError('Invalid tuning parameter "%s"' % item)
+        if name in names:
+            raise ValueError('Repeated tuning parameter "%s"' % name)
+        names.append(name)
+        values.append([float(value) for value in listed.split(',')])
+    variants = [dict(zip(names, combination))
+                for combination in itertools.product(*values)]
+    if len(variants) > MAX_VARIANTS:
+        raise ValueError('Too many variants (%d, maximum is %d)' %
+                         (len(variants), MAX_VARIANTS))
+    return variants
+
+
+def variant_command(variant):
+    """
+    Return the command that queues a variant in the robot.
+    """
+    pairs = ['%s=%g' % (name, value) for name, value in variant.items()]
+    return ' '.join(['tuning add'] + pairs)
+
+
+def rank(rows, key='linear_rms'):
+    """
+    Sort the summary rows by a metric, with collisions last.
+    """
+    return sorted(rows, key=lambda row: (row['collision'], row[key]))
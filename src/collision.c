@@ -0,0 +1,114 @@
+#include "collision.h"
+
+static float last_left_speed;
+static float last_right_speed;
+static float last_angular_velocity;
+static float linear_residual;
+static float angular_residual;
+static float linear_expected;
+static float angular_expected;
+static volatile uint32_t evidence;
+static volatile bool triggered;
+
+static void low_pass(float *filtered, float value)
+{
+	*filtered += (value - *filtered) * COLLISION_FILTER_FACTOR;
+}
+
+/**
+ * @brief Update the collision detector with the latest measurements.
+ *
+ * The accelerations expected from the power applied on the previous tick are
+ * computed with the motor model (see `feedforward_force()`), at the wheel
+ * speeds measured then, and compared with the accelerations measured since.
+ * The residuals are low-pass filtered, as differentiated speeds are noisy, and
+ * compared with thresholds that grow with the expected accelerations.
+ *
+ * A collision is detected when the motors have been pushing harder than the
+ * mouse accelerates for `COLLISION_DETECTION_PERIOD`. Unlike counting
+ * saturated PWM periods, legitimate high force accelerations are expected by
+ * the model, and crashes are detected as soon as the mouse is stopped, before
+ * the control loop saturates the motor driver.
+ *
+ * @param[in] left_speed Left wheel speed, in meters per second.
+ * @param[in] right_speed Right wheel speed, in meters per second.
+ * @param[in] angular_velocity Gyroscope angular velocity, in rad/s.
+ */
+void collision_update(float left_speed, float right_speed,
+		      float angular_velocity)
+{
+	float force_left = feedforward_force(get_power_left(), last_left_speed);
+	float force_right =
+		feedforward_force(get_power_right(), last_right_speed);
+	float expected_linear = (force_left + force_right) / MOUSE_MASS;
+	float expected_angular = (force_right - force_left) *
+				 MOUSE_WHEELS_SEPARATION / 2. /
+				 MOUSE_MOMENT_OF_INERTIA;
+	float measured_linear = (left_speed + right_speed - last_left_speed -
+				 last_right_speed) /
+				2. * SYSTICK_FREQUENCY_HZ;
+	float measured_angular = (angular_velocity - last_angular_velocity) *
+				 SYSTICK_FREQUENCY_HZ;
+
+	last_left_speed = left_speed;
+	last_right_speed = right_speed;
+	last_angular_velocity = angular_velocity;
+	low_pass(&linear_residual, expected_linear - measured_linear);
+	low_pass(&angular_residual, expected_angular - measured_angular);
+	low_pass(&linear_expected, expected_linear);
+	low_pass(&angular_expected, expected_angular);
+
+	if (fabsf(linear_residual) <
+		COLLISION_LINEAR_THRESHOLD +
+		    COLLISION_MODEL_TOLERANCE * fabsf(linear_expected) &&
+	    fabsf(angular_residual) <
+		COLLISION_ANGULAR_THRESHOLD +
+		    COLLISION_MODEL_TOLERANCE * fabsf(angular_expected)) {
+		evidence = 0;
+		return;
+	}
+	if (++evidence >= COLLISION_DETECTION_PERIOD * SYSTICK_FREQUENCY_HZ)
+		triggered = true;
+}
+
+#ifndef MMSIM_SIMULATION
+/**
+ * @brief Update the collision detector with the encoders and gyroscope.
+ *
+ * To be called on each SysTick, after updating the encoders and before the
+ * motor control sets the power for the next tick.
+ */
+void update_collision_detection(void)
+{
+	struct gyro_z_sample sample;
+
+	get_gyro_z_sample(&sample);
+	collision_update(get_encoder_left_speed(), get_encoder_right_speed(),
+			 (sample.raw - get_gyro_z_offset()) /
+			     MPU_GYRO_LSB_PER_DPS * PI / 180.);
+}
+#endif
+
+/**
+ * @brief Whether the collision detector has detected a collision.
+ */
+bool collision_detector_triggered(void)
+{
+	return triggered;
+}
+
+/**
+ * @brief Reset the collision detector, before starting to move.
+ */
+void reset_collision_detector(void)
+{
+	last_left_speed = 0.;
+	last_right_speed = 0.;
+	last_angular_velocity = 0.;
+	linear_residual = 0.;
+	angular_residual = 0.;
+	linear_expected = 0.;
+	angular_expected = 0.;
+	evidence = 0;
+	triggered = false;
+}
@@ -0,0 +1,37 @@
+#ifndef __COLLISION_H
+#define __COLLISION_H
+
+#include <math.h>
+#include <stdbool.h>
+
+#include "feedforward.h"
+#include "motor.h"
+#include "platform.h"
+#include "setup.h"
+
+#ifndef MMSIM_SIMULATION
+#include "encoders.h"
+#endif
+
+/** Low-pass filter factor applied to the acceleration residuals per tick */
+#define COLLISION_FILTER_FACTOR 0.05
+
+/**
+ * Acceleration residuals considered an obstruction: a fixed threshold, in
+ * m/s^2 and rad/s^2, plus a fraction of the expected acceleration to tolerate
+ * model errors on legitimate high force moves.
+ */
+#define COLLISION_LINEAR_THRESHOLD 5.
+#define COLLISION_ANGULAR_THRESHOLD 100.
+#define COLLISION_MODEL_TOLERANCE 0.5
+
+/** Time the residuals must stay above thresholds to detect a collision */
+#define COLLISION_DETECTION_PERIOD 0.005
+
+void collision_update(float left_speed, float right_speed,
+		      float angular_velocity);
+void update_collision_detection(void);
+bool collision_detector_triggered(void);
+void reset_collision_detector(void);
+
+#endif /* __COLLISION_H */
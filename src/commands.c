@@ -0,0 +1,647 @@
+#include "commands.h"
+
+/** Maze goal cells used by the benchmarks */
+static const uint16_t goals[4] = {119, 120, 135, 136};
+
+/** Flood fill benchmark mazes, kept in the shared work area */
+struct benchmark_flood_area {
+	struct flood maze;
+	struct flood incremental;
+	struct flood full;
+};
+
+/** Planner benchmark maze and moves, kept in the shared work area */
+struct benchmark_planner_area {
+	struct flood maze;
+	struct plan_move moves[PLANNER_MAX_MOVES];
+};
+
+_Static_assert(sizeof(struct benchmark_flood_area) <= WORKSPACE_SIZE,
+	       "Flood fill benchmark does not fit the work area");
+_Static_assert(sizeof(struct benchmark_planner_area) <= WORKSPACE_SIZE,
+	       "Planner benchmark does not fit the work area");
+
+/**
+ * @brief Measure the average clock cycles of the sensors log pipeline.
+ *
+ * Every possible difference between the raw readings is evaluated with:
+ *
+ * - `sensors_raw_log_fixed()`: interpolated table lookup.
+ * - `sensors_raw_log()`: same lookup, converted to floating point.
+ * - `sensors_distance_fixed()`: full distance calculation, in fixed point.
+ * - `sensors_distance()`: full distance calculation, as a float (depends on
+ *   `SENSORS_FIXED_POINT`).
+ *
+ * @note Interruptions are not disabled, so results may be slightly higher
+ * than the real cost.
+ */
+static void benchmark_sensors_log(void)
+{
+	uint16_t diff;
+	uint32_t start;
+	uint32_t cycles_fixed;
+	uint32_t cycles_float;
+	uint32_t cycles_distance_fixed;
+	uint32_t cycles_distance;
+	volatile float sink_float;
+	volatile uint16_t sink_fixed;
+	volatile int32_t sink_distance;
+
+	start = read_cycle_counter();
+	for (diff = 0; diff < ADC_RESOLUTION; diff++)
+		sink_fixed = sensors_raw_log_fixed(diff, 0);
+	cycles_fixed = read_cycle_counter() - start;
+
+	start = read_cycle_counter();
+	for (diff = 0; diff < ADC_RESOLUTION; diff++)
+		sink_float = sensors_raw_log(diff, 0);
+	cycles_float = read_cycle_counter() - start;
+
+	start = read_cycle_counter();
+	for (diff = 0; diff < ADC_RESOLUTION; diff++)
+		sink_distance =
+			sensors_distance_fixed(SENSOR_SIDE_LEFT_ID, diff, 0);
+	cycles_distance_fixed = read_cycle_counter() - start;
+
+	start = read_cycle_counter();
+	for (diff = 0; diff < ADC_RESOLUTION; diff++)
+		sink_float = sensors_distance(SENSOR_SIDE_LEFT_ID, diff, 0);
+	cycles_distance = read_cycle_counter() - start;
+
+	(void)sink_fixed;
+	(void)sink_float;
+	(void)sink_distance;
+	LOG_INFO("{\"log_fixed\":%" PRIu32 ",\"log_float\":%" PRIu32
+		 ",\"distance_fixed\":%" PRIu32 ",\"distance\":%" PRIu32 "}",
+		 cycles_fixed / ADC_RESOLUTION, cycles_float / ADC_RESOLUTION,
+		 cycles_distance_fixed / ADC_RESOLUTION,
+		 cycles_distance / ADC_RESOLUTION);
+}
+
+/**
+ * @brief Measure the average clock cycles of the speed and turn profiles.
+ *
+ * Every tick of a 90-degree slalom turn is evaluated with:
+ *
+ * - `turn_angular_velocity()` and `braking_distance()`: generated tables.
+ * - The same profile and braking distance calculated at run time, with
+ *   `sinf()` and a division.
+ *
+ * @see benchmark_sensors_log()
+ */
+static void benchmark_kinematics(void)
+{
+	const struct linear_profile *linear = get_linear_profile(0.25);
+	const struct turn_profile *profile = get_turn_profile(0.25, TURN_90);
+	uint16_t ticks = turn_profile_ticks(profile);
+	uint16_t transition = profile->transition_ticks;
+	uint32_t cycles_table;
+	uint32_t cycles_runtime;
+	volatile float sink;
+	uint32_t start;
+	float factor;
+	uint16_t tick;
+
+	start = read_cycle_counter();
+	for (tick = 0; tick < ticks; tick++) {
+		sink = turn_angular_velocity(profile, tick);
+		sink = braking_distance(linear, profile->linear_velocity, 0.);
+	}
+	cycles_table = read_cycle_counter() - start;
+
+	start = read_cycle_counter();
+	for (tick = 0; tick < ticks; tick++) {
+		factor = 1.;
+		if (tick < transition)
+			factor = (float)tick / transition;
+		else if (tick >= ticks - transition)
+			factor = (float)(ticks - tick) / transition;
+		sink = profile->max_angular_velocity * sinf(factor * PI / 2.);
+		sink = profile->linear_velocity * profile->linear_velocity /
+		       (2. * 2. * 0.25 / MOUSE_MASS);
+	}
+	cycles_runtime = read_cycle_counter() - start;
+
+	(void)sink;
+	LOG_INFO("{\"table\":%" PRIu32 ",\"runtime\":%" PRIu32 "}",
+		 cycles_table / ticks, cycles_runtime / ticks);
+}
+
+/**
+ * @brief Add random inner walls to a flood fill state.
+ *
+ * Each inner wall is added with a 40 % probability. Unreachable regions are
+ * allowed, as they are a worst case for the incremental update.
+ */
+static void random_walls(struct flood *maze)
+{
+	uint16_t cell;
+
+	flood_reset(maze);
+	for (cell = 0; cell < FLOOD_MAZE_AREA; cell++) {
+		if (rand() % 5 < 2)
+			flood_add_wall(maze, cell, FLOOD_EAST);
+		if (rand() % 5 < 2)
+			flood_add_wall(maze, cell, FLOOD_NORTH);
+	}
+}
+
+/**
+ * @brief Compare incremental and full flood fill updates during a search.
+ *
+ * A random maze is explored cell by cell and each discovered wall updates
+ * the distances to the central goal twice:
+ *
+ * - `flood_incremental()`: only the cells affected by the new wall.
+ * - `flood_add_wall()` and `flood_full()`: the whole maze.
+ *
+ * Both results must match after each step. Worst and average clock cycles
+ * per step are logged for both, along with the number of mismatches. The
+ * mazes are kept in the shared work area, discarding any trajectory loaded
+ * or control records kept.
+ */
+static void benchmark_flood(void)
+{
+	struct benchmark_flood_area *area;
+	const uint8_t walls[2] = {FLOOD_EAST, FLOOD_NORTH};
+	uint32_t incremental_max = 0;
+	uint32_t incremental_sum = 0;
+	uint32_t full_max = 0;
+	uint32_t full_sum = 0;
+	uint32_t mismatches = 0;
+	uint32_t steps = 0;
+	uint32_t cycles;
+	uint32_t start;
+	uint16_t cell;
+	uint8_t i;
+
+	area = workspace_claim(WORKSPACE_BENCHMARK);
+	random_walls(&area->maze);
+	flood_reset(&area->incremental);
+	for (i = 0; i < 4; i++)
+		flood_set_goal(&area->incremental, goals[i]);
+	flood_full(&area->incremental);
+	area->full = area->incremental;
+
+	for (cell = 0; cell < FLOOD_MAZE_AREA; cell++) {
+		for (i = 0; i < 2; i++) {
+			if (!flood_has_wall(&area->maze, cell, walls[i]) ||
+			    flood_has_wall(&area->incremental, cell, walls[i]))
+				continue;
+
+			start = read_cycle_counter();
+			flood_incremental(&area->incremental, cell, walls[i]);
+			cycles = read_cycle_counter() - start;
+			incremental_sum += cycles;
+			if (cycles > incremental_max)
+				incremental_max = cycles;
+
+			start = read_cycle_counter();
+			flood_add_wall(&area->full, cell, walls[i]);
+			flood_full(&area->full);
+			cycles = read_cycle_counter() - start;
+			full_sum += cycles;
+			if (cycles > full_max)
+				full_max = cycles;
+
+			if (memcmp(area->incremental.distances,
+				   area->full.distances,
+				   sizeof(area->full.distances)))
+				mismatches++;
+			steps++;
+		}
+	}
+
+	if (!steps)
+		steps = 1;
+	LOG_INFO("{\"steps\":%" PRIu32 ",\"mismatches\":%" PRIu32
+		 ",\"incremental_max\":%" PRIu32
+		 ",\"incremental_mean\":%" PRIu32 ",\"full_max\":%" PRIu32
+		 ",\"full_mean\":%" PRIu32 "}",
+		 steps, mismatches, incremental_max, incremental_sum / steps,
+		 full_max, full_sum / steps);
+}
+
+/**
+ * @brief Compare the time optimal and the shortest run plans.
+ *
+ * Both runs are planned on a random maze. Clock cycles taken by each planner
+ * are logged along with the estimated run times, in milliseconds, and the
+ * number of moves. The maze and moves are kept in the shared work area.
+ */
+static void benchmark_planner(void)
+{
+	struct benchmark_planner_area *area;
+	uint32_t optimal_cycles;
+	uint32_t shortest_cycles;
+	uint32_t optimal_time;
+	uint32_t shortest_time;
+	uint16_t optimal_moves;
+	uint16_t shortest_moves;
+	uint32_t start;
+	uint8_t i;
+
+	area = workspace_claim(WORKSPACE_BENCHMARK);
+	random_walls(&area->maze);
+	for (i = 0; i < 4; i++)
+		flood_set_goal(&area->maze, goals[i]);
+
+	start = read_cycle_counter();
+	optimal_time =
+		plan_time_optimal(&area->maze, area->moves, &optimal_moves);
+	optimal_cycles = read_cycle_counter() - start;
+
+	start = read_cycle_counter();
+	flood_full(&area->maze);
+	shortest_time =
+		plan_shortest(&area->maze, area->moves, &shortest_moves);
+	shortest_cycles = read_cycle_counter() - start;
+
+	LOG_INFO("{\"optimal_cycles\":%" PRIu32 ",\"optimal_time\":%" PRIu32
+		 ",\"optimal_moves\":%" PRIu16 ",\"shortest_cycles\":%" PRIu32
+		 ",\"shortest_time\":%" PRIu32 ",\"shortest_moves\":%" PRIu16
+		 "}",
+		 optimal_cycles, optimal_time, optimal_moves, shortest_cycles,
+		 shortest_time, shortest_moves);
+}
+
+/**
+ * @brief Log the sensors calibration constants.
+ */
+static void log_sensors_calibration(void)
+{
+	uint8_t i;
+	float a[NUM_SENSOR];
+	float b[NUM_SENSOR];
+
+	for (i = 0; i < NUM_SENSOR; i++)
+		get_sensors_calibration(i, &a[i], &b[i]);
+	LOG_INFO("{\"a\":[%.4f,%.4f,%.4f,%.4f],"
+		 "\"b\":[%.4f,%.4f,%.4f,%.4f]}",
+		 a[0], a[1], a[2], a[3], b[0], b[1], b[2], b[3]);
+}
+
+/**
+ * @brief Parse and set the calibration constants of a sensor.
+ *
+ * Constants out of the fixed point range are rejected (see
+ * `sensors_calibration_valid()`).
+ *
+ * @param[in] arguments Sensor ID and calibration constants A and B,
+ * separated by spaces.
+ */
+static void parse_sensors_calibration(char *arguments)
+{
+	long sensor;
+	float a;
+	float b;
+	char *end;
+	char *a_end;
+	char *b_end;
+
+	sensor = strtol(arguments, &end, 10);
+	a = strtof(end, &a_end);
+	b = strtof(a_end, &b_end);
+	if (end == arguments || a_end == end || b_end == a_end || *b_end ||
+	    sensor < 0 || sensor >= NUM_SENSOR ||
+	    !set_sensors_calibration((uint8_t)sensor, a, b)) {
+		LOG_ERROR("Invalid sensors calibration \"%s\"", arguments);
+		return;
+	}
+	log_sensors_calibration();
+}
+
+/**
+ * @brief Log the sensors schedule requested.
+ */
+static void log_sensors_schedule(void)
+{
+	static const char *const names[SENSORS_SCHEDULES] = {"all", "side",
+							      "front"};
+
+	LOG_INFO("{\"schedule\":\"%s\",\"auto\":%s}",
+		 names[get_sensors_schedule()],
+		 get_sensors_schedule_auto() ? "true" : "false");
+}
+
+/**
+ * @brief Parse and set the sensors schedule.
+ *
+ * @param[in] arguments Schedule name (`all`, `side` or `front`), or `auto`
+ * to select it from the movement phase.
+ */
+static void parse_sensors_schedule(char *arguments)
+{
+	if (!strcmp(arguments, "auto")) {
+		set_sensors_schedule_auto(true);
+	} else if (!strcmp(arguments, "all")) {
+		set_sensors_schedule_auto(false);
+		set_sensors_schedule(SENSORS_SCHEDULE_ALL);
+	} else if (!strcmp(arguments, "side")) {
+		set_sensors_schedule_auto(false);
+		set_sensors_schedule(SENSORS_SCHEDULE_SIDE);
+	} else if (!strcmp(arguments, "front")) {
+		set_sensors_schedule_auto(false);
+		set_sensors_schedule(SENSORS_SCHEDULE_FRONT);
+	} else {
+		LOG_ERROR("Invalid sensors schedule \"%s\"", arguments);
+		return;
+	}
+	log_sensors_schedule();
+}
+
+/**
+ * @brief Log the walls detected around, with their confidence.
+ */
+static void log_sensors_walls(void)
+{
+	struct walls_detection walls = sensors_walls_detection();
+
+	LOG_INFO("{\"left\":[%d,%.3f,%u],\"front\":[%d,%.3f,%u],"
+		 "\"right\":[%d,%.3f,%u]}",
+		 walls.left.present, walls.left.confidence, walls.left.samples,
+		 walls.front.present, walls.front.confidence,
+		 walls.front.samples, walls.right.present,
+		 walls.right.confidence, walls.right.samples);
+}
+
+/**
+ * @brief Log the number of variants queued in the tuning session.
+ */
+static void log_tuning_variants(void)
+{
+	LOG_INFO("{\"variants\":%u}", tuning_variants());
+}
+
+/**
+ * @brief Parse and queue a tuning session variant.
+ *
+ * Parameters not included keep the values currently in use.
+ *
+ * @param[in] arguments Space separated `name=value` pairs, where names are
+ * `struct control_constants` fields or `linear_speed_limit`.
+ */
+static void parse_tuning_variant(char *arguments)
+{
+	struct tuning_variant variant = tuning_current_variant();
+	char *name;
+	char *value;
+	char *end;
+	float number;
+
+	for (name = strtok(arguments, " "); name; name = strtok(NULL, " ")) {
+		value = strchr(name, '=');
+		if (!value) {
+			LOG_ERROR("Invalid tuning parameter \"%s\"", name);
+			return;
+		}
+		*value++ = '\0';
+		number = strtof(value, &end);
+		if (end == value || *end ||
+		    !tuning_set_parameter(&variant, name, number)) {
+			LOG_ERROR("Invalid tuning parameter \"%s\"", name);
+			return;
+		}
+	}
+	if (!tuning_add_variant(variant)) {
+		LOG_ERROR("Tuning session full");
+		return;
+	}
+	log_tuning_variants();
+}
+
+/**
+ * @brief Parse the number of cells and run the tuning session.
+ */
+static void parse_tuning_run(char *arguments)
+{
+	long cells;
+	char *end;
+
+	cells = strtol(arguments, &end, 10);
+	if (end == arguments || cells < 1 || cells > TUNING_MAX_CELLS) {
+		LOG_ERROR("Invalid tuning cells \"%s\"", arguments);
+		return;
+	}
+	tuning_run((int)cells);
+}
+
+/**
+ * @brief Log the number of setpoints of the trajectory loaded.
+ *
+ * Setpoints missing below the length are logged too: the trajectory cannot
+ * be played until they are loaded.
+ */
+static void log_trajectory_length(void)
+{
+	LOG_INFO("{\"setpoints\":%u,\"missing\":%u}", trajectory_length(),
+		 trajectory_missing());
+}
+
+/**
+ * @brief Parse a 16 bits value from 4 hexadecimal digits.
+ *
+ * @param[in] digits Hexadecimal digits, most significant first.
+ * @param[out] value Parsed value.
+ *
+ * @return Whether the digits were valid.
+ */
+static bool parse_hex_uint16(const char *digits, uint16_t *value)
+{
+	uint8_t i;
+	char c;
+
+	*value = 0;
+	for (i = 0; i < 4; i++) {
+		c = digits[i];
+		if (c >= '0' && c <= '9')
+			c -= '0';
+		else if (c >= 'a' && c <= 'f')
+			c -= 'a' - 10;
+		else
+			return false;
+		*value = (uint16_t)(*value << 4 | c);
+	}
+	return true;
+}
+
+/**
+ * @brief Parse and load a chunk of trajectory setpoints.
+ *
+ * @param[in] arguments Index of the first setpoint and the setpoints, as
+ * lowercase hexadecimal digits: 4 for the linear and 4 for the angular speed
+ * of each one (see `struct trajectory_setpoint`).
+ */
+static void parse_trajectory_load(char *arguments)
+{
+	struct trajectory_setpoint setpoint;
+	uint16_t linear;
+	uint16_t angular;
+	long index;
+	char *digits;
+
+	index = strtol(arguments, &digits, 10);
+	if (digits == arguments || *digits++ != ' ' || index < 0 ||
+	    strlen(digits) % 8) {
+		LOG_ERROR("Invalid trajectory chunk");
+		return;
+	}
+	for (; *digits; digits += 8, index++) {
+		if (!parse_hex_uint16(digits, &linear) ||
+		    !parse_hex_uint16(digits + 4, &angular)) {
+			LOG_ERROR("Invalid trajectory setpoint %ld", index);
+			return;
+		}
+		setpoint.linear = (int16_t)linear;
+		setpoint.angular = (int16_t)angular;
+		if (index > UINT16_MAX ||
+		    !trajectory_set_setpoint((uint16_t)index, setpoint)) {
+			LOG_ERROR("Setpoint %ld out of range", index);
+			return;
+		}
+	}
+	log_trajectory_length();
+}
+
+/**
+ * @brief Log the result of a flash operation.
+ */
+static void log_flash_result(uint32_t result)
+{
+	if (result != RESULT_OK)
+		LOG_ERROR("Flash error 0x%" PRIx32, result);
+	else
+		LOG_INFO("{\"result\":\"ok\"}");
+}
+
+/**
+ * @brief Execute a platform-specific command received through serial.
+ *
+ * Platform commands are processed before the generic `execute_command()`,
+ * which handles any other command received.
+ *
+ * Available commands:
+ *
+ * - `benchmark sensors_log`: average clock cycles per sensors log lookup.
+ * - `benchmark kinematics`: average clock cycles per speed profile tick.
+ * - `benchmark flood`: incremental against full flood fill clock cycles.
+ * - `benchmark planner`: time optimal against shortest run plans.
+ * - `profile`: SysTick handler profiling statistics.
+ * - `profile reset`: reset SysTick handler profiling statistics.
+ * - `serial`: serial transmission statistics.
+ * - `serial reset`: reset serial transmission statistics.
+ * - `telemetry on`: start sending binary telemetry frames.
+ * - `telemetry off`: stop sending binary telemetry frames.
+ * - `telemetry dump`: send the control records kept in RAM.
+ * - `sensors calibration`: sensors calibration constants.
+ * - `sensors calibration <id> <a> <b>`: set a sensor calibration constants.
+ * - `sensors schedule`: sensors schedule requested.
+ * - `sensors schedule <all|side|front|auto>`: set the sensors schedule.
+ * - `sensors walls`: walls detected around, with their confidence.
+ * - `settings save`: save the current settings in flash.
+ * - `settings erase`: erase the saved settings (defaults after reset).
+ * - `tuning`: number of variants queued in the tuning session.
+ * - `tuning add <name>=<value> ...`: queue a tuning session variant.
+ * - `tuning clear`: discard the variants queued.
+ * - `tuning run <cells>`: run the test move with every variant queued.
+ * - `trajectory`: number of setpoints of the trajectory loaded.
+ * - `trajectory load <index> <setpoints>`: load trajectory setpoints.
+ * - `trajectory clear`: discard the trajectory loaded.
+ * - `trajectory run`: play back the trajectory loaded.
+ *
+ * @return Whether a platform command was received and executed.
+ */
+bool execute_platform_command(void)
+{
+	char *buffer;
+
+	if (!get_received_command_flag())
+		return false;
+
+	buffer = get_received_serial_buffer();
+	if (!strcmp(buffer, "benchmark sensors_log")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		benchmark_sensors_log();
+	} else if (!strcmp(buffer, "benchmark kinematics")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		benchmark_kinematics();
+	} else if (!strcmp(buffer, "benchmark flood")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		benchmark_flood();
+	} else if (!strcmp(buffer, "benchmark planner")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		benchmark_planner();
+	} else if (!strcmp(buffer, "profile")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		log_profiler();
+	} else if (!strcmp(buffer, "profile reset")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		profiler_reset();
+	} else if (!strcmp(buffer, "serial")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		log_serial_statistics();
+	} else if (!strcmp(buffer, "serial reset")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		serial_reset_statistics();
+	} else if (!strcmp(buffer, "telemetry on")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		telemetry_enable();
+	} else if (!strcmp(buffer, "telemetry off")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		telemetry_disable();
+	} else if (!strcmp(buffer, "telemetry dump")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		telemetry_recorder_dump();
+	} else if (!strcmp(buffer, "sensors calibration")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		log_sensors_calibration();
+	} else if (!strncmp(buffer, "sensors calibration ", 20)) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		parse_sensors_calibration(buffer + 20);
+	} else if (!strcmp(buffer, "sensors schedule")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		log_sensors_schedule();
+	} else if (!strncmp(buffer, "sensors schedule ", 17)) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		parse_sensors_schedule(buffer + 17);
+	} else if (!strcmp(buffer, "sensors walls")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		log_sensors_walls();
+	} else if (!strcmp(buffer, "settings save")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		log_flash_result(save_settings());
+	} else if (!strcmp(buffer, "settings erase")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		log_flash_result(erase_settings());
+	} else if (!strcmp(buffer, "tuning")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		log_tuning_variants();
+	} else if (!strncmp(buffer, "tuning add ", 11)) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		parse_tuning_variant(buffer + 11);
+	} else if (!strcmp(buffer, "tuning clear")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		tuning_clear();
+		log_tuning_variants();
+	} else if (!strncmp(buffer, "tuning run ", 11)) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		parse_tuning_run(buffer + 11);
+	} else if (!strcmp(buffer, "trajectory")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		log_trajectory_length();
+	} else if (!strncmp(buffer, "trajectory load ", 16)) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		parse_trajectory_load(buffer + 16);
+	} else if (!strcmp(buffer, "trajectory clear")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		trajectory_clear();
+		log_trajectory_length();
+	} else if (!strcmp(buffer, "trajectory run")) {
+		LOG_DEBUG("Processing \"%s\"", buffer);
+		trajectory_run();
+	} else {
+		return false;
+	}
+	set_received_command_flag(false);
+	return true;
+}
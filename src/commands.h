@@ -0,0 +1,25 @@
+#ifndef __COMMANDS_H
+#define __COMMANDS_H
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mmlib/logging.h"
+
+#include "detection.h"
+#include "flood.h"
+#include "kinematics.h"
+#include "planner.h"
+#include "platform.h"
+#include "profiler.h"
+#include "serial.h"
+#include "settings.h"
+#include "telemetry.h"
+#include "trajectory.h"
+#include "tuning.h"
+#include "workspace.h"
+
+bool execute_platform_command(void);
+
+#endif /* __COMMANDS_H */
@@ -1,6 +1,8 @@
 #ifndef __CONFIG_H
 #define __CONFIG_H
 
+#include "setup.h"
+
 /** Locomotion-related constants */
 #define MICROMETERS_PER_COUNT 8.32
 #define SHIFT_AFTER_180_DEG_TURN 0.010
@@ -18,17 +20,27 @@
 #define SENSOR_FRONT_RIGHT_A 2.713
 #define SENSOR_FRONT_RIGHT_B 0.258
 
-/** Control constants */
-#define KP_LINEAR 8.
+/**
+ * Control constants.
+ *
+ * They were tuned with the control loop running at
+ * `CONTROL_TUNING_FREQUENCY_HZ`. Terms acting on errors accumulated on each
+ * control loop iteration are scaled with `CONTROL_FREQUENCY_SCALE`, so their
+ * effect does not depend on `SYSTICK_FREQUENCY_HZ`.
+ */
+#define CONTROL_TUNING_FREQUENCY_HZ 1000
+#define CONTROL_FREQUENCY_SCALE                                                \
+	((float)CONTROL_TUNING_FREQUENCY_HZ / SYSTICK_FREQUENCY_HZ)
+#define KP_LINEAR (8. * CONTROL_FREQUENCY_SCALE)
 #define KD_LINEAR 16.
-#define KP_ANGULAR .05
+#define KP_ANGULAR (.05 * CONTROL_FREQUENCY_SCALE)
 #define KD_ANGULAR 1.
 #define KP_ANGULAR_FRONT .5
-#define KI_ANGULAR_FRONT 2.
+#define KI_ANGULAR_FRONT (2. * CONTROL_FREQUENCY_SCALE)
 #define KP_ANGULAR_SIDE 2.
-#define KI_ANGULAR_SIDE 4.
+#define KI_ANGULAR_SIDE (4. * CONTROL_FREQUENCY_SCALE)
 #define KP_ANGULAR_DIAGONAL 2.
-#define KI_ANGULAR_DIAGONAL 4.
+#define KI_ANGULAR_DIAGONAL (4. * CONTROL_FREQUENCY_SCALE)
 
 struct control_constants {
 	float kp_linear;
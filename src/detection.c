@@ -1,280 +1,762 @@
 #include "detection.h"
+#include "log_table.h"
 
-#define LOG_CONVERSION_TABLE_STEP 4
-#define LOG_CONVERSION_TABLE_SIZE (ADC_RESOLUTION / LOG_CONVERSION_TABLE_STEP)
+#if LOG_TABLE_Q != SENSORS_LOG_Q
+#error "Log table fixed point format does not match SENSORS_LOG_Q"
+#endif
 
-static volatile uint16_t sensors_off[NUM_SENSOR], sensors_on[NUM_SENSOR];
+/** Reset all emitter pins (same pins on both GPIOA and GPIOB) */
+#define EMITTERS_OFF ((GPIO8 | GPIO9) << 16)
+
+/** Sensors pairs read on each half sweep */
+#define SENSORS_PAIR_SIDE 0
+#define SENSORS_PAIR_FRONT 1
+
+static volatile uint16_t sweep[SENSORS_SWEEP_SLOTS];
+static volatile struct sensors_snapshot snapshots[SENSORS_SNAPSHOTS];
+static volatile uint8_t latest_snapshot;
+static volatile uint32_t snapshot_sequence;
+static uint16_t latest_on[NUM_SENSOR];
+static uint16_t latest_off[NUM_SENSOR];
+static volatile uint8_t requested_schedule;
+static volatile bool schedule_auto;
+static uint8_t active_schedule;
+static uint8_t schedule_phase;
+static uint8_t sweep_pairs[2];
+
+/**
+ * Sensors calibration constants, indexed by sensor ID.
+ *
+ * Fixed point versions use `SENSORS_DISTANCE_Q` fractional bits. Defaults are
+ * defined in `config.h` and can be changed with `set_sensors_calibration()`.
+ */
+static volatile float calibration_a[NUM_SENSOR] = {
+    SENSOR_SIDE_LEFT_A, SENSOR_SIDE_RIGHT_A, SENSOR_FRONT_LEFT_A,
+    SENSOR_FRONT_RIGHT_A};
+static volatile float calibration_b[NUM_SENSOR] = {
+    SENSOR_SIDE_LEFT_B, SENSOR_SIDE_RIGHT_B, SENSOR_FRONT_LEFT_B,
+    SENSOR_FRONT_RIGHT_B};
+static volatile uint32_t calibration_a_fixed[NUM_SENSOR] = {
+    SENSORS_DISTANCE_FIXED(SENSOR_SIDE_LEFT_A),
+    SENSORS_DISTANCE_FIXED(SENSOR_SIDE_RIGHT_A),
+    SENSORS_DISTANCE_FIXED(SENSOR_FRONT_LEFT_A),
+    SENSORS_DISTANCE_FIXED(SENSOR_FRONT_RIGHT_A)};
+static volatile int32_t calibration_b_fixed[NUM_SENSOR] = {
+    SENSORS_DISTANCE_FIXED(SENSOR_SIDE_LEFT_B),
+    SENSORS_DISTANCE_FIXED(SENSOR_SIDE_RIGHT_B),
+    SENSORS_DISTANCE_FIXED(SENSOR_FRONT_LEFT_B),
+    SENSORS_DISTANCE_FIXED(SENSOR_FRONT_RIGHT_B)};
+
+/** Sensors IDs of each pair */
+static const uint8_t pairs[2][2] = {
+    {SENSOR_SIDE_LEFT_ID, SENSOR_SIDE_RIGHT_ID},
+    {SENSOR_FRONT_LEFT_ID, SENSOR_FRONT_RIGHT_ID}};
+
+/** Pairs read on each half sweep of the schedules cycle */
+static const uint8_t schedules[SENSORS_SCHEDULES][SENSORS_SCHEDULE_HALVES] = {
+    {SENSORS_PAIR_SIDE, SENSORS_PAIR_FRONT, SENSORS_PAIR_SIDE,
+     SENSORS_PAIR_FRONT},
+    {SENSORS_PAIR_SIDE, SENSORS_PAIR_FRONT, SENSORS_PAIR_SIDE,
+     SENSORS_PAIR_SIDE},
+    {SENSORS_PAIR_FRONT, SENSORS_PAIR_SIDE, SENSORS_PAIR_FRONT,
+     SENSORS_PAIR_FRONT}};
 
 /**
- * Table to calculate the log of values between `1` and `ADC_RESOLUTION - 1`.
+ * ADC channel and emitter pins (GPIOA and GPIOB) of each sensor:
  *
- * @note It uses steps of size `LOG_CONVERSION_TABLE_STEP`.
- * @note To avoid unstable results, it calculates `log(0)` as `1`.
+ * - Side left: channel 4, PA9.
+ * - Side right: channel 3, PB8.
+ * - Front left: channel 5, PA8.
+ * - Front right: channel 2, PB9.
  */
-const float log_conversion[LOG_CONVERSION_TABLE_SIZE] = {
-    1.,     1.3863, 2.0794, 2.4849, 2.7726, 2.9957, 3.1781, 3.3322, 3.4657,
-    3.5835, 3.6889, 3.7842, 3.8712, 3.9512, 4.0254, 4.0943, 4.1589, 4.2195,
-    4.2767, 4.3307, 4.382,  4.4308, 4.4773, 4.5218, 4.5643, 4.6052, 4.6444,
-    4.6821, 4.7185, 4.7536, 4.7875, 4.8203, 4.852,  4.8828, 4.9127, 4.9416,
-    4.9698, 4.9972, 5.0239, 5.0499, 5.0752, 5.0999, 5.124,  5.1475, 5.1705,
-    5.193,  5.2149, 5.2364, 5.2575, 5.2781, 5.2983, 5.3181, 5.3375, 5.3566,
-    5.3753, 5.3936, 5.4116, 5.4293, 5.4467, 5.4638, 5.4806, 5.4972, 5.5134,
-    5.5294, 5.5452, 5.5607, 5.5759, 5.591,  5.6058, 5.6204, 5.6348, 5.649,
-    5.663,  5.6768, 5.6904, 5.7038, 5.717,  5.7301, 5.743,  5.7557, 5.7683,
-    5.7807, 5.793,  5.8051, 5.8171, 5.8289, 5.8406, 5.8522, 5.8636, 5.8749,
-    5.8861, 5.8972, 5.9081, 5.9189, 5.9296, 5.9402, 5.9506, 5.961,  5.9713,
-    5.9814, 5.9915, 6.0014, 6.0113, 6.021,  6.0307, 6.0403, 6.0497, 6.0591,
-    6.0684, 6.0776, 6.0868, 6.0958, 6.1048, 6.1137, 6.1225, 6.1312, 6.1399,
-    6.1485, 6.157,  6.1654, 6.1738, 6.1821, 6.1903, 6.1985, 6.2066, 6.2146,
-    6.2226, 6.2305, 6.2383, 6.2461, 6.2538, 6.2615, 6.2691, 6.2766, 6.2841,
-    6.2916, 6.2989, 6.3063, 6.3135, 6.3208, 6.3279, 6.3351, 6.3421, 6.3491,
-    6.3561, 6.363,  6.3699, 6.3767, 6.3835, 6.3902, 6.3969, 6.4036, 6.4102,
-    6.4167, 6.4232, 6.4297, 6.4362, 6.4425, 6.4489, 6.4552, 6.4615, 6.4677,
-    6.4739, 6.48,   6.4862, 6.4922, 6.4983, 6.5043, 6.5103, 6.5162, 6.5221,
-    6.528,  6.5338, 6.5396, 6.5453, 6.5511, 6.5568, 6.5624, 6.5681, 6.5737,
-    6.5793, 6.5848, 6.5903, 6.5958, 6.6012, 6.6067, 6.612,  6.6174, 6.6227,
-    6.628,  6.6333, 6.6386, 6.6438, 6.649,  6.6542, 6.6593, 6.6644, 6.6695,
-    6.6746, 6.6796, 6.6846, 6.6896, 6.6946, 6.6995, 6.7044, 6.7093, 6.7142,
-    6.719,  6.7238, 6.7286, 6.7334, 6.7382, 6.7429, 6.7476, 6.7523, 6.7569,
-    6.7616, 6.7662, 6.7708, 6.7754, 6.7799, 6.7845, 6.789,  6.7935, 6.7979,
-    6.8024, 6.8068, 6.8112, 6.8156, 6.82,   6.8244, 6.8287, 6.833,  6.8373,
-    6.8416, 6.8459, 6.8501, 6.8544, 6.8586, 6.8628, 6.8669, 6.8711, 6.8752,
-    6.8794, 6.8835, 6.8876, 6.8916, 6.8957, 6.8997, 6.9037, 6.9078, 6.9117,
-    6.9157, 6.9197, 6.9236, 6.9276, 6.9315, 6.9354, 6.9393, 6.9431, 6.947,
-    6.9508, 6.9546, 6.9584, 6.9622, 6.966,  6.9698, 6.9735, 6.9773, 6.981,
-    6.9847, 6.9884, 6.9921, 6.9958, 6.9994, 7.0031, 7.0067, 7.0103, 7.0139,
-    7.0175, 7.0211, 7.0246, 7.0282, 7.0317, 7.0353, 7.0388, 7.0423, 7.0458,
-    7.0493, 7.0527, 7.0562, 7.0596, 7.063,  7.0665, 7.0699, 7.0733, 7.0767,
-    7.08,   7.0834, 7.0867, 7.0901, 7.0934, 7.0967, 7.1,    7.1033, 7.1066,
-    7.1099, 7.1131, 7.1164, 7.1196, 7.1229, 7.1261, 7.1293, 7.1325, 7.1357,
-    7.1389, 7.142,  7.1452, 7.1483, 7.1515, 7.1546, 7.1577, 7.1608, 7.1639,
-    7.167,  7.1701, 7.1732, 7.1763, 7.1793, 7.1824, 7.1854, 7.1884, 7.1914,
-    7.1944, 7.1974, 7.2004, 7.2034, 7.2064, 7.2093, 7.2123, 7.2152, 7.2182,
-    7.2211, 7.224,  7.2269, 7.2298, 7.2327, 7.2356, 7.2385, 7.2414, 7.2442,
-    7.2471, 7.2499, 7.2528, 7.2556, 7.2584, 7.2612, 7.264,  7.2668, 7.2696,
-    7.2724, 7.2752, 7.2779, 7.2807, 7.2834, 7.2862, 7.2889, 7.2917, 7.2944,
-    7.2971, 7.2998, 7.3025, 7.3052, 7.3079, 7.3106, 7.3132, 7.3159, 7.3185,
-    7.3212, 7.3238, 7.3265, 7.3291, 7.3317, 7.3343, 7.3369, 7.3395, 7.3421,
-    7.3447, 7.3473, 7.3499, 7.3524, 7.355,  7.3576, 7.3601, 7.3626, 7.3652,
-    7.3677, 7.3702, 7.3727, 7.3753, 7.3778, 7.3803, 7.3827, 7.3852, 7.3877,
-    7.3902, 7.3926, 7.3951, 7.3976, 7.4,    7.4025, 7.4049, 7.4073, 7.4097,
-    7.4122, 7.4146, 7.417,  7.4194, 7.4218, 7.4242, 7.4265, 7.4289, 7.4313,
-    7.4337, 7.436,  7.4384, 7.4407, 7.4431, 7.4454, 7.4478, 7.4501, 7.4524,
-    7.4547, 7.457,  7.4593, 7.4616, 7.4639, 7.4662, 7.4685, 7.4708, 7.4731,
-    7.4753, 7.4776, 7.4799, 7.4821, 7.4844, 7.4866, 7.4889, 7.4911, 7.4933,
-    7.4955, 7.4978, 7.5,    7.5022, 7.5044, 7.5066, 7.5088, 7.511,  7.5132,
-    7.5153, 7.5175, 7.5197, 7.5219, 7.524,  7.5262, 7.5283, 7.5305, 7.5326,
-    7.5348, 7.5369, 7.539,  7.5412, 7.5433, 7.5454, 7.5475, 7.5496, 7.5517,
-    7.5538, 7.5559, 7.558,  7.5601, 7.5622, 7.5642, 7.5663, 7.5684, 7.5704,
-    7.5725, 7.5746, 7.5766, 7.5787, 7.5807, 7.5827, 7.5848, 7.5868, 7.5888,
-    7.5909, 7.5929, 7.5949, 7.5969, 7.5989, 7.6009, 7.6029, 7.6049, 7.6069,
-    7.6089, 7.6109, 7.6128, 7.6148, 7.6168, 7.6187, 7.6207, 7.6227, 7.6246,
-    7.6266, 7.6285, 7.6305, 7.6324, 7.6343, 7.6363, 7.6382, 7.6401, 7.642,
-    7.644,  7.6459, 7.6478, 7.6497, 7.6516, 7.6535, 7.6554, 7.6573, 7.6592,
-    7.6611, 7.6629, 7.6648, 7.6667, 7.6686, 7.6704, 7.6723, 7.6742, 7.676,
-    7.6779, 7.6797, 7.6816, 7.6834, 7.6852, 7.6871, 7.6889, 7.6907, 7.6926,
-    7.6944, 7.6962, 7.698,  7.6998, 7.7017, 7.7035, 7.7053, 7.7071, 7.7089,
-    7.7107, 7.7124, 7.7142, 7.716,  7.7178, 7.7196, 7.7213, 7.7231, 7.7249,
-    7.7267, 7.7284, 7.7302, 7.7319, 7.7337, 7.7354, 7.7372, 7.7389, 7.7407,
-    7.7424, 7.7441, 7.7459, 7.7476, 7.7493, 7.751,  7.7528, 7.7545, 7.7562,
-    7.7579, 7.7596, 7.7613, 7.763,  7.7647, 7.7664, 7.7681, 7.7698, 7.7715,
-    7.7732, 7.7749, 7.7765, 7.7782, 7.7799, 7.7816, 7.7832, 7.7849, 7.7866,
-    7.7882, 7.7899, 7.7915, 7.7932, 7.7948, 7.7965, 7.7981, 7.7998, 7.8014,
-    7.803,  7.8047, 7.8063, 7.8079, 7.8095, 7.8112, 7.8128, 7.8144, 7.816,
-    7.8176, 7.8192, 7.8208, 7.8224, 7.824,  7.8256, 7.8272, 7.8288, 7.8304,
-    7.832,  7.8336, 7.8352, 7.8368, 7.8383, 7.8399, 7.8415, 7.8431, 7.8446,
-    7.8462, 7.8478, 7.8493, 7.8509, 7.8524, 7.854,  7.8555, 7.8571, 7.8586,
-    7.8602, 7.8617, 7.8633, 7.8648, 7.8663, 7.8679, 7.8694, 7.8709, 7.8725,
-    7.874,  7.8755, 7.877,  7.8785, 7.88,   7.8816, 7.8831, 7.8846, 7.8861,
-    7.8876, 7.8891, 7.8906, 7.8921, 7.8936, 7.8951, 7.8966, 7.898,  7.8995,
-    7.901,  7.9025, 7.904,  7.9054, 7.9069, 7.9084, 7.9099, 7.9113, 7.9128,
-    7.9143, 7.9157, 7.9172, 7.9186, 7.9201, 7.9215, 7.923,  7.9244, 7.9259,
-    7.9273, 7.9288, 7.9302, 7.9316, 7.9331, 7.9345, 7.9359, 7.9374, 7.9388,
-    7.9402, 7.9417, 7.9431, 7.9445, 7.9459, 7.9473, 7.9487, 7.9501, 7.9516,
-    7.953,  7.9544, 7.9558, 7.9572, 7.9586, 7.96,   7.9614, 7.9628, 7.9642,
-    7.9655, 7.9669, 7.9683, 7.9697, 7.9711, 7.9725, 7.9738, 7.9752, 7.9766,
-    7.978,  7.9793, 7.9807, 7.9821, 7.9834, 7.9848, 7.9862, 7.9875, 7.9889,
-    7.9902, 7.9916, 7.9929, 7.9943, 7.9956, 7.997,  7.9983, 7.9997, 8.001,
-    8.0024, 8.0037, 8.005,  8.0064, 8.0077, 8.009,  8.0104, 8.0117, 8.013,
-    8.0143, 8.0157, 8.017,  8.0183, 8.0196, 8.0209, 8.0222, 8.0236, 8.0249,
-    8.0262, 8.0275, 8.0288, 8.0301, 8.0314, 8.0327, 8.034,  8.0353, 8.0366,
-    8.0379, 8.0392, 8.0404, 8.0417, 8.043,  8.0443, 8.0456, 8.0469, 8.0481,
-    8.0494, 8.0507, 8.052,  8.0533, 8.0545, 8.0558, 8.0571, 8.0583, 8.0596,
-    8.0609, 8.0621, 8.0634, 8.0646, 8.0659, 8.0671, 8.0684, 8.0697, 8.0709,
-    8.0722, 8.0734, 8.0746, 8.0759, 8.0771, 8.0784, 8.0796, 8.0809, 8.0821,
-    8.0833, 8.0846, 8.0858, 8.087,  8.0883, 8.0895, 8.0907, 8.0919, 8.0932,
-    8.0944, 8.0956, 8.0968, 8.098,  8.0993, 8.1005, 8.1017, 8.1029, 8.1041,
-    8.1053, 8.1065, 8.1077, 8.1089, 8.1101, 8.1113, 8.1125, 8.1137, 8.1149,
-    8.1161, 8.1173, 8.1185, 8.1197, 8.1209, 8.1221, 8.1233, 8.1244, 8.1256,
-    8.1268, 8.128,  8.1292, 8.1304, 8.1315, 8.1327, 8.1339, 8.1351, 8.1362,
-    8.1374, 8.1386, 8.1397, 8.1409, 8.1421, 8.1432, 8.1444, 8.1455, 8.1467,
-    8.1479, 8.149,  8.1502, 8.1513, 8.1525, 8.1536, 8.1548, 8.1559, 8.1571,
-    8.1582, 8.1594, 8.1605, 8.1617, 8.1628, 8.1639, 8.1651, 8.1662, 8.1674,
-    8.1685, 8.1696, 8.1708, 8.1719, 8.173,  8.1741, 8.1753, 8.1764, 8.1775,
-    8.1786, 8.1798, 8.1809, 8.182,  8.1831, 8.1842, 8.1854, 8.1865, 8.1876,
-    8.1887, 8.1898, 8.1909, 8.192,  8.1931, 8.1942, 8.1953, 8.1964, 8.1975,
-    8.1986, 8.1997, 8.2008, 8.2019, 8.203,  8.2041, 8.2052, 8.2063, 8.2074,
-    8.2085, 8.2096, 8.2107, 8.2118, 8.2128, 8.2139, 8.215,  8.2161, 8.2172,
-    8.2182, 8.2193, 8.2204, 8.2215, 8.2226, 8.2236, 8.2247, 8.2258, 8.2268,
-    8.2279, 8.229,  8.23,   8.2311, 8.2322, 8.2332, 8.2343, 8.2354, 8.2364,
-    8.2375, 8.2385, 8.2396, 8.2406, 8.2417, 8.2428, 8.2438, 8.2449, 8.2459,
-    8.247,  8.248,  8.2491, 8.2501, 8.2511, 8.2522, 8.2532, 8.2543, 8.2553,
-    8.2563, 8.2574, 8.2584, 8.2595, 8.2605, 8.2615, 8.2626, 8.2636, 8.2646,
-    8.2657, 8.2667, 8.2677, 8.2687, 8.2698, 8.2708, 8.2718, 8.2728, 8.2738,
-    8.2749, 8.2759, 8.2769, 8.2779, 8.2789, 8.28,   8.281,  8.282,  8.283,
-    8.284,  8.285,  8.286,  8.287,  8.288,  8.289,  8.29,   8.291,  8.292,
-    8.293,  8.294,  8.295,  8.296,  8.297,  8.298,  8.299,  8.3,    8.301,
-    8.302,  8.303,  8.304,  8.305,  8.306,  8.307,  8.308,  8.3089, 8.3099,
-    8.3109, 8.3119, 8.3129, 8.3139, 8.3148, 8.3158, 8.3168};
+static const uint8_t sensors_channels[NUM_SENSOR] = {
+    ADC_CHANNEL4, ADC_CHANNEL3, ADC_CHANNEL5, ADC_CHANNEL2};
+static const uint32_t sensors_gpioa[NUM_SENSOR] = {GPIO9, EMITTERS_OFF,
+						   GPIO8, EMITTERS_OFF};
+static const uint32_t sensors_gpiob[NUM_SENSOR] = {EMITTERS_OFF, GPIO8,
+						   EMITTERS_OFF, GPIO9};
 
 /**
- * @brief Set an specific emitter ON.
+ * Emitter GPIO commands for each slot of a sensors sweep.
+ *
+ * Each word is written to the GPIO Bit Set/Reset Register (BSRR) by DMA at the
+ * beginning of the corresponding slot. Lower 16 bits set pins and upper 16
+ * bits reset them.
+ *
+ * For each sensor of the sweep there is one reading with all emitters off
+ * followed by one reading with the sensor emitter on. The commands are
+ * rewritten for each sweep, as the schedule requires (see
+ * `prepare_sweep()`).
+ */
+static uint32_t emitters_gpioa[SENSORS_SWEEP_SLOTS];
+static uint32_t emitters_gpiob[SENSORS_SWEEP_SLOTS];
+
+/**
+ * @brief Set the emitters commands and ADC sequence of the next sweep.
+ *
+ * Called before the sweep starts, with the ADC idle between conversions and
+ * the emitters DMA channels waiting for the first slot, so the sweep is read
+ * as a whole with the new configuration.
  *
- * @param[in] emitter Emitter type.
+ * @note The slots order must match the ADC1 regular sequence, which is set
+ * here too.
  */
-static void set_emitter_on(uint8_t emitter)
+static void prepare_sweep(void)
 {
-	switch (emitter) {
-	case SENSOR_SIDE_LEFT_ID:
-		gpio_set(GPIOA, GPIO9);
-		break;
-	case SENSOR_SIDE_RIGHT_ID:
-		gpio_set(GPIOB, GPIO8);
-		break;
-	case SENSOR_FRONT_LEFT_ID:
-		gpio_set(GPIOA, GPIO8);
-		break;
-	case SENSOR_FRONT_RIGHT_ID:
-		gpio_set(GPIOB, GPIO9);
-		break;
-	default:
-		break;
+	uint8_t channel_sequence[SENSORS_SWEEP_SLOTS];
+	uint8_t sensor;
+	uint8_t slot;
+	uint8_t i;
+
+	for (i = 0; i < 2; i++) {
+		sweep_pairs[i] = schedules[active_schedule][schedule_phase + i];
+		for (slot = 4 * i; slot < 4 * i + 4; slot += 2) {
+			sensor = pairs[sweep_pairs[i]][(slot % 4) / 2];
+			channel_sequence[slot] = sensors_channels[sensor];
+			channel_sequence[slot + 1] = sensors_channels[sensor];
+			emitters_gpioa[slot] = EMITTERS_OFF;
+			emitters_gpiob[slot] = EMITTERS_OFF;
+			emitters_gpioa[slot + 1] = sensors_gpioa[sensor];
+			emitters_gpiob[slot + 1] = sensors_gpiob[sensor];
+		}
 	}
+	adc_set_regular_sequence(ADC1, SENSORS_SWEEP_SLOTS, channel_sequence);
 }
 
 /**
- * @brief Set an specific emitter OFF.
+ * @brief Configure a DMA channel to write emitter commands to a GPIO port.
+ *
+ * The transfer is circular so the emitters sequence repeats on every sweep
+ * without CPU intervention.
  *
- * @param[in] emitter Emitter type.
+ * @param[in] channel DMA1 channel, triggered by a TIM1 compare event.
+ * @param[in] bsrr Address of the GPIO port BSRR register.
+ * @param[in] sequence Emitter commands for each slot.
  */
-static void set_emitter_off(uint8_t emitter)
+static void setup_emitters_dma(uint8_t channel, uint32_t bsrr,
+			       const uint32_t *sequence)
 {
-	switch (emitter) {
-	case SENSOR_SIDE_LEFT_ID:
-		gpio_clear(GPIOA, GPIO9);
-		break;
-	case SENSOR_SIDE_RIGHT_ID:
-		gpio_clear(GPIOB, GPIO8);
-		break;
-	case SENSOR_FRONT_LEFT_ID:
-		gpio_clear(GPIOA, GPIO8);
-		break;
-	case SENSOR_FRONT_RIGHT_ID:
-		gpio_clear(GPIOB, GPIO9);
-		break;
-	default:
-		break;
-	}
+	dma_channel_reset(DMA1, channel);
+
+	dma_set_peripheral_address(DMA1, channel, bsrr);
+	dma_set_memory_address(DMA1, channel, (uint32_t)sequence);
+	dma_set_number_of_data(DMA1, channel, SENSORS_SWEEP_SLOTS);
+	dma_set_read_from_memory(DMA1, channel);
+	dma_enable_memory_increment_mode(DMA1, channel);
+	dma_enable_circular_mode(DMA1, channel);
+	dma_set_peripheral_size(DMA1, channel, DMA_CCR_PSIZE_32BIT);
+	dma_set_memory_size(DMA1, channel, DMA_CCR_MSIZE_32BIT);
+	dma_set_priority(DMA1, channel, DMA_CCR_PL_HIGH);
+
+	dma_enable_channel(DMA1, channel);
 }
 
 /**
- * @brief State machine to manage the sensors activation and deactivation
- * states and readings.
+ * @brief Start the hardware-sequenced sensors sweep.
  *
  * In order to get accurate distance values, the phototransistor's output
  * will be read with the infrared emitter sensors powered on and powered
  * off. Besides, to avoid undesired interactions between different emitters and
  * phototranistors, the reads will be done one by one.
  *
- * 1. Start phototransistor ADC reading (emitter is off)
- * 2. Save phototransistor reading and turn emitter on
- * 3. Start phototransistor ADC reading (emitter is on)
- * 4. Save phototransistor reading and turn emitter off
+ * The whole sequence is driven by TIM1 (see `setup_emitters()`) without CPU
+ * intervention. On each slot:
+ *
+ * 1. TIM1 compare events 3 and 4 trigger DMA1 channels 6 and 4 to write the
+ *    slot emitter commands to GPIOB and GPIOA.
+ * 2. TIM1 compare event 1 triggers the next ADC1 regular conversion
+ *    (discontinuous mode, one channel per trigger).
+ * 3. DMA1 channel 1 moves the conversion result to `sweep`.
+ *
+ * An interruption is generated on each half sweep, when a pair of sensors
+ * has been read with the emitter off and on. Which pairs are read on each
+ * sweep depends on the schedule (see `set_sensors_schedule()`).
+ *
+ * @note The ADC is powered off and on to make sure the regular sequence starts
+ * from the first slot, aligned with the emitters sequence.
+ */
+void start_sensors_sweep(void)
+{
+	stop_sensors_sweep();
+
+	adc_power_on(ADC1);
+	for (int i = 0; i < 100; i++)
+		__asm__("nop");
+	adc_reset_calibration(ADC1);
+	adc_calibrate(ADC1);
+
+	active_schedule = requested_schedule;
+	schedule_phase = 0;
+	prepare_sweep();
+
+	setup_emitters_dma(DMA_CHANNEL4, (uint32_t)&GPIOA_BSRR, emitters_gpioa);
+	setup_emitters_dma(DMA_CHANNEL6, (uint32_t)&GPIOB_BSRR, emitters_gpiob);
+
+	dma_channel_reset(DMA1, DMA_CHANNEL1);
+
+	dma_set_peripheral_address(DMA1, DMA_CHANNEL1, (uint32_t)&ADC1_DR);
+	dma_set_memory_address(DMA1, DMA_CHANNEL1, (uint32_t)sweep);
+	dma_set_number_of_data(DMA1, DMA_CHANNEL1, SENSORS_SWEEP_SLOTS);
+	dma_set_read_from_peripheral(DMA1, DMA_CHANNEL1);
+	dma_enable_memory_increment_mode(DMA1, DMA_CHANNEL1);
+	dma_enable_circular_mode(DMA1, DMA_CHANNEL1);
+	dma_set_peripheral_size(DMA1, DMA_CHANNEL1, DMA_CCR_PSIZE_16BIT);
+	dma_set_memory_size(DMA1, DMA_CHANNEL1, DMA_CCR_MSIZE_16BIT);
+	dma_set_priority(DMA1, DMA_CHANNEL1, DMA_CCR_PL_VERY_HIGH);
+
+	dma_enable_half_transfer_interrupt(DMA1, DMA_CHANNEL1);
+	dma_enable_transfer_complete_interrupt(DMA1, DMA_CHANNEL1);
+
+	dma_enable_channel(DMA1, DMA_CHANNEL1);
+
+	adc_enable_dma(ADC1);
+}
+
+/**
+ * @brief Stop the sensors sweep and turn all emitters off.
+ *
+ * Required before using TIM1 for anything else (i.e.: the speaker).
  */
-static void sm_emitter_adc(void)
+void stop_sensors_sweep(void)
 {
-	static uint8_t emitter_status = 1;
-	static uint8_t sensor_index = SENSOR_SIDE_LEFT_ID;
-
-	switch (emitter_status) {
-	case 1:
-		adc_start_conversion_injected(ADC1);
-		emitter_status = 2;
-		break;
-	case 2:
-		sensors_off[sensor_index] =
-		    adc_read_injected(ADC1, (sensor_index + 1));
-		set_emitter_on(sensor_index);
-		emitter_status = 3;
-		break;
-	case 3:
-		adc_start_conversion_injected(ADC1);
-		emitter_status = 4;
-		break;
-	case 4:
-		sensors_on[sensor_index] =
-		    adc_read_injected(ADC1, (sensor_index + 1));
-		set_emitter_off(sensor_index);
-		emitter_status = 1;
-		if (sensor_index == (NUM_SENSOR - 1))
-			sensor_index = 0;
-		else
-			sensor_index++;
-		break;
-	default:
-		break;
+	dma_disable_channel(DMA1, DMA_CHANNEL1);
+	dma_disable_channel(DMA1, DMA_CHANNEL4);
+	dma_disable_channel(DMA1, DMA_CHANNEL6);
+	adc_disable_dma(ADC1);
+	adc_power_off(ADC1);
+
+	gpio_clear(GPIOA, GPIO8 | GPIO9);
+	gpio_clear(GPIOB, GPIO8 | GPIO9);
+}
+
+/**
+ * @brief Publish a half sweep as the latest sensors snapshot.
+ *
+ * The readings of the pair of sensors read on the half sweep are updated, and
+ * the latest readings of every sensor published. The snapshot is written on a
+ * buffer which is not the latest published one, so readers copying the latest
+ * snapshot are not affected. The sequence of the buffer is invalidated while
+ * writing, which allows readers to detect if the buffer they were copying has
+ * been overwritten.
+ *
+ * @param[in] half Half sweep completed (0 for the first one).
+ */
+static void publish_sensors_snapshot(uint8_t half)
+{
+	uint8_t i;
+	uint8_t next;
+	uint8_t sensor;
+	uint8_t fresh = 0;
+	volatile struct sensors_snapshot *snapshot;
+
+	for (i = 0; i < 2; i++) {
+		sensor = pairs[sweep_pairs[half]][i];
+		latest_off[sensor] = sweep[4 * half + 2 * i];
+		latest_on[sensor] = sweep[4 * half + 2 * i + 1];
+		fresh |= 1 << sensor;
 	}
+
+	next = (latest_snapshot + 1) % SENSORS_SNAPSHOTS;
+	snapshot = &snapshots[next];
+
+	snapshot->sequence = 0;
+	snapshot->timestamp = read_cycle_counter();
+	for (i = 0; i < NUM_SENSOR; i++) {
+		snapshot->off[i] = latest_off[i];
+		snapshot->on[i] = latest_on[i];
+	}
+	snapshot->fresh = fresh;
+	if (++snapshot_sequence == 0)
+		snapshot_sequence = 1;
+	snapshot->sequence = snapshot_sequence;
+	latest_snapshot = next;
 }
 
 /**
- * @brief TIM1 interruption routine.
+ * @brief DMA 1 channel 1 interruption routine.
+ *
+ * Executed twice per sensors sweep, when half and all ADC readings have been
+ * moved to `sweep`. Clears the interruption flags and publishes the sensors
+ * readings. After the whole sweep, the next one is prepared with the schedule
+ * requested.
  *
- * - Manage the update event interruption flag.
- * - Trigger state machine to manage sensors.
+ * @note The next sweep will not overwrite the first slot, nor read the first
+ * emitter commands, until the next TIM1 period, which leaves plenty of time
+ * to complete this routine.
  */
-void tim1_up_isr(void)
+void dma1_channel1_isr(void)
 {
-	if (timer_get_flag(TIM1, TIM_SR_UIF)) {
-		timer_clear_flag(TIM1, TIM_SR_UIF);
-		sm_emitter_adc();
+	if (dma_get_interrupt_flag(DMA1, DMA_CHANNEL1, DMA_HTIF)) {
+		dma_clear_interrupt_flags(DMA1, DMA_CHANNEL1, DMA_HTIF);
+		publish_sensors_snapshot(0);
+	}
+	if (!dma_get_interrupt_flag(DMA1, DMA_CHANNEL1, DMA_TCIF))
+		return;
+	dma_clear_interrupt_flags(DMA1, DMA_CHANNEL1, DMA_TCIF);
+	publish_sensors_snapshot(1);
+
+	schedule_phase = (schedule_phase + 2) % SENSORS_SCHEDULE_HALVES;
+	if (requested_schedule != active_schedule) {
+		active_schedule = requested_schedule;
+		schedule_phase = 0;
 	}
+	prepare_sweep();
+}
+
+/**
+ * @brief Copy a snapshot buffer, if not overwritten while copying.
+ *
+ * @return Whether the snapshot was published and copied as a whole.
+ */
+static bool copy_sensors_snapshot(volatile struct sensors_snapshot *source,
+				  struct sensors_snapshot *snapshot)
+{
+	uint8_t i;
+	uint32_t sequence = source->sequence;
+
+	snapshot->timestamp = source->timestamp;
+	for (i = 0; i < NUM_SENSOR; i++) {
+		snapshot->off[i] = source->off[i];
+		snapshot->on[i] = source->on[i];
+	}
+	snapshot->fresh = source->fresh;
+	snapshot->sequence = sequence;
+	return sequence && sequence == source->sequence;
+}
+
+/**
+ * @brief Get the latest sensors snapshot.
+ *
+ * The snapshot is lock-free: interruptions are never disabled. If the
+ * snapshot being copied is overwritten in the middle of the copy (i.e.: the
+ * reader was preempted for more than `SENSORS_SNAPSHOTS - 1` half sweeps) the
+ * copy is simply retried, so the on and off readings always belong to the
+ * same sweep.
+ *
+ * Readers can compare the snapshot `sequence` with the one they previously
+ * got to skip stale snapshots. A `sequence` of `0` means no sweep has been
+ * completed yet.
+ *
+ * @param[out] snapshot Latest sensors snapshot.
+ */
+void get_sensors_snapshot(struct sensors_snapshot *snapshot)
+{
+	while (!copy_sensors_snapshot(&snapshots[latest_snapshot], snapshot)) {
+		if (!snapshot_sequence)
+			return;
+	}
+}
+
+/**
+ * @brief Get the latest sensors snapshots, newest first.
+ *
+ * Snapshots are copied as long as they are consecutive, so the history stops
+ * at the first one overwritten while copying (i.e.: the reader was preempted
+ * for too long) or not yet published.
+ *
+ * @param[out] history Latest snapshots, newest first.
+ * @param[in] count Number of snapshots to copy, at most
+ * `SENSORS_SNAPSHOTS - 1` (the oldest buffer is the next one written).
+ *
+ * @return Number of snapshots copied.
+ */
+uint8_t get_sensors_history(struct sensors_snapshot *history, uint8_t count)
+{
+	uint8_t latest = latest_snapshot;
+	uint8_t i;
+
+	if (count > SENSORS_SNAPSHOTS - 1)
+		count = SENSORS_SNAPSHOTS - 1;
+	for (i = 0; i < count; i++) {
+		if (!copy_sensors_snapshot(
+			&snapshots[(latest + SENSORS_SNAPSHOTS - i) %
+				   SENSORS_SNAPSHOTS],
+			&history[i]))
+			break;
+		if (i && history[i].sequence != history[i - 1].sequence - 1)
+			break;
+	}
+	return i;
+}
+
+/**
+ * @brief Get the sequence number of the latest sensors snapshot.
+ */
+uint32_t get_sensors_sequence(void)
+{
+	return snapshot_sequence;
 }
 
 /**
  * @brief Get sensors values with emitter on and off.
  *
+ * Both readings always belong to the same sweep.
+ *
  * @param[out] on Raw sensors reading with emitter on.
  * @param[out] off Raw sensors reading with emitter off.
  */
 void get_sensors_raw(uint16_t *on, uint16_t *off)
 {
 	uint8_t i = 0;
+	struct sensors_snapshot snapshot;
 
+	get_sensors_snapshot(&snapshot);
 	for (i = 0; i < NUM_SENSOR; i++) {
-		off[i] = sensors_off[i];
-		on[i] = sensors_on[i];
+		off[i] = snapshot.off[i];
+		on[i] = snapshot.on[i];
 	}
 }
 
 /**
- * @brief Apply `log()` to the raw sensor readings.
+ * @brief Apply `log()` to the raw sensor readings, in fixed point.
+ *
+ * The `log_table` is generated at build time (see `scripts/log_table.py`)
+ * with steps of size `LOG_TABLE_STEP`. Values between steps are linearly
+ * interpolated.
  *
- * A minimum difference of `1` is enforced to avoid applying `log()` to a zero
- * or negative value.
+ * A minimum difference of `LOG_TABLE_STEP` is enforced to avoid applying
+ * `log()` to a zero or negative value.
  *
  * @param[in] on Raw sensor reading with emitter on.
  * @param[in] off Raw sensor reading with emitter off.
+ * @return The log value with `SENSORS_LOG_Q` fractional bits.
  */
-float sensors_raw_log(uint16_t on, uint16_t off)
+uint16_t sensors_raw_log_fixed(uint16_t on, uint16_t off)
 {
 	uint16_t diff;
+	uint16_t index;
+	uint16_t fraction;
+	uint16_t low;
 
-	if (off > on)
-		diff = 0;
+	if (off + LOG_TABLE_STEP > on)
+		diff = LOG_TABLE_STEP;
 	else
 		diff = on - off;
-	diff /= LOG_CONVERSION_TABLE_STEP;
-	if (diff == 0)
-		diff = 1;
-	return log_conversion[diff];
+	index = diff / LOG_TABLE_STEP;
+	fraction = diff % LOG_TABLE_STEP;
+	low = log_table[index];
+	if (fraction == 0)
+		return low;
+	return low + ((log_table[index + 1] - low) * fraction) / LOG_TABLE_STEP;
+}
+
+/**
+ * @brief Calculate the distance to an obstacle, in fixed point.
+ *
+ * The distance is calculated as \f$\frac{A}{log(on - off)} - B\f$, where `A`
+ * and `B` are the sensor calibration constants.
+ *
+ * Only integer operations are used (the Cortex-M3 has hardware division).
+ *
+ * @param[in] sensor Sensor ID.
+ * @param[in] on Raw sensor reading with emitter on.
+ * @param[in] off Raw sensor reading with emitter off.
+ * @return The distance, in meters, with `SENSORS_DISTANCE_Q` fractional bits.
+ *
+ * @note Calibration `A` constants must be lower than `SENSORS_CALIBRATION_MAX`
+ * to avoid overflows (see `set_sensors_calibration()`).
+ */
+int32_t sensors_distance_fixed(uint8_t sensor, uint16_t on, uint16_t off)
+{
+	uint32_t ratio;
+
+	ratio = (calibration_a_fixed[sensor] << SENSORS_LOG_Q) /
+		sensors_raw_log_fixed(on, off);
+	return (int32_t)ratio - calibration_b_fixed[sensor];
+}
+
+/**
+ * @brief Get the distances of the latest sensors readings, in fixed point.
+ *
+ * This is the control path entry point of the fixed point pipeline: only
+ * integer operations are used, in any build.
+ *
+ * @param[out] distances Distances, indexed by sensor ID, in meters with
+ * `SENSORS_DISTANCE_Q` fractional bits.
+ */
+void get_sensors_distances_fixed(int32_t *distances)
+{
+	uint16_t on[NUM_SENSOR];
+	uint16_t off[NUM_SENSOR];
+	uint8_t i;
+
+	get_sensors_raw(on, off);
+	for (i = 0; i < NUM_SENSOR; i++)
+		distances[i] = sensors_distance_fixed(i, on[i], off[i]);
+}
+
+/**
+ * @brief Apply `log()` to the raw sensor readings.
+ *
+ * @see `sensors_raw_log_fixed()`.
+ *
+ * @param[in] on Raw sensor reading with emitter on.
+ * @param[in] off Raw sensor reading with emitter off.
+ */
+float sensors_raw_log(uint16_t on, uint16_t off)
+{
+	return (float)sensors_raw_log_fixed(on, off) / (1 << SENSORS_LOG_Q);
+}
+
+/**
+ * @brief Calculate the distance to an obstacle.
+ *
+ * The distance is calculated as \f$\frac{A}{log(on - off)} - B\f$, where `A`
+ * and `B` are the sensor calibration constants.
+ *
+ * When `SENSORS_FIXED_POINT` is defined, the calculation is performed in fixed
+ * point and only the result is converted to floating point. Callers that can
+ * work in fixed point should use `sensors_distance_fixed()` instead.
+ *
+ * @param[in] sensor Sensor ID.
+ * @param[in] on Raw sensor reading with emitter on.
+ * @param[in] off Raw sensor reading with emitter off.
+ * @return The distance, in meters.
+ */
+float sensors_distance(uint8_t sensor, uint16_t on, uint16_t off)
+{
+#ifdef SENSORS_FIXED_POINT
+	return (float)sensors_distance_fixed(sensor, on, off) /
+	       (1 << SENSORS_DISTANCE_Q);
+#else
+	return calibration_a[sensor] / sensors_raw_log(on, off) -
+	       calibration_b[sensor];
+#endif
+}
+
+/**
+ * @brief Get the calibration constants of a sensor.
+ *
+ * @param[in] sensor Sensor ID.
+ * @param[out] a Calibration constant A.
+ * @param[out] b Calibration constant B.
+ */
+void get_sensors_calibration(uint8_t sensor, float *a, float *b)
+{
+	*a = calibration_a[sensor];
+	*b = calibration_b[sensor];
+}
+
+/**
+ * @brief Whether calibration constants are within the fixed point range.
+ *
+ * `A` must be positive and lower than `SENSORS_CALIBRATION_MAX`, and `B` lower
+ * than it in magnitude. Not-a-number values are never valid.
+ *
+ * @param[in] a Calibration constant A.
+ * @param[in] b Calibration constant B.
+ */
+bool sensors_calibration_valid(float a, float b)
+{
+	return a > 0. && a < SENSORS_CALIBRATION_MAX &&
+	       fabsf(b) < SENSORS_CALIBRATION_MAX;
+}
+
+/**
+ * @brief Set the calibration constants of a sensor.
+ *
+ * Both floating and fixed point versions are updated. Constants out of the
+ * fixed point range are rejected (see `sensors_calibration_valid()`), and the
+ * current ones are kept.
+ *
+ * @param[in] sensor Sensor ID.
+ * @param[in] a Calibration constant A.
+ * @param[in] b Calibration constant B.
+ *
+ * @return Whether the constants were set or not.
+ */
+bool set_sensors_calibration(uint8_t sensor, float a, float b)
+{
+	if (!sensors_calibration_valid(a, b))
+		return false;
+	calibration_a[sensor] = a;
+	calibration_b[sensor] = b;
+	calibration_a_fixed[sensor] = SENSORS_DISTANCE_FIXED(a);
+	calibration_b_fixed[sensor] = SENSORS_DISTANCE_FIXED(b);
+	return true;
+}
+
+/**
+ * @brief Request a sensors schedule, applied from the next sweep.
+ *
+ * @param[in] schedule Schedule ID (i.e.: `SENSORS_SCHEDULE_SIDE`).
+ */
+void set_sensors_schedule(uint8_t schedule)
+{
+	if (schedule < SENSORS_SCHEDULES)
+		requested_schedule = schedule;
+}
+
+/**
+ * @brief Enable or disable the automatic schedule selection.
+ *
+ * @see update_sensors_schedule()
+ */
+void set_sensors_schedule_auto(bool enabled)
+{
+	schedule_auto = enabled;
+}
+
+/**
+ * @brief Get the sensors schedule requested.
+ */
+uint8_t get_sensors_schedule(void)
+{
+	return requested_schedule;
+}
+
+/**
+ * @brief Whether the sensors schedule is selected automatically.
+ */
+bool get_sensors_schedule_auto(void)
+{
+	return schedule_auto;
+}
+
+/**
+ * @brief Choose the sensors schedule for the movement phase.
+ *
+ * Side walls are what matters on straights, for the angular correction and
+ * the wall posts, while the front wall distance is what matters when braking
+ * to stop or turn in front of it.
+ *
+ * @param[in] linear_speed Target linear speed, in m/s.
+ * @param[in] linear_acceleration Target linear acceleration, in m/s^2.
+ * @param[in] angular_speed Target angular speed, in rad/s.
+ */
+uint8_t sensors_schedule_for_motion(float linear_speed,
+				    float linear_acceleration,
+				    float angular_speed)
+{
+	if (linear_speed <= 0. ||
+	    fabsf(angular_speed) > SENSORS_SCHEDULE_TURN_SPEED)
+		return SENSORS_SCHEDULE_ALL;
+	if (linear_acceleration < -SENSORS_SCHEDULE_DECELERATION)
+		return SENSORS_SCHEDULE_FRONT;
+	return SENSORS_SCHEDULE_SIDE;
+}
+
+/**
+ * @brief Select the sensors schedule from the target speeds, if automatic.
+ *
+ * To be called on each SysTick, after the control loop.
+ */
+void update_sensors_schedule(void)
+{
+	static float last_linear_speed;
+	float linear_speed = get_target_linear_speed();
+	float linear_acceleration =
+		(linear_speed - last_linear_speed) * SYSTICK_FREQUENCY_HZ;
+
+	last_linear_speed = linear_speed;
+	if (!schedule_auto)
+		return;
+	set_sensors_schedule(sensors_schedule_for_motion(
+		linear_speed, linear_acceleration, get_target_angular_speed()));
+}
+
+/**
+ * @brief Accumulate the wall votes of a sensor latest readings.
+ *
+ * Each reading votes from -`SENSORS_WALL_MARGIN` (no wall) to
+ * `SENSORS_WALL_MARGIN` (wall), with its distance to the threshold. Votes are
+ * in fixed point (see `sensors_distance_fixed()`), so no floating point
+ * operation is performed per reading.
+ *
+ * @param[in] history Snapshots history, newest first.
+ * @param[in] count Number of snapshots in the history.
+ * @param[in] sensor Sensor ID.
+ * @param[in] threshold Wall detection threshold, with `SENSORS_DISTANCE_Q`.
+ * @param[in,out] votes Sum of the votes, with `SENSORS_DISTANCE_Q`.
+ * @param[in,out] samples Number of readings.
+ */
+static void accumulate_wall_votes(struct sensors_snapshot *history,
+				  uint8_t count, uint8_t sensor,
+				  int32_t threshold, int32_t *votes,
+				  uint8_t *samples)
+{
+	const int32_t margin = SENSORS_DISTANCE_FIXED(SENSORS_WALL_MARGIN);
+	uint8_t used = 0;
+	int32_t vote;
+	uint8_t i;
+
+	for (i = 0; i < count && used < SENSORS_WALL_SAMPLES; i++) {
+		if (!(history[i].fresh & (1 << sensor)))
+			continue;
+		vote = threshold -
+		       sensors_distance_fixed(sensor, history[i].on[sensor],
+					      history[i].off[sensor]);
+		if (vote > margin)
+			vote = margin;
+		else if (vote < -margin)
+			vote = -margin;
+		*votes += vote;
+		used++;
+	}
+	*samples += used;
+}
+
+/**
+ * @brief Decide on a wall from the sum of votes.
+ *
+ * The confidence is the mean vote, from 0 to 1.
+ */
+static struct wall_detection decide_wall(int32_t votes, uint8_t samples)
+{
+	struct wall_detection detection = {false, 0., samples};
+
+	if (!samples)
+		return detection;
+	detection.present = votes > 0;
+	detection.confidence =
+		(float)abs(votes) /
+		(samples * SENSORS_DISTANCE_FIXED(SENSORS_WALL_MARGIN));
+	return detection;
+}
+
+/**
+ * @brief Detect the walls around, with a confidence for each one.
+ *
+ * A single reading tells whether a wall is there, but not how much that can
+ * be trusted. Up to `SENSORS_WALL_SAMPLES` readings of each sensor are taken
+ * from the snapshots history instead, which is more readings the higher the
+ * sensor sampling rate is (see `set_sensors_schedule()`). Readings close to
+ * the threshold, or disagreeing, lower the confidence. The front wall is
+ * decided with the readings of both front sensors.
+ */
+struct walls_detection sensors_walls_detection(void)
+{
+	struct sensors_snapshot history[SENSORS_SNAPSHOTS - 1];
+	const int32_t side =
+		SENSORS_DISTANCE_FIXED(SENSORS_SIDE_WALL_DISTANCE);
+	const int32_t front =
+		SENSORS_DISTANCE_FIXED(SENSORS_FRONT_WALL_DISTANCE);
+	struct walls_detection walls;
+	uint8_t count;
+	int32_t votes;
+	uint8_t samples;
+
+	count = get_sensors_history(history, SENSORS_SNAPSHOTS - 1);
+
+	votes = 0;
+	samples = 0;
+	accumulate_wall_votes(history, count, SENSOR_SIDE_LEFT_ID, side,
+			      &votes, &samples);
+	walls.left = decide_wall(votes, samples);
+
+	votes = 0;
+	samples = 0;
+	accumulate_wall_votes(history, count, SENSOR_SIDE_RIGHT_ID, side,
+			      &votes, &samples);
+	walls.right = decide_wall(votes, samples);
+
+	votes = 0;
+	samples = 0;
+	accumulate_wall_votes(history, count, SENSOR_FRONT_LEFT_ID, front,
+			      &votes, &samples);
+	accumulate_wall_votes(history, count, SENSOR_FRONT_RIGHT_ID, front,
+			      &votes, &samples);
+	walls.front = decide_wall(votes, samples);
+
+	return walls;
 }
@@ -1,12 +1,20 @@
 #ifndef __DETECTION_H
 #define __DETECTION_H
 
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
 #include <libopencm3/cm3/nvic.h>
 #include <libopencm3/stm32/adc.h>
+#include <libopencm3/stm32/dma.h>
 #include <libopencm3/stm32/gpio.h>
 #include <libopencm3/stm32/timer.h>
 
+#include "mmlib/control.h"
+
 #include "config.h"
+#include "platform.h"
 #include "setup.h"
 
 /* Sensors IDs*/
@@ -17,7 +25,123 @@
 #define NUM_SENSOR 4
 #define SENSORS_SM_TICKS 4
 
+/** Sensors sweep: one reading with emitter off and one with emitter on */
+#define SENSORS_SWEEP_SLOTS (2 * NUM_SENSOR)
+
+/**
+ * Sensors schedules IDs.
+ *
+ * Each half sweep reads a pair of sensors (sides or fronts). Schedules are
+ * cycles of `SENSORS_SCHEDULE_HALVES` half sweeps, reading every sensor at
+ * the same rate or the prioritized pair three times as often as the other.
+ */
+#define SENSORS_SCHEDULE_ALL 0
+#define SENSORS_SCHEDULE_SIDE 1
+#define SENSORS_SCHEDULE_FRONT 2
+#define SENSORS_SCHEDULES 3
+#define SENSORS_SCHEDULE_HALVES 4
+
+/**
+ * Automatic schedule selection: the side sensors are prioritized on
+ * straights and the front sensors when braking harder than the deceleration
+ * threshold, in m/s^2. Every sensor is read at the same rate when stopped or
+ * turning faster than the angular speed threshold, in rad/s.
+ */
+#define SENSORS_SCHEDULE_DECELERATION 0.5
+#define SENSORS_SCHEDULE_TURN_SPEED 1.
+
+/** Snapshots kept, two per sweep, of which all but one can be read */
+#define SENSORS_SNAPSHOTS 16
+
+/**
+ * Fixed point fractional bits for the log values and the distances.
+ *
+ * `sensors_distance()` is calculated in fixed point if `SENSORS_FIXED_POINT`
+ * is defined (i.e.: compiling with `make SENSORS_FIXED_POINT=1`). Control code
+ * should read the fixed point distances directly in that build (see
+ * `get_sensors_distances_fixed()`), as the float result adds a conversion.
+ */
+#define SENSORS_LOG_Q 12
+#define SENSORS_DISTANCE_Q 16
+#define SENSORS_DISTANCE_FIXED(x) ((int32_t)((x) * (1 << SENSORS_DISTANCE_Q)))
+
+/**
+ * Calibration constants bound. `A` must be positive and lower than it, as it
+ * is shifted `SENSORS_LOG_Q` bits in fixed point (see
+ * `sensors_distance_fixed()`), and `B` must be lower than it in magnitude.
+ */
+#define SENSORS_CALIBRATION_MAX 16
+
+/**
+ * Wall detection thresholds, in meters, at the cell entry border, and
+ * distance from the threshold for a reading to fully support a decision.
+ */
+#define SENSORS_SIDE_WALL_DISTANCE 0.13
+#define SENSORS_FRONT_WALL_DISTANCE 0.2
+#define SENSORS_WALL_MARGIN 0.02
+
+/** Readings of each sensor used for a wall detection, at most */
+#define SENSORS_WALL_SAMPLES 8
+
+/**
+ * Latest sensors readings, published after each half sweep.
+ *
+ * - Sequence number of the snapshot (increases by one on each half sweep).
+ * - Clock cycle counter when the half sweep was completed.
+ * - Latest raw sensors readings with emitter on and off.
+ * - Mask of the sensors (`1 << id`) read on this half sweep.
+ */
+struct sensors_snapshot {
+	uint32_t sequence;
+	uint32_t timestamp;
+	uint16_t on[NUM_SENSOR];
+	uint16_t off[NUM_SENSOR];
+	uint8_t fresh;
+};
+
+/**
+ * Wall detection from several readings of the snapshots history.
+ *
+ * - Whether the wall is present.
+ * - Confidence, from 0 (readings split around the threshold) to 1 (every
+ *   reading agrees, beyond `SENSORS_WALL_MARGIN`).
+ * - Number of readings used.
+ */
+struct wall_detection {
+	bool present;
+	float confidence;
+	uint8_t samples;
+};
+
+/** Detection of the left, front and right walls */
+struct walls_detection {
+	struct wall_detection left;
+	struct wall_detection front;
+	struct wall_detection right;
+};
+
+void start_sensors_sweep(void);
+void stop_sensors_sweep(void);
+void get_sensors_snapshot(struct sensors_snapshot *snapshot);
+uint8_t get_sensors_history(struct sensors_snapshot *history, uint8_t count);
+uint32_t get_sensors_sequence(void);
 void get_sensors_raw(uint16_t *on, uint16_t *off);
 float sensors_raw_log(uint16_t on, uint16_t off);
+float sensors_distance(uint8_t sensor, uint16_t on, uint16_t off);
+uint16_t sensors_raw_log_fixed(uint16_t on, uint16_t off);
+int32_t sensors_distance_fixed(uint8_t sensor, uint16_t on, uint16_t off);
+void get_sensors_distances_fixed(int32_t *distances);
+void get_sensors_calibration(uint8_t sensor, float *a, float *b);
+bool sensors_calibration_valid(float a, float b);
+bool set_sensors_calibration(uint8_t sensor, float a, float b);
+void set_sensors_schedule(uint8_t schedule);
+void set_sensors_schedule_auto(bool enabled);
+uint8_t get_sensors_schedule(void);
+bool get_sensors_schedule_auto(void);
+uint8_t sensors_schedule_for_motion(float linear_speed,
+				    float linear_acceleration,
+				    float angular_speed);
+void update_sensors_schedule(void);
+struct walls_detection sensors_walls_detection(void);
 
 #endif /* __DETECTION_H */
@@ -23,6 +23,9 @@ static uint16_t bytes_to_words(uint16_t num_bytes)
 /**
  * @brief Function to read EEPROM data from a specific address.
  *
+ * The maze (`FLASH_EEPROM_ADDRESS_MAZE`) is read from the storage. If it has
+ * never been saved, the output is filled as erased flash.
+ *
  * @param[in] start_address Address to read from.
  * @param[in] num_elements Number of bytes to be read.
  * @param[out] output_data Pointer to a buffer to save the read data.
@@ -33,6 +36,12 @@ void eeprom_read_data(uint32_t start_address, uint16_t num_bytes,
 	uint16_t iter;
 	uint32_t *memory_ptr = (uint32_t *)start_address;
 
+	if (start_address == FLASH_EEPROM_ADDRESS_MAZE) {
+		if (!storage_read(STORAGE_KEY_MAZE, output_data, num_bytes))
+			memset(output_data, 0xff, num_bytes);
+		return;
+	}
+
 	for (iter = 0; iter < bytes_to_words(num_bytes); iter++) {
 		*(uint32_t *)output_data = *(memory_ptr + iter);
 		output_data += BYTES_PER_WORD;
@@ -42,6 +51,11 @@ void eeprom_read_data(uint32_t start_address, uint16_t num_bytes,
 /**
  * @brief Function to save data on a page of EEPROM.
  *
+ * The maze (`FLASH_EEPROM_ADDRESS_MAZE`) is saved on the storage instead,
+ * which only appends the changes and does not erase a page on every save.
+ *
+ * For any other page:
+ *
  * - Unlock flash.
  * - Erase page.
  * - Program flash memory word by word (32-bits) and verify that it is
@@ -58,6 +72,9 @@ uint32_t eeprom_flash_page(uint32_t page_address, uint8_t *input_data,
 	uint16_t iter;
 	uint32_t flash_status = 0;
 
+	if (page_address == FLASH_EEPROM_ADDRESS_MAZE)
+		return storage_write(STORAGE_KEY_MAZE, input_data, num_bytes);
+
 	flash_unlock();
 
 	flash_erase_page(page_address);
@@ -84,6 +101,8 @@ uint32_t eeprom_flash_page(uint32_t page_address, uint8_t *input_data,
 /**
  * @brief Function to erase a page of EEPROM.
  *
+ * Erasing the maze (`FLASH_EEPROM_ADDRESS_MAZE`) erases it from the storage.
+ *
  * @param[in] page_address Address of the EEPROM page to erase.
  * @return Erase state.
  */
@@ -91,6 +110,9 @@ uint32_t eeprom_erase_page(uint32_t page_address)
 {
 	uint32_t erase_status = 0;
 
+	if (page_address == FLASH_EEPROM_ADDRESS_MAZE)
+		return storage_erase(STORAGE_KEY_MAZE);
+
 	flash_unlock();
 
 	flash_erase_page(page_address);
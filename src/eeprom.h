@@ -1,8 +1,13 @@
 #ifndef __EEPROM_H
 #define __EEPROM_H
 
+#include <string.h>
+
 #include <libopencm3/stm32/flash.h>
 
+#include "setup.h"
+#include "storage.h"
+
 /** Flash results */
 #define RESULT_OK 0
 #define FLASH_WRONG_DATA_WRITTEN 0x80
@@ -0,0 +1,204 @@
+#include "encoders.h"
+
+static volatile struct encoder_edge left_edge;
+static volatile struct encoder_edge right_edge;
+static volatile struct encoder left = {.timer = TIM2};
+static volatile struct encoder right = {.timer = TIM4};
+
+/**
+ * @brief Timestamp a captured encoder edge.
+ *
+ * The counter value is latched by the input capture on the edge itself, so
+ * only the timestamp depends on the interruption latency. Reading the capture
+ * register clears the interruption flag.
+ */
+static void capture_edge(uint32_t timer, volatile struct encoder_edge *edge)
+{
+	edge->timestamp = read_cycle_counter();
+	edge->raw = (uint16_t)TIM_CCR1(timer);
+	edge->sequence++;
+}
+
+/**
+ * @brief TIM2 interruption routine, left encoder edge captured.
+ */
+void tim2_isr(void)
+{
+	capture_edge(TIM2, &left_edge);
+}
+
+/**
+ * @brief TIM4 interruption routine, right encoder edge captured.
+ */
+void tim4_isr(void)
+{
+	capture_edge(TIM4, &right_edge);
+}
+
+/**
+ * @brief Get the latest captured edge of an encoder.
+ *
+ * The copy is retried if an edge is captured in the middle of it.
+ */
+static void get_edge(volatile struct encoder_edge *edge,
+		     struct encoder_edge *sample)
+{
+	uint32_t sequence;
+
+	do {
+		sequence = edge->sequence;
+		sample->timestamp = edge->timestamp;
+		sample->raw = edge->raw;
+	} while (sequence != edge->sequence);
+	sample->sequence = sequence;
+}
+
+/**
+ * @brief Enable or disable the edge capture interruptions of an encoder.
+ *
+ * The reference edge is discarded when disabling, as edges are no longer
+ * timestamped. Input capture is always enabled, so the capture flag is
+ * cleared before enabling the interruption: an edge captured while it was
+ * disabled would otherwise trigger it right away, with a stale counter value
+ * and a late timestamp.
+ */
+static void set_edge_timing(volatile struct encoder *encoder, bool timing)
+{
+	if (timing == encoder->timing)
+		return;
+	encoder->timing = timing;
+	encoder->reference_valid = false;
+	if (timing) {
+		timer_clear_flag(encoder->timer, TIM_SR_CC1IF);
+		timer_enable_irq(encoder->timer, TIM_DIER_CC1IE);
+	} else {
+		timer_disable_irq(encoder->timer, TIM_DIER_CC1IE);
+	}
+}
+
+/**
+ * @brief Speed between two encoder events, in meters per second.
+ */
+static float edge_speed(int32_t counts, uint32_t cycles)
+{
+	return counts * get_micrometers_per_count() / MICROMETERS_PER_METER *
+	       SYSCLK_FREQUENCY_HZ / cycles;
+}
+
+/**
+ * @brief Update an encoder count and speed.
+ *
+ * The 16-bit timer counter is extended to 32 bits accumulating its
+ * difference with the previous tick, which never overflows at the maximum
+ * speed of the mouse.
+ *
+ * At high speed the speed is estimated from the count difference between
+ * ticks. Below `ENCODER_EDGE_TIMING_MAX_SPEED` the count difference is only a
+ * few counts per tick, so the speed is estimated from the time between
+ * captured edges instead, until the speed exceeds it by
+ * `ENCODER_EDGE_TIMING_HYSTERESIS`. When no edge has been captured since the
+ * previous tick, the speed cannot be higher than one edge spacing over the
+ * time since the last edge, and it is limited accordingly until a new edge
+ * arrives.
+ *
+ * @param[in] encoder Encoder to update.
+ * @param[in] edge Last edge captured for that encoder.
+ * @param[in] now Clock cycle counter at the beginning of the update.
+ */
+static void update_encoder(volatile struct encoder *encoder,
+			   volatile struct encoder_edge *edge, uint32_t now)
+{
+	struct encoder_edge sample;
+	uint16_t raw;
+	int32_t edge_count;
+	float count_speed;
+	float threshold;
+	float bound;
+
+	raw = (uint16_t)timer_get_counter(encoder->timer);
+	encoder->count += (int16_t)(raw - encoder->last_raw);
+	encoder->last_raw = raw;
+	count_speed = (encoder->count - encoder->last_count) *
+		      get_micrometers_per_count() / MICROMETERS_PER_METER *
+		      SYSTICK_FREQUENCY_HZ;
+	encoder->last_count = encoder->count;
+
+	threshold = ENCODER_EDGE_TIMING_MAX_SPEED;
+	if (encoder->timing)
+		threshold += ENCODER_EDGE_TIMING_HYSTERESIS;
+	if (fabsf(count_speed) > threshold) {
+		set_edge_timing(encoder, false);
+		encoder->speed = count_speed;
+		return;
+	}
+	set_edge_timing(encoder, true);
+
+	get_edge(edge, &sample);
+	if (sample.sequence != encoder->reference_sequence) {
+		edge_count = encoder->count - (int16_t)(raw - sample.raw);
+		if (encoder->reference_valid)
+			encoder->speed = edge_speed(
+			    edge_count - encoder->reference_count,
+			    sample.timestamp - encoder->reference_timestamp);
+		else
+			encoder->speed = count_speed;
+		encoder->reference_valid = true;
+		encoder->reference_sequence = sample.sequence;
+		encoder->reference_timestamp = sample.timestamp;
+		encoder->reference_count = edge_count;
+		return;
+	}
+	if (!encoder->reference_valid) {
+		encoder->speed = count_speed;
+		return;
+	}
+	bound = edge_speed(ENCODER_COUNTS_PER_EDGE,
+			   now - encoder->reference_timestamp);
+	if (fabsf(encoder->speed) > bound)
+		encoder->speed = copysignf(bound, encoder->speed);
+}
+
+/**
+ * @brief Update both encoders count and speed.
+ *
+ * To be called on each SysTick.
+ */
+void update_encoders(void)
+{
+	uint32_t now = read_cycle_counter();
+
+	update_encoder(&left, &left_edge, now);
+	update_encoder(&right, &right_edge, now);
+}
+
+/**
+ * @brief Return the left encoder count, extended to 32 bits.
+ */
+int32_t get_encoder_left_count(void)
+{
+	return left.count;
+}
+
+/**
+ * @brief Return the right encoder count, extended to 32 bits.
+ */
+int32_t get_encoder_right_count(void)
+{
+	return right.count;
+}
+
+/**
+ * @brief Return the left wheel speed estimation, in meters per second.
+ */
+float get_encoder_left_speed(void)
+{
+	return left.speed;
+}
+
+/**
+ * @brief Return the right wheel speed estimation, in meters per second.
+ */
+float get_encoder_right_speed(void)
+{
+	return right.speed;
+}
@@ -0,0 +1,67 @@
+#ifndef __ENCODERS_H
+#define __ENCODERS_H
+
+#include <math.h>
+#include <stdbool.h>
+
+#ifndef MMSIM_SIMULATION
+#include <libopencm3/stm32/timer.h>
+#endif
+
+#include "config.h"
+#include "platform.h"
+#include "setup.h"
+
+/** Encoder counts between consecutive captured edges (rising TI1 edges) */
+#define ENCODER_COUNTS_PER_EDGE 4
+
+/**
+ * Speed below which the speed is estimated from edge timing, in m/s. Edge
+ * timing is only disabled again above this speed plus the hysteresis, so
+ * the capture interruptions are not toggled on every tick around it.
+ */
+#define ENCODER_EDGE_TIMING_MAX_SPEED 0.15
+#define ENCODER_EDGE_TIMING_HYSTERESIS 0.03
+
+/**
+ * Last edge captured by an encoder timer.
+ *
+ * - Sequence number of the edge (increases by one on each capture).
+ * - Clock cycle counter when the edge was captured.
+ * - Encoder counter value captured on the edge.
+ */
+struct encoder_edge {
+	uint32_t sequence;
+	uint32_t timestamp;
+	uint16_t raw;
+};
+
+/**
+ * Encoder state, updated on each SysTick.
+ *
+ * - Timer peripheral and last 16-bit counter value read.
+ * - Count extended to 32 bits and its value on the previous tick.
+ * - Whether edge capture interruptions are enabled.
+ * - Reference edge for edge timing, with its extended count.
+ * - Latest speed estimation, in meters per second.
+ */
+struct encoder {
+	uint32_t timer;
+	uint16_t last_raw;
+	int32_t count;
+	int32_t last_count;
+	bool timing;
+	bool reference_valid;
+	uint32_t reference_sequence;
+	uint32_t reference_timestamp;
+	int32_t reference_count;
+	float speed;
+};
+
+void update_encoders(void);
+int32_t get_encoder_left_count(void);
+int32_t get_encoder_right_count(void);
+float get_encoder_left_speed(void);
+float get_encoder_right_speed(void);
+
+#endif /* __ENCODERS_H */
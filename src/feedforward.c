@@ -0,0 +1,66 @@
+#include "feedforward.h"
+
+/**
+ * @brief Motor voltage for a wheel speed and the force it must apply.
+ *
+ * DC motor model with the winding inductance neglected: the voltage is the
+ * resistive drop of the current producing the torque plus the back-EMF.
+ */
+static float wheel_voltage(float speed, float force)
+{
+	return force * FEEDFORWARD_VOLTS_PER_NEWTON +
+	       speed * FEEDFORWARD_VOLTS_PER_METER_PER_SECOND;
+}
+
+/**
+ * @brief Force applied on the floor by a wheel, from the motor model.
+ *
+ * Inverse of the model used in `feedforward_power()`.
+ *
+ * @param[in] power Motor power, in the `power_left()` range.
+ * @param[in] speed Wheel speed, in meters per second.
+ *
+ * @return The force, in newtons.
+ */
+float feedforward_force(int32_t power, float speed)
+{
+	float voltage =
+		get_motor_driver_input_voltage() * power / MAX_PWM_PERIOD;
+
+	return (voltage - speed * FEEDFORWARD_VOLTS_PER_METER_PER_SECOND) /
+	       FEEDFORWARD_VOLTS_PER_NEWTON;
+}
+
+/**
+ * @brief Compute the motor powers for a target velocity and acceleration.
+ *
+ * The forces each wheel must apply are derived from the mouse mass, for the
+ * linear acceleration, and from its moment of inertia, for the angular
+ * acceleration. The voltages from the motor model are then converted to PWM
+ * with the motor driver input voltage, so the control loop feedback only has
+ * to correct the residual error.
+ *
+ * @param[in] linear_velocity Target linear velocity, in meters per second.
+ * @param[in] linear_acceleration Target linear acceleration, in m/s^2.
+ * @param[in] angular_velocity Target angular velocity, in radians per second.
+ * @param[in] angular_acceleration Target angular acceleration, in rad/s^2.
+ * @param[out] left Left motor power, in the `power_left()` range.
+ * @param[out] right Right motor power, in the `power_right()` range.
+ */
+void feedforward_power(float linear_velocity, float linear_acceleration,
+		       float angular_velocity, float angular_acceleration,
+		       int32_t *left, int32_t *right)
+{
+	float linear_force = MOUSE_MASS * linear_acceleration / 2.;
+	float angular_force = MOUSE_MOMENT_OF_INERTIA * angular_acceleration /
+			      MOUSE_WHEELS_SEPARATION;
+	float tangential = angular_velocity * MOUSE_WHEELS_SEPARATION / 2.;
+	float scale = MAX_PWM_PERIOD / get_motor_driver_input_voltage();
+
+	*left = (int32_t)(wheel_voltage(linear_velocity - tangential,
+					linear_force - angular_force) *
+			  scale);
+	*right = (int32_t)(wheel_voltage(linear_velocity + tangential,
+					 linear_force + angular_force) *
+			   scale);
+}
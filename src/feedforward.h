@@ -0,0 +1,23 @@
+#ifndef __FEEDFORWARD_H
+#define __FEEDFORWARD_H
+
+#include <stdint.h>
+
+#include "setup.h"
+#include "voltage.h"
+
+/** Motor voltage to apply a force on the floor with a wheel, V/N */
+#define FEEDFORWARD_VOLTS_PER_NEWTON                                           \
+	(MOTOR_RESISTANCE * MOUSE_WHEEL_RADIUS /                               \
+	 (MOTOR_GEAR_RATIO * MOTOR_TORQUE_CONSTANT))
+
+/** Motor back-EMF for a wheel speed, V/(m/s) */
+#define FEEDFORWARD_VOLTS_PER_METER_PER_SECOND                                 \
+	(MOTOR_BACK_EMF_CONSTANT * MOTOR_GEAR_RATIO / MOUSE_WHEEL_RADIUS)
+
+float feedforward_force(int32_t power, float speed);
+void feedforward_power(float linear_velocity, float linear_acceleration,
+		       float angular_velocity, float angular_acceleration,
+		       int32_t *left, int32_t *right);
+
+#endif /* __FEEDFORWARD_H */
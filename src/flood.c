@@ -0,0 +1,376 @@
+#include "flood.h"
+
+static const uint8_t walls[4] = {FLOOD_EAST, FLOOD_SOUTH, FLOOD_WEST,
+				 FLOOD_NORTH};
+static const int8_t offsets[4] = {1, -FLOOD_MAZE_SIZE, -1, FLOOD_MAZE_SIZE};
+
+/** Packed bits of the east and north walls of each cell */
+#define PACKED_EAST 0x1
+#define PACKED_EAST_KNOWN 0x2
+#define PACKED_NORTH 0x4
+#define PACKED_NORTH_KNOWN 0x8
+
+/**
+ * Work queue, shared by all flood fill operations.
+ *
+ * Cells are pushed at most once while they are queued, so the circular
+ * queue never holds more than `FLOOD_MAZE_AREA` cells.
+ */
+static flood_cell_t queue[FLOOD_MAZE_AREA];
+static uint8_t queued[FLOOD_MAZE_AREA / 8];
+static uint16_t queue_head;
+static uint16_t queue_size;
+
+/** Cells invalidated by a new wall, waiting to be repaired */
+static flood_cell_t invalidated[FLOOD_MAZE_AREA];
+
+static void queue_push(uint16_t cell)
+{
+	if (queued[cell / 8] & (1 << (cell % 8)))
+		return;
+	queued[cell / 8] |= 1 << (cell % 8);
+	queue[(queue_head + queue_size++) % FLOOD_MAZE_AREA] =
+		(flood_cell_t)cell;
+}
+
+static uint16_t queue_pop(void)
+{
+	uint16_t cell = queue[queue_head];
+
+	queue_head = (queue_head + 1) % FLOOD_MAZE_AREA;
+	queue_size--;
+	queued[cell / 8] &= ~(1 << (cell % 8));
+	return cell;
+}
+
+/**
+ * @brief Return the index of a wall bit in `walls`.
+ */
+static uint8_t wall_index(uint8_t wall)
+{
+	uint8_t i;
+
+	for (i = 0; i < 3; i++)
+		if (walls[i] == wall)
+			break;
+	return i;
+}
+
+/**
+ * @brief Check whether a wall, indexed as in `walls`, is part of the maze
+ * border.
+ */
+static bool is_border(uint16_t cell, uint8_t i)
+{
+	switch (walls[i]) {
+	case FLOOD_EAST:
+		return cell % FLOOD_MAZE_SIZE == FLOOD_MAZE_SIZE - 1;
+	case FLOOD_WEST:
+		return cell % FLOOD_MAZE_SIZE == 0;
+	case FLOOD_NORTH:
+		return cell >= FLOOD_MAZE_AREA - FLOOD_MAZE_SIZE;
+	default:
+		return cell < FLOOD_MAZE_SIZE;
+	}
+}
+
+/**
+ * @brief Locate the packed bits of a wall, indexed as in `walls`.
+ *
+ * West and south walls are stored as the east and north walls of the
+ * neighbor cell.
+ *
+ * @param[in,out] cell Cell index, replaced by the cell storing the wall.
+ *
+ * @return The wall present bit (`PACKED_EAST` or `PACKED_NORTH`), the known
+ * bit being the next one.
+ */
+static uint8_t locate(uint16_t *cell, uint8_t i)
+{
+	if (walls[i] == FLOOD_WEST || walls[i] == FLOOD_SOUTH)
+		*cell += offsets[i];
+	if (walls[i] == FLOOD_EAST || walls[i] == FLOOD_WEST)
+		return PACKED_EAST;
+	return PACKED_NORTH;
+}
+
+static uint8_t packed_bits(struct flood *flood, uint16_t cell)
+{
+	return flood->walls[cell / 2] >> (cell % 2 * 4);
+}
+
+static void set_packed_bits(struct flood *flood, uint16_t cell, uint8_t mask,
+			    uint8_t bits)
+{
+	uint8_t shift = cell % 2 * 4;
+
+	flood->walls[cell / 2] &= ~(mask << shift);
+	flood->walls[cell / 2] |= bits << shift;
+}
+
+/**
+ * @brief Unpack the walls of a cell (i.e.: `FLOOD_EAST`).
+ *
+ * Used by the flood fill loops to check the four walls of a cell at once.
+ */
+static uint8_t unpack_walls(struct flood *flood, uint16_t cell)
+{
+	uint8_t x = cell % FLOOD_MAZE_SIZE;
+	uint8_t bits = packed_bits(flood, cell);
+	uint8_t cell_walls = 0;
+
+	if (x == FLOOD_MAZE_SIZE - 1 || bits & PACKED_EAST)
+		cell_walls |= FLOOD_EAST;
+	if (cell >= FLOOD_MAZE_AREA - FLOOD_MAZE_SIZE || bits & PACKED_NORTH)
+		cell_walls |= FLOOD_NORTH;
+	if (x == 0 || packed_bits(flood, cell - 1) & PACKED_EAST)
+		cell_walls |= FLOOD_WEST;
+	if (cell < FLOOD_MAZE_SIZE ||
+	    packed_bits(flood, cell - FLOOD_MAZE_SIZE) & PACKED_NORTH)
+		cell_walls |= FLOOD_SOUTH;
+	return cell_walls;
+}
+
+/**
+ * @brief Check whether a wall, indexed as in `walls`, is present.
+ */
+static bool has_wall(struct flood *flood, uint16_t cell, uint8_t i)
+{
+	uint8_t bit;
+
+	if (is_border(cell, i))
+		return true;
+	bit = locate(&cell, i);
+	return packed_bits(flood, cell) & bit;
+}
+
+/**
+ * @brief Return the lowest distance among the reachable neighbors.
+ */
+static flood_distance_t lowest_neighbor_distance(struct flood *flood,
+						 uint16_t cell)
+{
+	uint8_t cell_walls = unpack_walls(flood, cell);
+	flood_distance_t lowest = FLOOD_UNREACHABLE;
+	flood_distance_t distance;
+	uint8_t i;
+
+	for (i = 0; i < 4; i++) {
+		if (cell_walls & walls[i])
+			continue;
+		distance = flood->distances[cell + offsets[i]];
+		if (distance < lowest)
+			lowest = distance;
+	}
+	return lowest;
+}
+
+/**
+ * @brief Relax the neighbors of all queued cells, breadth first.
+ *
+ * Since all steps cost one cell, when the queue starts sorted by distance
+ * each cell is popped at most once. Otherwise cells are simply popped again
+ * after a lower distance is found, until the distances converge.
+ */
+static void propagate(struct flood *flood)
+{
+	flood_distance_t distance;
+	uint8_t cell_walls;
+	uint16_t cell;
+	uint16_t next;
+	uint8_t i;
+
+	while (queue_size) {
+		cell = queue_pop();
+		distance = flood->distances[cell] + 1;
+		cell_walls = unpack_walls(flood, cell);
+		for (i = 0; i < 4; i++) {
+			if (cell_walls & walls[i])
+				continue;
+			next = cell + offsets[i];
+			if (flood->distances[next] <= distance)
+				continue;
+			flood->distances[next] = distance;
+			queue_push(next);
+		}
+	}
+}
+
+/**
+ * @brief Reset the flood fill: no goals and only the maze outer walls.
+ */
+void flood_reset(struct flood *flood)
+{
+	memset(flood, 0, sizeof(*flood));
+	memset(flood->distances, 0xFF, sizeof(flood->distances));
+}
+
+/**
+ * @brief Set a cell as a goal.
+ *
+ * @note Distances are only updated on the next `flood_full()` call.
+ */
+void flood_set_goal(struct flood *flood, uint16_t cell)
+{
+	flood->goal[cell / 8] |= 1 << (cell % 8);
+}
+
+bool flood_is_goal(struct flood *flood, uint16_t cell)
+{
+	return flood->goal[cell / 8] & (1 << (cell % 8));
+}
+
+/**
+ * @brief Add a wall, shared by the two cells it separates, without updating
+ * the distances.
+ *
+ * @param[in] flood Flood fill state.
+ * @param[in] cell Cell index.
+ * @param[in] wall Wall bit (i.e.: `FLOOD_EAST`).
+ */
+void flood_add_wall(struct flood *flood, uint16_t cell, uint8_t wall)
+{
+	uint8_t i = wall_index(wall);
+	uint8_t bit;
+
+	if (is_border(cell, i))
+		return;
+	bit = locate(&cell, i);
+	set_packed_bits(flood, cell, bit | bit << 1, bit | bit << 1);
+}
+
+/**
+ * @brief Mark a wall as known to be missing, removing it if present.
+ *
+ * Maze border walls cannot be removed.
+ */
+void flood_set_open(struct flood *flood, uint16_t cell, uint8_t wall)
+{
+	uint8_t i = wall_index(wall);
+	uint8_t bit;
+
+	if (is_border(cell, i))
+		return;
+	bit = locate(&cell, i);
+	set_packed_bits(flood, cell, bit | bit << 1, bit << 1);
+}
+
+/**
+ * @brief Check whether a cell has a wall.
+ */
+bool flood_has_wall(struct flood *flood, uint16_t cell, uint8_t wall)
+{
+	return has_wall(flood, cell, wall_index(wall));
+}
+
+/**
+ * @brief Check whether a wall has been either added or set as open.
+ */
+bool flood_is_known(struct flood *flood, uint16_t cell, uint8_t wall)
+{
+	uint8_t i = wall_index(wall);
+	uint8_t bit;
+
+	if (is_border(cell, i))
+		return true;
+	bit = locate(&cell, i);
+	return packed_bits(flood, cell) & bit << 1;
+}
+
+/**
+ * @brief Return the walls of a cell, unpacked (i.e.: `FLOOD_EAST`).
+ */
+uint8_t flood_cell_walls(struct flood *flood, uint16_t cell)
+{
+	return unpack_walls(flood, cell);
+}
+
+/**
+ * @brief Recompute the distances of all cells from scratch.
+ *
+ * Breadth first search starting from all goal cells at once.
+ */
+void flood_full(struct flood *flood)
+{
+	uint16_t cell;
+
+	for (cell = 0; cell < FLOOD_MAZE_AREA; cell++) {
+		if (!flood_is_goal(flood, cell)) {
+			flood->distances[cell] = FLOOD_UNREACHABLE;
+			continue;
+		}
+		flood->distances[cell] = 0;
+		queue_push(cell);
+	}
+	propagate(flood);
+}
+
+/**
+ * @brief Add a wall and update only the distances it affects.
+ *
+ * Adding a wall can only increase distances, so the update runs in two
+ * phases, both bounded by the number of affected cells instead of the maze
+ * area:
+ *
+ * - Invalidation: cells left without any neighbor one step closer to the
+ *   goal lost their shortest path. They are set as unreachable and their
+ *   dependent neighbors (one step farther) are checked in turn.
+ * - Repair: invalidated cells take their distance from the lowest valid
+ *   neighbor and the new distances are propagated among them.
+ *
+ * Distances must be consistent (i.e.: after `flood_full()`) before calling
+ * this function.
+ *
+ * @param[in] flood Flood fill state.
+ * @param[in] cell Cell index.
+ * @param[in] wall Wall bit (i.e.: `FLOOD_EAST`).
+ *
+ * @return Number of cells whose distance was invalidated.
+ */
+uint16_t flood_incremental(struct flood *flood, uint16_t cell, uint8_t wall)
+{
+	uint8_t index = wall_index(wall);
+	flood_distance_t distance;
+	uint16_t count = 0;
+	uint8_t cell_walls;
+	uint16_t next;
+	uint16_t k;
+	uint8_t i;
+
+	if (has_wall(flood, cell, index))
+		return 0;
+	flood_add_wall(flood, cell, wall);
+	queue_push(cell);
+	queue_push(cell + offsets[index]);
+
+	while (queue_size) {
+		cell = queue_pop();
+		distance = flood->distances[cell];
+		if (flood_is_goal(flood, cell) || distance == FLOOD_UNREACHABLE)
+			continue;
+		if (lowest_neighbor_distance(flood, cell) == distance - 1)
+			continue;
+		flood->distances[cell] = FLOOD_UNREACHABLE;
+		invalidated[count++] = (flood_cell_t)cell;
+		cell_walls = unpack_walls(flood, cell);
+		for (i = 0; i < 4; i++) {
+			if (cell_walls & walls[i])
+				continue;
+			next = cell + offsets[i];
+			if (flood->distances[next] == distance + 1)
+				queue_push(next);
+		}
+	}
+
+	for (k = 0; k < count; k++) {
+		cell = invalidated[k];
+		distance = lowest_neighbor_distance(flood, cell);
+		if (distance == FLOOD_UNREACHABLE)
+			continue;
+		flood->distances[cell] = distance + 1;
+		queue_push(cell);
+	}
+	propagate(flood);
+
+	return count;
+}
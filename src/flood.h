@@ -0,0 +1,69 @@
+#ifndef __FLOOD_H
+#define __FLOOD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef FLOOD_MAZE_SIZE
+#define FLOOD_MAZE_SIZE 16
+#endif
+#define FLOOD_MAZE_AREA (FLOOD_MAZE_SIZE * FLOOD_MAZE_SIZE)
+
+/**
+ * Cell indexes and distances need 16 bits for mazes bigger than 16x16 (i.e.:
+ * 32x32 half-size mazes). `FLOOD_UNREACHABLE` is the distance of the cells
+ * from which no goal can be reached.
+ */
+#if FLOOD_MAZE_SIZE > 16
+typedef uint16_t flood_cell_t;
+typedef uint16_t flood_distance_t;
+#define FLOOD_UNREACHABLE 0xFFFF
+#else
+typedef uint8_t flood_cell_t;
+typedef uint8_t flood_distance_t;
+#define FLOOD_UNREACHABLE 0xFF
+#endif
+
+/** Wall bits for each cell */
+#define FLOOD_EAST 0x01
+#define FLOOD_SOUTH 0x02
+#define FLOOD_WEST 0x04
+#define FLOOD_NORTH 0x08
+
+/** Packed walls size, in bytes: 4 bits per cell (see `struct flood`) */
+#define FLOOD_WALLS_SIZE (FLOOD_MAZE_AREA / 2)
+
+/**
+ * Flood fill state.
+ *
+ * - Packed walls. Each wall is stored once, with two bits (known and
+ *   present), as the east or north wall of a cell: 4 bits per cell. The
+ *   maze border walls are implicit.
+ * - Goal cells, one bit per cell.
+ * - Distance, in cells, from each cell to the closest goal.
+ *
+ * Walls and goals are all that needs to be saved or sent: distances are
+ * only needed while searching or planning and can always be recomputed with
+ * `flood_full()`.
+ *
+ * Cells are indexed as `x + y * FLOOD_MAZE_SIZE`, with north increasing `y`.
+ */
+struct flood {
+	uint8_t walls[FLOOD_WALLS_SIZE];
+	uint8_t goal[FLOOD_MAZE_AREA / 8];
+	flood_distance_t distances[FLOOD_MAZE_AREA];
+};
+
+void flood_reset(struct flood *flood);
+void flood_set_goal(struct flood *flood, uint16_t cell);
+bool flood_is_goal(struct flood *flood, uint16_t cell);
+void flood_add_wall(struct flood *flood, uint16_t cell, uint8_t wall);
+void flood_set_open(struct flood *flood, uint16_t cell, uint8_t wall);
+bool flood_has_wall(struct flood *flood, uint16_t cell, uint8_t wall);
+bool flood_is_known(struct flood *flood, uint16_t cell, uint8_t wall);
+uint8_t flood_cell_walls(struct flood *flood, uint16_t cell);
+void flood_full(struct flood *flood);
+uint16_t flood_incremental(struct flood *flood, uint16_t cell, uint8_t wall);
+
+#endif /* __FLOOD_H */
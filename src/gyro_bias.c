@@ -0,0 +1,131 @@
+#include "gyro_bias.h"
+
+static float bias;
+static float variance;
+static uint32_t samples;
+static uint32_t still_ticks;
+static uint32_t fresh;
+static uint32_t rejected;
+
+/**
+ * @brief Discard the bias estimate.
+ */
+void gyro_bias_reset(void)
+{
+	bias = 0.;
+	variance = 0.;
+	samples = 0;
+	still_ticks = 0;
+	fresh = 0;
+	rejected = 0;
+}
+
+/**
+ * @brief Refine the gyroscope Z-axis bias estimate with a new sample.
+ *
+ * Samples are only taken when the mouse has been still (i.e.: no encoder
+ * motion) for `GYRO_BIAS_SETTLE_TICKS`, so vibrations have faded. They are
+ * averaged with a running mean, which becomes an exponential moving average
+ * of `GYRO_BIAS_WINDOW` samples, so the estimate keeps following slow drifts
+ * over every stop of a long exploration. The variance is estimated too, to
+ * know when the estimate is good enough (see `gyro_bias_ready()`).
+ *
+ * Samples far from the estimate are discarded, as the mouse may be rotating
+ * without the wheels moving (e.g.: picked up by hand). If they keep coming,
+ * the estimate is considered wrong and restarted.
+ *
+ * @param[in] raw Raw gyroscope Z-axis reading.
+ * @param[in] still Whether the wheels did not move since the previous one.
+ */
+void gyro_bias_update(int16_t raw, bool still)
+{
+	float deviation;
+	float gain;
+
+	if (!still) {
+		still_ticks = 0;
+		fresh = 0;
+		return;
+	}
+	if (++still_ticks <= GYRO_BIAS_SETTLE_TICKS)
+		return;
+
+	deviation = raw - bias;
+	if (samples && fabsf(deviation) > GYRO_BIAS_MAX_DEVIATION) {
+		if (++rejected > GYRO_BIAS_SETTLE_TICKS)
+			samples = 0;
+		return;
+	}
+	rejected = 0;
+	if (samples < GYRO_BIAS_WINDOW)
+		samples++;
+	fresh++;
+	gain = 1. / samples;
+	bias += gain * deviation;
+	variance = (1. - gain) * (variance + gain * deviation * deviation);
+}
+
+/**
+ * @brief Get the gyroscope Z-axis bias estimate, in LSB.
+ */
+float get_gyro_bias(void)
+{
+	return bias;
+}
+
+/**
+ * @brief Whether the bias estimate is ready to start moving.
+ *
+ * The mouse must be still, with enough samples taken since it stopped, and
+ * the standard error of the estimate within `GYRO_BIAS_TOLERANCE`. This is
+ * all the time the calibration needs: with a low noise gyroscope, or with a
+ * good estimate from previous stops, it is a fraction of a second.
+ */
+bool gyro_bias_ready(void)
+{
+	if (fresh < GYRO_BIAS_MIN_SAMPLES)
+		return false;
+	return variance <= GYRO_BIAS_TOLERANCE * GYRO_BIAS_TOLERANCE * samples;
+}
+
+#ifndef MMSIM_SIMULATION
+/**
+ * @brief Refine the bias estimate with the latest gyroscope sample.
+ *
+ * To be called on each SysTick, after updating the encoders. The estimate is
+ * subtracted from the gyroscope readings served to the rest of the firmware,
+ * with its fraction (see `set_gyro_z_offset()`), so the rounding error is
+ * well below `GYRO_BIAS_TOLERANCE`.
+ */
+void update_gyro_bias(void)
+{
+	static int32_t last_left;
+	static int32_t last_right;
+	static uint32_t last_sequence;
+	struct gyro_z_sample sample;
+	int32_t left = get_encoder_left_count();
+	int32_t right = get_encoder_right_count();
+	bool still = left == last_left && right == last_right;
+
+	last_left = left;
+	last_right = right;
+	get_gyro_z_sample(&sample);
+	if (!sample.sequence || sample.sequence == last_sequence)
+		return;
+	last_sequence = sample.sequence;
+	gyro_bias_update(sample.raw, still);
+	set_gyro_z_offset(bias);
+}
+
+/**
+ * @brief Wait for the bias estimate to be ready, at most `timeout` seconds.
+ */
+void wait_gyro_bias_ready(float timeout)
+{
+	uint32_t waited;
+	uint32_t limit = (uint32_t)(timeout * 1000);
+
+	for (waited = 0; waited < limit && !gyro_bias_ready(); waited++)
+		sleep_us(1000);
+}
+#endif
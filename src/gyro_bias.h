@@ -0,0 +1,40 @@
+#ifndef __GYRO_BIAS_H
+#define __GYRO_BIAS_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "setup.h"
+
+#ifndef MMSIM_SIMULATION
+#include "mmlib/clock.h"
+
+#include "encoders.h"
+#include "platform.h"
+#endif
+
+/** Control loop iterations without encoder motion before sampling the bias */
+#define GYRO_BIAS_SETTLE_TICKS 100
+
+/** Samples averaged, at most, so the estimate follows slow drifts */
+#define GYRO_BIAS_WINDOW 2048
+
+/** Samples further from the estimate are discarded, in LSB */
+#define GYRO_BIAS_MAX_DEVIATION 64.
+
+/**
+ * Standard error of the estimate, in LSB, and number of samples of the
+ * current stationary period for the estimate to be ready.
+ */
+#define GYRO_BIAS_TOLERANCE 0.25
+#define GYRO_BIAS_MIN_SAMPLES 64
+
+void gyro_bias_reset(void);
+void gyro_bias_update(int16_t raw, bool still);
+float get_gyro_bias(void);
+bool gyro_bias_ready(void);
+void update_gyro_bias(void);
+void wait_gyro_bias_ready(float timeout);
+
+#endif /* __GYRO_BIAS_H */
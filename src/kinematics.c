@@ -0,0 +1,100 @@
+#include "kinematics.h"
+#include "kinematics_table.h"
+
+#if KINEMATICS_TABLE_FREQUENCY_HZ != SYSTICK_FREQUENCY_HZ
+#error "Kinematics tables must be generated for SYSTICK_FREQUENCY_HZ"
+#endif
+
+/**
+ * @brief Return the closest force level index in the generated tables.
+ */
+static uint8_t force_level(float force)
+{
+	float level;
+
+	level = roundf((force - KINEMATICS_FORCE_MIN) / KINEMATICS_FORCE_STEP);
+	if (level < 0.)
+		return 0;
+	if (level > KINEMATICS_FORCE_LEVELS - 1)
+		return KINEMATICS_FORCE_LEVELS - 1;
+	return (uint8_t)level;
+}
+
+/**
+ * @brief Return the linear profile for a force.
+ *
+ * Profiles are generated at build time (see `scripts/kinematics_table.py`)
+ * for a fixed set of force levels. The closest level is selected, so this
+ * function should be called at configuration time, not on each tick.
+ *
+ * @param[in] force Maximum force applied on each wheel, in newtons.
+ */
+const struct linear_profile *get_linear_profile(float force)
+{
+	return &linear_profiles[force_level(force)];
+}
+
+/**
+ * @brief Return the slalom turn profile for a force and a turn angle.
+ *
+ * @see get_linear_profile()
+ */
+const struct turn_profile *get_turn_profile(float force,
+					    enum turn_angle angle)
+{
+	return &turn_profiles[force_level(force)][angle];
+}
+
+/**
+ * @brief Distance required to brake from one speed to another.
+ *
+ * @param[in] profile Linear profile.
+ * @param[in] speed Current speed, in meters per second.
+ * @param[in] end_speed Target speed, in meters per second.
+ *
+ * @return Braking distance, in meters.
+ */
+float braking_distance(const struct linear_profile *profile, float speed,
+		       float end_speed)
+{
+	return (speed * speed - end_speed * end_speed) *
+	       profile->braking_factor;
+}
+
+/**
+ * @brief Total duration of a slalom turn, in ticks.
+ */
+uint16_t turn_profile_ticks(const struct turn_profile *profile)
+{
+	return 2 * profile->transition_ticks + profile->arc_ticks;
+}
+
+/**
+ * @brief Angular velocity of a slalom turn at a given tick.
+ *
+ * Transitions are indexed in the shared quarter sine wave table, so no
+ * trigonometric functions are evaluated at run time.
+ *
+ * @param[in] profile Turn profile.
+ * @param[in] tick Ticks since the start of the turn.
+ *
+ * @return Angular velocity, in radians per second, or zero after the end of
+ * the turn.
+ */
+float turn_angular_velocity(const struct turn_profile *profile, uint16_t tick)
+{
+	uint16_t transition = profile->transition_ticks;
+	uint16_t end = turn_profile_ticks(profile);
+	uint16_t phase;
+
+	if (tick >= end)
+		return 0.;
+	if (tick < transition)
+		phase = tick;
+	else if (tick >= transition + profile->arc_ticks)
+		phase = end - tick;
+	else
+		return profile->max_angular_velocity;
+	return profile->max_angular_velocity *
+	       kinematics_sine[phase * (KINEMATICS_SINE_SIZE - 1) / transition];
+}
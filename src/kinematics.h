@@ -0,0 +1,58 @@
+#ifndef __KINEMATICS_H
+#define __KINEMATICS_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include "setup.h"
+
+enum turn_angle {
+	TURN_45,
+	TURN_90,
+	TURN_135,
+	TURN_180,
+	TURN_ANGLES,
+};
+
+/**
+ * Trapezoidal linear profile.
+ *
+ * Accelerations are in meters per second squared. The braking factor is
+ * `1 / (2 * deceleration)`, in seconds squared per meter.
+ */
+struct linear_profile {
+	float acceleration;
+	float deceleration;
+	float braking_factor;
+};
+
+/**
+ * Slalom turn profile.
+ *
+ * The angular velocity rises as a quarter sine wave up to its maximum during
+ * `transition_ticks`, stays constant during `arc_ticks` and falls back to
+ * zero during another `transition_ticks`, at constant linear velocity.
+ *
+ * For 90-degree turns, `before` and `after` are the straight distances, in
+ * meters, to travel before and after the turn to go from one cell border to
+ * the next one. They are zero for the other turns.
+ */
+struct turn_profile {
+	float linear_velocity;
+	float max_angular_velocity;
+	uint16_t transition_ticks;
+	uint16_t arc_ticks;
+	float before;
+	float after;
+};
+
+const struct linear_profile *get_linear_profile(float force);
+const struct turn_profile *get_turn_profile(float force,
+					    enum turn_angle angle);
+float braking_distance(const struct linear_profile *profile, float speed,
+		       float end_speed);
+uint16_t turn_profile_ticks(const struct turn_profile *profile);
+float turn_angular_velocity(const struct turn_profile *profile,
+			    uint16_t tick);
+
+#endif /* __KINEMATICS_H */
@@ -11,22 +11,76 @@
 #include "mmlib/speed.h"
 #include "mmlib/walls.h"
 
+#include "collision.h"
+#include "commands.h"
+#include "detection.h"
 #include "eeprom.h"
+#include "encoders.h"
+#include "gyro_bias.h"
 #include "motor.h"
+#include "platform.h"
+#include "profiler.h"
+#include "settings.h"
 #include "setup.h"
+#include "telemetry.h"
+#include "trajectory.h"
+#include "tuning.h"
 #include "voltage.h"
+#include "wall_posts.h"
 
 /**
  * @brief Handle the SysTick interruptions.
+ *
+ * The fast loop (encoders, gyroscope, motor control and control telemetry)
+ * runs on every tick, at `SYSTICK_FREQUENCY_HZ`. The gyroscope is read with a
+ * burst started at the beginning of the previous tick, so the control loop
+ * does not wait for SPI2. The slow loop (distance readings, data logging and
+ * sensors telemetry) runs once every `SYSTICK_SLOW_DIVIDER` ticks.
+ *
+ * Each stage is profiled (see `log_profiler()`).
  */
 void sys_tick_handler(void)
 {
+	static uint32_t slow_ticks;
+	bool slow;
+
+	slow = (++slow_ticks >= SYSTICK_SLOW_DIVIDER);
+	if (slow)
+		slow_ticks = 0;
+
+	profiler_tick_start();
+	mpu_start_gyro_z_read();
 	clock_tick();
-	update_distance_readings();
+	profiler_stage_end(PROFILER_START);
+	update_battery_voltage();
+	profiler_stage_end(PROFILER_BATTERY);
+	if (slow) {
+		update_distance_readings();
+		profiler_stage_end(PROFILER_DISTANCE);
+	}
 	update_gyro_readings();
+	profiler_stage_end(PROFILER_GYRO);
+	update_encoders();
 	update_encoder_readings();
+	profiler_stage_end(PROFILER_ENCODER);
+	update_gyro_bias();
+	update_collision_detection();
+	update_wall_posts();
+	profiler_stage_end(PROFILER_ESTIMATION);
+	update_trajectory();
+	update_feedforward();
 	motor_control();
-	log_data();
+	update_tuning_metrics();
+	update_sensors_schedule();
+	profiler_stage_end(PROFILER_CONTROL);
+	if (slow) {
+		log_data();
+		log_telemetry_sensors();
+	}
+	log_telemetry_control();
+	record_telemetry_control();
+	profiler_stage_end(PROFILER_LOGGING);
+	profiler_tick_end();
 }
 
 /**
@@ -64,8 +118,9 @@ static void before_moving(void)
 	led_bluepill_off();
 	led_left_off();
 	led_right_off();
-	sleep_us(2000000);
+	wait_gyro_bias_ready(2.);
 	calibrate();
+	reset_collision_detector();
 	enable_motor_control();
 	set_starting_position();
 }
@@ -88,7 +143,11 @@ static void after_moving(void)
  *
  * The user selects the force to apply to the tires while exploring or running.
  *
- * Data logging is always active during movement phase.
+ * Data logging is always active during movement phase. Control records are
+ * also kept in RAM, at the control loop frequency, and dumped after it (see
+ * `telemetry_recorder_dump()`). The recorder only keeps the last
+ * `TELEMETRY_RECORDER_SIZE` control loop iterations, so the data logs are
+ * still the only trace of the whole movement.
  *
  * @param[in] run Whether the robot should be running.
  */
@@ -101,6 +160,7 @@ static void configure_speed(bool do_run)
 
 	start_data_logging(log_data_control);
 	before_moving();
+	telemetry_recorder_start();
 	if (!do_run) {
 		explore(force);
 		set_run_sequence();
@@ -111,6 +171,7 @@ static void configure_speed(bool do_run)
 	}
 	after_moving();
 	stop_data_logging();
+	telemetry_recorder_dump();
 }
 
 /**
@@ -170,6 +231,7 @@ static void configure_start(void)
 int main(void)
 {
 	setup();
+	load_settings();
 	kinematic_configuration(0.25, false);
 	systick_interrupt_enable();
 	while (1) {
@@ -180,7 +242,8 @@ int main(void)
 			configure_start();
 			break;
 		}
-		execute_command();
+		if (!execute_platform_command())
+			execute_command();
 	}
 
 	return 0;
@@ -1,117 +1,217 @@
 #include "motor.h"
 
-static volatile uint32_t saturated_left;
-static volatile uint32_t saturated_right;
+static volatile int32_t applied_left;
+static volatile int32_t applied_right;
+static volatile int32_t feedforward_left;
+static volatile int32_t feedforward_right;
+static uint32_t staged_oc1;
+static uint32_t staged_oc2;
+
+/**
+ * @brief Saturate a wheel power and compute its output compare values.
+ *
+ * The sign, magnitude and saturation are computed with masks instead of
+ * branches, so the time spent does not depend on the power requested. Values
+ * beyond the maximum PWM allowed are limited to it.
+ *
+ * @param[in] power Power value from -MAX_PWM_PERIOD to MAX_PWM_PERIOD.
+ * @param[out] applied Power applied, after saturation.
+ * @param[out] forward_oc Compare value for the first channel of the wheel.
+ * @param[out] reverse_oc Compare value for the second channel of the wheel.
+ */
+static inline void wheel_compare(int32_t power, volatile int32_t *applied,
+				 uint32_t *forward_oc, uint32_t *reverse_oc)
+{
+	uint32_t sign = (uint32_t)(power >> 31);
+	uint32_t magnitude = ((uint32_t)power ^ sign) - sign;
+	uint32_t over = -(uint32_t)(magnitude > MAX_PWM_PERIOD);
+
+	magnitude ^= (magnitude ^ MAX_PWM_PERIOD) & over;
+	*applied = (int32_t)((magnitude ^ sign) - sign);
+	*forward_oc = MAX_PWM_PERIOD - (magnitude & sign);
+	*reverse_oc = MAX_PWM_PERIOD - (magnitude & ~sign);
+}
+
+/**
+ * @brief Write the four motor driver output compare registers at once.
+ *
+ * Output compare preload is enabled, so the values written are only
+ * transferred to the active registers on the next update event. Update
+ * events are disabled during the write, so both wheels always change on the
+ * same PWM period edge.
+ */
+static void write_compare(uint32_t oc1, uint32_t oc2, uint32_t oc3,
+			  uint32_t oc4)
+{
+	timer_disable_update_event(TIM3);
+	TIM3_CCR1 = oc1;
+	TIM3_CCR2 = oc2;
+	TIM3_CCR3 = oc3;
+	TIM3_CCR4 = oc4;
+	timer_enable_update_event(TIM3);
+}
+
+/**
+ * @brief Update the feed-forward power from the control loop targets.
+ *
+ * The target speeds are read from mmlib and their change since the last tick
+ * is taken as the target acceleration. The power from the motor model (see
+ * `feedforward_power()`) is added to the power set with `power_both()`,
+ * `power_left()` and `power_right()`, so the control loop feedback only has
+ * to correct the residual error.
+ *
+ * To be called on each SysTick, before the control loop.
+ */
+void update_feedforward(void)
+{
+	static float last_linear_speed;
+	static float last_angular_speed;
+	float linear_speed = get_target_linear_speed();
+	float angular_speed = get_target_angular_speed();
+	float linear_acceleration =
+		(linear_speed - last_linear_speed) * SYSTICK_FREQUENCY_HZ;
+	float angular_acceleration =
+		(angular_speed - last_angular_speed) * SYSTICK_FREQUENCY_HZ;
+	int32_t left;
+	int32_t right;
+
+	feedforward_power(linear_speed, linear_acceleration, angular_speed,
+			  angular_acceleration, &left, &right);
+	last_linear_speed = linear_speed;
+	last_angular_speed = angular_speed;
+	feedforward_left = left;
+	feedforward_right = right;
+}
+
+/**
+ * @brief Set both motors power with a single motor driver update.
+ *
+ * Power is set modulating the PWM signals sent to the motor driver. The
+ * feed-forward power is added to both values, which are then saturated as in
+ * `power_left()` and `power_right()`.
+ *
+ * @param[in] left Left power value from -MAX_PWM_PERIOD to MAX_PWM_PERIOD.
+ * @param[in] right Right power value from -MAX_PWM_PERIOD to MAX_PWM_PERIOD.
+ */
+void power_both(int32_t left, int32_t right)
+{
+	uint32_t oc3, oc4;
+
+	wheel_compare(left + feedforward_left, &applied_left, &staged_oc1,
+		      &staged_oc2);
+	wheel_compare(right + feedforward_right, &applied_right, &oc3, &oc4);
+	write_compare(staged_oc1, staged_oc2, oc3, oc4);
+}
 
 /**
  * @brief Set left motor power.
  *
- * Power is set modulating the PWM signal sent to the motor driver.
+ * Power is set modulating the PWM signal sent to the motor driver, with the
+ * feed-forward power added (see `update_feedforward()`).
  *
- * This function checks for possible PWM saturation. If that is the case the
- * value will be limited to the maximum PWM allowed and the `saturated_left`
- * variable will be incremented by one. This variable is later used to check
- * if multiple consecutive saturated values occurred, which is interpreted as
- * a collision.
+ * The compare values are only staged: they are written, along with the right
+ * wheel ones, by the next `power_right()` call. mmlib `motor_control()` sets
+ * the left wheel and then the right one, so both wheels always change on the
+ * same PWM period edge.
  *
  * @param[in] power Power value from -MAX_PWM_PERIOD to MAX_PWM_PERIOD.
+ *
+ * @see wheel_compare()
  */
 void power_left(int32_t power)
 {
-	bool forward = true;
-
-	if (power < 0) {
-		power = -power;
-		forward = false;
-	}
-	if (power > MAX_PWM_PERIOD) {
-		power = MAX_PWM_PERIOD;
-		saturated_left += 1;
-	} else {
-		saturated_left = 0;
-	}
-	if (forward) {
-		timer_set_oc_value(TIM3, TIM_OC1, MAX_PWM_PERIOD);
-		timer_set_oc_value(TIM3, TIM_OC2, MAX_PWM_PERIOD - power);
-	} else {
-		timer_set_oc_value(TIM3, TIM_OC1, MAX_PWM_PERIOD - power);
-		timer_set_oc_value(TIM3, TIM_OC2, MAX_PWM_PERIOD);
-	}
+	wheel_compare(power + feedforward_left, &applied_left, &staged_oc1,
+		      &staged_oc2);
 }
 
 /**
  * @brief Set right motor power.
  *
- * Power is set modulating the PWM signal sent to the motor driver.
+ * Power is set modulating the PWM signal sent to the motor driver, with the
+ * feed-forward power added (see `update_feedforward()`).
  *
- * This function checks for possible PWM saturation. If that is the case the
- * value will be limited to the maximum PWM allowed and the `saturated_right`
- * variable will be incremented by one. This variable is later used to check
- * if multiple consecutive saturated values occurred, which is interpreted as
- * a collision.
+ * The four compare registers are written in a single burst, with the left
+ * wheel values last staged by `power_left()` (see `write_compare()`).
  *
  * @param[in] power Power value from -MAX_PWM_PERIOD to MAX_PWM_PERIOD.
+ *
+ * @see wheel_compare()
  */
 void power_right(int32_t power)
 {
-	bool forward = true;
-
-	if (power < 0) {
-		power = -power;
-		forward = false;
-	}
-	if (power > MAX_PWM_PERIOD) {
-		power = MAX_PWM_PERIOD;
-		saturated_right += 1;
-	} else {
-		saturated_right = 0;
-	}
-	if (forward) {
-		timer_set_oc_value(TIM3, TIM_OC3, MAX_PWM_PERIOD);
-		timer_set_oc_value(TIM3, TIM_OC4, MAX_PWM_PERIOD - power);
-	} else {
-		timer_set_oc_value(TIM3, TIM_OC3, MAX_PWM_PERIOD - power);
-		timer_set_oc_value(TIM3, TIM_OC4, MAX_PWM_PERIOD);
-	}
+	uint32_t oc3, oc4;
+
+	wheel_compare(power + feedforward_right, &applied_right, &oc3, &oc4);
+	write_compare(staged_oc1, staged_oc2, oc3, oc4);
+}
+
+/**
+ * @brief Return the last power set to the left motor, after feed-forward and
+ * saturation.
+ */
+int32_t get_power_left(void)
+{
+	return applied_left;
+}
+
+/**
+ * @brief Return the last power set to the right motor, after feed-forward and
+ * saturation.
+ */
+int32_t get_power_right(void)
+{
+	return applied_right;
 }
 
 /**
  * @brief Break both motors (short the motor winding).
+ *
+ * The power applied is reset, so the motor model sees no drive voltage.
  */
 void drive_break(void)
 {
-	timer_set_oc_value(TIM3, TIM_OC1, MAX_PWM_PERIOD);
-	timer_set_oc_value(TIM3, TIM_OC2, MAX_PWM_PERIOD);
-	timer_set_oc_value(TIM3, TIM_OC3, MAX_PWM_PERIOD);
-	timer_set_oc_value(TIM3, TIM_OC4, MAX_PWM_PERIOD);
+	applied_left = 0;
+	applied_right = 0;
+	staged_oc1 = MAX_PWM_PERIOD;
+	staged_oc2 = MAX_PWM_PERIOD;
+	write_compare(MAX_PWM_PERIOD, MAX_PWM_PERIOD, MAX_PWM_PERIOD,
+		      MAX_PWM_PERIOD);
 }
 
 /**
  * @brief Disable the motor driver (let both motors coast).
+ *
+ * The power applied is reset, so the motor model sees no drive voltage.
  */
 void drive_off(void)
 {
-	timer_set_oc_value(TIM3, TIM_OC1, 0);
-	timer_set_oc_value(TIM3, TIM_OC2, 0);
-	timer_set_oc_value(TIM3, TIM_OC3, 0);
-	timer_set_oc_value(TIM3, TIM_OC4, 0);
+	applied_left = 0;
+	applied_right = 0;
+	staged_oc1 = 0;
+	staged_oc2 = 0;
+	write_compare(0, 0, 0, 0);
 }
 
 /**
- * @brief Return the maximum consecutive motor driver saturated outputs.
+ * @brief Return the collision evidence checked by the mmlib control loop.
+ *
+ * mmlib considers there has been a collision, and disables the motor driver,
+ * when this exceeds `MAX_MOTOR_DRIVER_SATURATION_PERIOD`. Consecutive
+ * saturated outputs are no longer counted: the acceleration residuals
+ * detector replaces that rule (see `collision_detector_triggered()`), and a
+ * detection is reported as a saturation longer than any period.
  */
 uint32_t motor_driver_saturation(void)
 {
-	if (saturated_right > saturated_left)
-		return saturated_right;
-	return saturated_left;
+	if (collision_detector_triggered())
+		return UINT32_MAX;
+	return 0;
 }
 
 /**
- * @brief Reset the PWM saturation counters.
+ * @brief Reset the collision evidence (see `reset_collision_detector()`).
  */
 void reset_motor_driver_saturation(void)
 {
-	saturated_left = 0;
-	saturated_right = 0;
+	reset_collision_detector();
 }
@@ -1,15 +1,25 @@
 #ifndef __MOTOR_H
 #define __MOTOR_H
 
+#ifndef MMSIM_SIMULATION
 #include <libopencm3/stm32/gpio.h>
 #include <libopencm3/stm32/timer.h>
 
+#include "mmlib/control.h"
+#endif
+
+#include "collision.h"
+#include "feedforward.h"
 #include "setup.h"
 
 void drive_break(void);
 void drive_off(void);
+void update_feedforward(void);
+void power_both(int32_t left, int32_t right);
 void power_left(int32_t power);
 void power_right(int32_t power);
+int32_t get_power_left(void);
+int32_t get_power_right(void);
 uint32_t motor_driver_saturation(void);
 void reset_motor_driver_saturation(void);
 
@@ -0,0 +1,355 @@
+#include "planner.h"
+#include "move_costs.h"
+
+#if MOVE_COSTS_MAZE_SIZE != FLOOD_MAZE_SIZE
+#error "Move costs must be generated for FLOOD_MAZE_SIZE"
+#endif
+
+#define HEADINGS 4
+#define NODES (FLOOD_MAZE_AREA * HEADINGS)
+
+static const uint8_t walls[HEADINGS] = {FLOOD_EAST, FLOOD_SOUTH, FLOOD_WEST,
+					FLOOD_NORTH};
+static const int8_t offsets[HEADINGS] = {1, -FLOOD_MAZE_SIZE, -1,
+					 FLOOD_MAZE_SIZE};
+
+/** Runs always start at the first cell, heading north */
+#define START_NODE (0 * HEADINGS + 3)
+
+/**
+ * Time to reach each node from a goal, in milliseconds, following reversed
+ * moves (see `reverse()`).
+ */
+static uint16_t costs[NODES];
+static uint8_t done[NODES / 8];
+
+/**
+ * Move expansion visitor, called for each move available from a node with
+ * the resulting node and the move cost.
+ */
+typedef void (*visitor)(uint16_t node, uint16_t cost, struct plan_move move);
+
+/** Best move found while extracting a planned run */
+static struct plan_move best_move;
+static uint16_t best_node;
+static uint32_t best_cost;
+
+/** Cost of the node being expanded in `dijkstra()` */
+static uint16_t expanded_cost;
+
+/**
+ * Nodes are located at the cell borders: node `cell * HEADINGS + heading`
+ * means entering `cell` with `heading` (indexed as in `walls`).
+ */
+static uint16_t node_cell(uint16_t node)
+{
+	return node / HEADINGS;
+}
+
+static uint8_t node_heading(uint16_t node)
+{
+	return node % HEADINGS;
+}
+
+static uint16_t make_node(uint16_t cell, uint8_t heading)
+{
+	return cell * HEADINGS + heading;
+}
+
+static uint8_t turn(uint8_t heading, bool right)
+{
+	return (heading + (right ? 1 : HEADINGS - 1)) % HEADINGS;
+}
+
+static uint8_t opposite(uint8_t heading)
+{
+	return (heading + 2) % HEADINGS;
+}
+
+/**
+ * @brief Return the same cell border, crossed in the opposite direction.
+ *
+ * Every move has a reversed move with the same cost, so the time from a
+ * node to the goal equals the time from the goal to its reversed node.
+ */
+static uint16_t reverse(uint16_t node)
+{
+	uint8_t heading = node_heading(node);
+
+	return make_node(node_cell(node) - offsets[heading], opposite(heading));
+}
+
+static bool is_open(struct flood *maze, uint16_t cell, uint8_t heading)
+{
+	return !flood_has_wall(maze, cell, walls[heading]);
+}
+
+static bool is_done(uint16_t node)
+{
+	return done[node / 8] & (1 << (node % 8));
+}
+
+/**
+ * @brief Visit straights, in-place turns and 180-degree turns.
+ */
+static void expand_orthogonal(struct flood *maze, uint16_t node, visitor visit)
+{
+	struct plan_move move = {0};
+	uint16_t cell = node_cell(node);
+	uint8_t heading = node_heading(node);
+	uint8_t next;
+	uint8_t side;
+
+	move.type = PLAN_STRAIGHT;
+	for (move.count = 1; move.count < MOVE_COSTS_STRAIGHT_SIZE;
+	     move.count++) {
+		if (!is_open(maze, cell, heading))
+			break;
+		cell += offsets[heading];
+		visit(make_node(cell, heading), move_costs_straight[move.count],
+		      move);
+	}
+
+	cell = node_cell(node);
+	move.count = 0;
+	for (side = 0; side < 2; side++) {
+		move.right = side;
+		next = turn(heading, move.right);
+		if (!is_open(maze, cell, next))
+			continue;
+		move.type = PLAN_TURN_90;
+		visit(make_node(cell + offsets[next], next), MOVE_COSTS_TURN_90,
+		      move);
+		if (!is_open(maze, cell + offsets[next], opposite(heading)))
+			continue;
+		move.type = PLAN_TURN_180;
+		visit(make_node(cell + offsets[next] - offsets[heading],
+				opposite(heading)),
+		      MOVE_COSTS_TURN_180, move);
+	}
+}
+
+/**
+ * @brief Visit diagonals starting with the given entry turn.
+ *
+ * Diagonals cross cell borders alternating the turn direction and either the
+ * original heading (45-degree entry) or its opposite (135-degree entry, which
+ * takes the first crossing). The exit turn ends heading as the last crossing
+ * (45 degrees) or crosses one more border, opposite to the previous crossing
+ * (135 degrees).
+ */
+static void expand_diagonal(struct flood *maze, uint16_t node, bool right,
+			    uint8_t entry, visitor visit)
+{
+	struct plan_move move = {0};
+	uint16_t cell = node_cell(node);
+	uint8_t heading = node_heading(node);
+	uint8_t skip = entry == 45 ? 1 : 2;
+	uint8_t previous = heading;
+	uint8_t crossings[2];
+	uint8_t current;
+	uint8_t back;
+	uint16_t cost;
+
+	crossings[0] = turn(heading, right);
+	crossings[1] = entry == 45 ? heading : opposite(heading);
+	move.type = PLAN_DIAGONAL;
+	move.right = right;
+	move.entry = entry;
+	for (move.count = 1; move.count - skip < MOVE_COSTS_DIAGONAL_SIZE;
+	     move.count++) {
+		current = crossings[(move.count - 1) % 2];
+		if (!is_open(maze, cell, current))
+			break;
+		cell += offsets[current];
+		if (move.count >= skip) {
+			cost = move_costs_diagonal[move.count - skip] +
+			       (entry == 45 ? MOVE_COSTS_TURN_45
+					    : MOVE_COSTS_TURN_135);
+			move.exit = 45;
+			visit(make_node(cell, current),
+			      cost + MOVE_COSTS_TURN_45, move);
+			back = opposite(previous);
+			if (is_open(maze, cell, back)) {
+				move.exit = 135;
+				visit(make_node(cell + offsets[back], back),
+				      cost + MOVE_COSTS_TURN_135, move);
+			}
+		}
+		previous = current;
+	}
+}
+
+/**
+ * @brief Visit all moves available from a node.
+ */
+static void expand(struct flood *maze, uint16_t node, visitor visit)
+{
+	expand_orthogonal(maze, node, visit);
+	expand_diagonal(maze, node, false, 45, visit);
+	expand_diagonal(maze, node, true, 45, visit);
+	expand_diagonal(maze, node, false, 135, visit);
+	expand_diagonal(maze, node, true, 135, visit);
+}
+
+static void relax(uint16_t node, uint16_t cost, struct plan_move move)
+{
+	uint32_t total = (uint32_t)expanded_cost + cost;
+
+	(void)move;
+	if (total < costs[node])
+		costs[node] = total;
+}
+
+static void choose(uint16_t node, uint16_t cost, struct plan_move move)
+{
+	uint16_t remaining = costs[reverse(node)];
+	uint32_t total;
+
+	if (remaining == PLANNER_UNREACHABLE)
+		return;
+	total = (uint32_t)remaining + cost;
+	if (total >= best_cost)
+		return;
+	best_cost = total;
+	best_node = node;
+	best_move = move;
+}
+
+/**
+ * @brief Compute the time from the goal to every node.
+ *
+ * Dijkstra from all the borders leaving a goal cell, selecting the next node
+ * with a linear scan: with a fixed number of nodes this is simpler and not
+ * slower than a heap big enough for all the moves relaxed.
+ */
+static void dijkstra(struct flood *maze)
+{
+	uint16_t node;
+	uint16_t cell;
+	uint16_t next;
+	uint8_t heading;
+
+	memset(costs, 0xFF, sizeof(costs));
+	memset(done, 0, sizeof(done));
+	for (cell = 0; cell < FLOOD_MAZE_AREA; cell++) {
+		if (!flood_is_goal(maze, cell))
+			continue;
+		for (heading = 0; heading < HEADINGS; heading++)
+			if (is_open(maze, cell, heading))
+				costs[make_node(cell + offsets[heading],
+						heading)] = 0;
+	}
+
+	while (true) {
+		next = PLANNER_UNREACHABLE;
+		for (node = 0; node < NODES; node++) {
+			if (is_done(node) || costs[node] == PLANNER_UNREACHABLE)
+				continue;
+			if (next == PLANNER_UNREACHABLE ||
+			    costs[node] < costs[next])
+				next = node;
+		}
+		if (next == PLANNER_UNREACHABLE)
+			break;
+		done[next / 8] |= 1 << (next % 8);
+		expanded_cost = costs[next];
+		expand(maze, next, relax);
+	}
+}
+
+/**
+ * @brief Plan the minimum time run from the start to the goal.
+ *
+ * Move costs are traversal times generated offline from the kinematic
+ * parameters (see `scripts/move_costs.py`), so the run combines straights,
+ * diagonals and slalom turns to minimize the total time instead of the
+ * number of cells.
+ *
+ * @param[in] maze Maze walls and goal cells.
+ * @param[out] moves Planned moves, up to `PLANNER_MAX_MOVES`.
+ * @param[out] count Number of planned moves.
+ *
+ * @return Estimated run time, in milliseconds, or `PLANNER_UNREACHABLE`.
+ */
+uint32_t plan_time_optimal(struct flood *maze, struct plan_move *moves,
+			   uint16_t *count)
+{
+	uint16_t node = START_NODE;
+	uint32_t time = 0;
+
+	*count = 0;
+	dijkstra(maze);
+	while (!flood_is_goal(maze, node_cell(node)) &&
+	       *count < PLANNER_MAX_MOVES) {
+		best_cost = PLANNER_UNREACHABLE;
+		expand(maze, node, choose);
+		if (best_cost == PLANNER_UNREACHABLE)
+			return PLANNER_UNREACHABLE;
+		time += best_cost - costs[reverse(best_node)];
+		moves[(*count)++] = best_move;
+		node = best_node;
+	}
+	return time;
+}
+
+/**
+ * @brief Plan the run following the flood fill distances.
+ *
+ * Straights and 90-degree turns only, going to the neighbor cell with the
+ * lowest distance, which is the shortest path in cells. The estimated time
+ * uses the same move costs as `plan_time_optimal()`, to compare both.
+ *
+ * @param[in] maze Maze walls, goal cells and up to date distances.
+ * @param[out] moves Planned moves, up to `PLANNER_MAX_MOVES`.
+ * @param[out] count Number of planned moves.
+ *
+ * @return Estimated run time, in milliseconds, or `PLANNER_UNREACHABLE`.
+ */
+uint32_t plan_shortest(struct flood *maze, struct plan_move *moves,
+		       uint16_t *count)
+{
+	struct plan_move *last = NULL;
+	uint16_t cell = node_cell(START_NODE);
+	uint8_t heading = node_heading(START_NODE);
+	uint8_t candidates[3];
+	uint32_t time = 0;
+	uint8_t next;
+	uint8_t i;
+
+	*count = 0;
+	while (maze->distances[cell] && *count < PLANNER_MAX_MOVES) {
+		if (maze->distances[cell] == FLOOD_UNREACHABLE)
+			return PLANNER_UNREACHABLE;
+		candidates[0] = heading;
+		candidates[1] = turn(heading, true);
+		candidates[2] = turn(heading, false);
+		for (i = 0; i < 3; i++) {
+			next = candidates[i];
+			if (is_open(maze, cell, next) &&
+			    maze->distances[cell + offsets[next]] ==
+				    maze->distances[cell] - 1)
+				break;
+		}
+		if (i == 3)
+			return PLANNER_UNREACHABLE;
+		cell += offsets[next];
+		if (next != heading) {
+			heading = next;
+			last = &moves[(*count)++];
+			*last = (struct plan_move){.type = PLAN_TURN_90,
+						   .right = i == 1};
+			time += MOVE_COSTS_TURN_90;
+			continue;
+		}
+		if (!last || last->type != PLAN_STRAIGHT ||
+		    last->count == MOVE_COSTS_STRAIGHT_SIZE - 1) {
+			last = &moves[(*count)++];
+			*last = (struct plan_move){.type = PLAN_STRAIGHT};
+		}
+		time -= move_costs_straight[last->count];
+		last->count++;
+		time += move_costs_straight[last->count];
+	}
+	return time;
+}
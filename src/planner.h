@@ -0,0 +1,42 @@
+#ifndef __PLANNER_H
+#define __PLANNER_H
+
+#include <stdint.h>
+
+#include "flood.h"
+
+/** Maximum number of moves in a planned run */
+#define PLANNER_MAX_MOVES FLOOD_MAZE_AREA
+
+/** Cost of the nodes from which no goal can be reached */
+#define PLANNER_UNREACHABLE 0xFFFF
+
+enum plan_move_type {
+	PLAN_STRAIGHT,
+	PLAN_TURN_90,
+	PLAN_TURN_180,
+	PLAN_DIAGONAL,
+};
+
+/**
+ * Move of a planned run.
+ *
+ * - Straights: `count` cells.
+ * - Turns: turning to the right or to the left (`side`).
+ * - Diagonals: `entry` turn (45 or 135 degrees), `count` cell crossings and
+ *   `exit` turn (45 or 135 degrees), all of them to the same `side`.
+ */
+struct plan_move {
+	uint8_t type;
+	bool right;
+	uint8_t count;
+	uint8_t entry;
+	uint8_t exit;
+};
+
+uint32_t plan_time_optimal(struct flood *maze, struct plan_move *moves,
+			   uint16_t *count);
+uint32_t plan_shortest(struct flood *maze, struct plan_move *moves,
+		       uint16_t *count);
+
+#endif /* __PLANNER_H */
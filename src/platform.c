@@ -1,6 +1,23 @@
 #include "platform.h"
 
 #define MPU_READ 0x80
+#define MPU_GYRO_ZOUT_H 0x47
+#define MPU_GYRO_ZOUT_L 0x48
+
+/** Gyroscope Z-axis burst: register address followed by two data bytes */
+#define MPU_GYRO_Z_BURST 3
+
+static volatile uint8_t burst[MPU_GYRO_Z_BURST];
+static volatile uint8_t burst_index;
+static volatile bool burst_busy;
+static volatile bool burst_complete;
+static volatile uint32_t burst_timestamp;
+static volatile bool spi_locked;
+static volatile struct gyro_z_sample gyro_z;
+static volatile uint32_t gyro_z_sequence;
+static volatile int32_t gyro_z_offset;
+static int32_t gyro_z_residue;
+static uint16_t gyro_z_latched;
 
 /**
  * @brief Read the microcontroller clock cycle counter.
@@ -28,21 +45,71 @@ uint16_t read_encoder_right(void)
 	return (uint16_t)timer_get_counter(TIM4);
 }
 
+/**
+ * @brief Get exclusive access to SPI2 for a blocking transfer.
+ *
+ * No new gyroscope bursts are started while locked. Waits for the burst in
+ * progress, if any, to complete.
+ */
+static void lock_spi(void)
+{
+	spi_locked = true;
+	while (burst_busy)
+		;
+}
+
+/**
+ * @brief Release SPI2 after a blocking transfer.
+ */
+static void unlock_spi(void)
+{
+	spi_locked = false;
+}
+
 /**
  * @brief Read a MPU register.
  *
+ * Gyroscope Z-axis registers are served from the latest burst read (see
+ * `mpu_start_gyro_z_read()`), if any, without waiting for SPI2. The offset
+ * set with `set_gyro_z_offset()` is subtracted from them. Registers are whole
+ * LSB, so the offset fraction is dithered: the residue of each subtraction
+ * is carried to the next one, which makes the mean offset subtracted exact
+ * and keeps the integrated error below one LSB sample.
+ *
+ * Like the MPU output registers, reading `ZOUT_H` latches the sample and
+ * `ZOUT_L` is served from that latch, so both bytes always belong to the same
+ * sample even if a new burst completes in between (`ZOUT_H` must be read
+ * first).
+ *
  * @param[in] address Register address.
  */
 uint8_t mpu_read_register(uint8_t address)
 {
+	struct gyro_z_sample sample;
 	uint8_t reading;
+	int32_t whole;
+
+	if (gyro_z.sequence) {
+		if (address == MPU_GYRO_ZOUT_H) {
+			get_gyro_z_sample(&sample);
+			gyro_z_residue += gyro_z_offset;
+			whole = gyro_z_residue >> GYRO_Z_OFFSET_Q;
+			gyro_z_residue -= whole * (1 << GYRO_Z_OFFSET_Q);
+			gyro_z_latched = (uint16_t)(sample.raw - whole);
+			return (uint8_t)(gyro_z_latched >> 8);
+		}
+		if (address == MPU_GYRO_ZOUT_L)
+			return (uint8_t)gyro_z_latched;
+	}
 
+	lock_spi();
 	gpio_clear(GPIOB, GPIO12);
 	spi_send(SPI2, (MPU_READ | address));
 	spi_read(SPI2);
 	spi_send(SPI2, 0x00);
 	reading = spi_read(SPI2);
 	gpio_set(GPIOB, GPIO12);
+	unlock_spi();
 
 	return reading;
 }
@@ -55,10 +122,106 @@ uint8_t mpu_read_register(uint8_t address)
  */
 void mpu_write_register(uint8_t address, uint8_t value)
 {
+	lock_spi();
 	gpio_clear(GPIOB, GPIO12);
 	spi_send(SPI2, address);
 	spi_read(SPI2);
 	spi_send(SPI2, value);
 	spi_read(SPI2);
 	gpio_set(GPIOB, GPIO12);
+	unlock_spi();
+}
+
+/**
+ * @brief Publish the last completed burst and start a new one.
+ *
+ * To be called at the beginning of each SysTick, so the burst started on one
+ * tick is consumed at the next one. The SPI2 transfer is completed by
+ * `spi2_isr()` without the CPU waiting for it.
+ *
+ * No burst is started if the previous one has not completed yet or if SPI2 is
+ * being used for a blocking transfer.
+ */
+void mpu_start_gyro_z_read(void)
+{
+	if (burst_complete) {
+		burst_complete = false;
+		gyro_z.sequence = 0;
+		gyro_z.timestamp = burst_timestamp;
+		gyro_z.raw = (int16_t)((burst[1] << 8) | burst[2]);
+		if (++gyro_z_sequence == 0)
+			gyro_z_sequence = 1;
+		gyro_z.sequence = gyro_z_sequence;
+	}
+
+	if (spi_locked || burst_busy)
+		return;
+	burst_busy = true;
+	burst_index = 0;
+	gpio_clear(GPIOB, GPIO12);
+	spi_enable_rx_buffer_not_empty_interrupt(SPI2);
+	spi_write(SPI2, (MPU_READ | MPU_GYRO_ZOUT_H));
+}
+
+/**
+ * @brief SPI2 interruption routine.
+ *
+ * Executed on each byte received during a gyroscope burst read. Sends the
+ * next dummy byte or, when the burst is complete, releases the MPU chip
+ * select and timestamps the burst.
+ */
+void spi2_isr(void)
+{
+	burst[burst_index++] = (uint8_t)spi_read(SPI2);
+	if (burst_index < MPU_GYRO_Z_BURST) {
+		spi_write(SPI2, 0x00);
+		return;
+	}
+
+	gpio_set(GPIOB, GPIO12);
+	spi_disable_rx_buffer_not_empty_interrupt(SPI2);
+	burst_timestamp = read_cycle_counter();
+	burst_complete = true;
+	burst_busy = false;
+}
+
+/**
+ * @brief Get the latest gyroscope Z-axis sample.
+ *
+ * The copy is retried if the sample is published in the middle of it. A
+ * `sequence` of `0` means no sample has been read yet.
+ *
+ * @param[out] sample Latest gyroscope Z-axis sample.
+ */
+void get_gyro_z_sample(struct gyro_z_sample *sample)
+{
+	uint32_t sequence;
+
+	do {
+		sequence = gyro_z.sequence;
+		sample->timestamp = gyro_z.timestamp;
+		sample->raw = gyro_z.raw;
+	} while (sequence != gyro_z.sequence);
+	sample->sequence = sequence;
+}
+
+/**
+ * @brief Set the offset subtracted from the gyroscope Z-axis registers.
+ *
+ * Samples from `get_gyro_z_sample()` are kept raw. The offset is kept with
+ * `GYRO_Z_OFFSET_Q` fractional bits.
+ *
+ * @param[in] offset Offset, in LSB.
+ */
+void set_gyro_z_offset(float offset)
+{
+	gyro_z_offset = lroundf(offset * (1 << GYRO_Z_OFFSET_Q));
+}
+
+/**
+ * @brief Get the offset subtracted from the gyroscope Z-axis registers.
+ */
+float get_gyro_z_offset(void)
+{
+	return (float)gyro_z_offset / (1 << GYRO_Z_OFFSET_Q);
 }
@@ -1,15 +1,45 @@
 #ifndef __PLATFORM_H
 #define __PLATFORM_H
 
+#include <math.h>
+#include <stdbool.h>
+
+#ifndef MMSIM_SIMULATION
 #include <libopencm3/cm3/dwt.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/spi.h>
 #include <libopencm3/stm32/timer.h>
+#endif
 
 #include "setup.h"
 
+/**
+ * Gyroscope Z-axis sample, read from the MPU with a SPI2 burst.
+ *
+ * - Sequence number of the sample (increases by one on each burst).
+ * - Clock cycle counter when the burst was completed.
+ * - Raw Z-axis angular rate.
+ */
+struct gyro_z_sample {
+	uint32_t sequence;
+	uint32_t timestamp;
+	int16_t raw;
+};
+
+/**
+ * Fractional bits of the gyroscope Z-axis offset, so a bias estimate finer
+ * than one LSB is not rounded away (see `set_gyro_z_offset()`).
+ */
+#define GYRO_Z_OFFSET_Q 8
+
 uint32_t read_cycle_counter(void);
 uint16_t read_encoder_left(void);
 uint16_t read_encoder_right(void);
 uint8_t mpu_read_register(uint8_t address);
 void mpu_write_register(uint8_t address, uint8_t value);
+void mpu_start_gyro_z_read(void);
+void get_gyro_z_sample(struct gyro_z_sample *sample);
+void set_gyro_z_offset(float offset);
+float get_gyro_z_offset(void);
 
 #endif /* __PLATFORM_H */
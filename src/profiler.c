@@ -0,0 +1,152 @@
+#include "profiler.h"
+
+#if PROFILER_HISTOGRAM_BINS != 8
+#error "log_profiler() expects 8 histogram bins"
+#endif
+
+static const char *const stage_names[PROFILER_STAGES] = {
+    "start",      "battery", "distance", "gyro",  "encoder",
+    "estimation", "control", "logging",  "total"};
+
+static volatile struct profiler_statistics statistics[PROFILER_STAGES];
+static volatile uint32_t late_ticks;
+static volatile uint32_t overrun_ticks;
+static volatile uint32_t tick_start;
+static volatile uint32_t stage_start;
+static volatile bool started;
+
+/**
+ * @brief Add a measurement to the statistics of a stage.
+ *
+ * @param[in] stage Profiled stage.
+ * @param[in] cycles Clock cycles taken by the stage.
+ */
+static void update_statistics(enum profiler_stage stage, uint32_t cycles)
+{
+	uint32_t bin;
+	volatile struct profiler_statistics *stats = &statistics[stage];
+
+	if (stats->count == 0 || cycles < stats->min)
+		stats->min = cycles;
+	if (cycles > stats->max)
+		stats->max = cycles;
+	stats->sum += cycles;
+	stats->count++;
+
+	bin = cycles * PROFILER_HISTOGRAM_BINS / PROFILER_TICK_CYCLES;
+	if (bin >= PROFILER_HISTOGRAM_BINS)
+		bin = PROFILER_HISTOGRAM_BINS - 1;
+	stats->histogram[bin]++;
+}
+
+/**
+ * @brief Mark the beginning of a SysTick handler execution.
+ *
+ * A tick is considered late if it starts more than `PROFILER_LATE_CYCLES`
+ * after the previous one (i.e.: the handler was delayed by higher priority
+ * interruptions or a previous tick overran the period).
+ */
+void profiler_tick_start(void)
+{
+	uint32_t now = read_cycle_counter();
+
+	if (started && now - tick_start > PROFILER_LATE_CYCLES)
+		late_ticks++;
+	started = true;
+	tick_start = now;
+	stage_start = now;
+}
+
+/**
+ * @brief Mark the end of a stage of the SysTick handler.
+ *
+ * The next stage is considered to start right after.
+ *
+ * @param[in] stage Profiled stage.
+ */
+void profiler_stage_end(enum profiler_stage stage)
+{
+	uint32_t now = read_cycle_counter();
+
+	update_statistics(stage, now - stage_start);
+	stage_start = now;
+}
+
+/**
+ * @brief Mark the end of a SysTick handler execution.
+ *
+ * A tick overruns if the handler takes longer than the SysTick period.
+ */
+void profiler_tick_end(void)
+{
+	uint32_t cycles = read_cycle_counter() - tick_start;
+
+	if (cycles > PROFILER_TICK_CYCLES)
+		overrun_ticks++;
+	update_statistics(PROFILER_TOTAL, cycles);
+}
+
+/**
+ * @brief Reset all the profiler statistics.
+ */
+void profiler_reset(void)
+{
+	uint8_t i;
+
+	disable_systick_interruption();
+	for (i = 0; i < PROFILER_STAGES; i++)
+		statistics[i] = (struct profiler_statistics){0};
+	late_ticks = 0;
+	overrun_ticks = 0;
+	started = false;
+	enable_systick_interruption();
+}
+
+/**
+ * @brief Log the profiler statistics of each stage and the overruns count.
+ *
+ * Statistics are copied with the SysTick interruption disabled to get a
+ * consistent state, and logged afterwards.
+ *
+ * All values are in clock cycles, except for the histogram, which counts
+ * the number of measurements in each bin. Bins are evenly distributed along
+ * the SysTick period (`PROFILER_TICK_CYCLES`) and the last bin includes
+ * any longer measurement.
+ *
+ * Each line waits for room in the log transmission buffer, so none is
+ * discarded while the previous ones are sent.
+ */
+void log_profiler(void)
+{
+	uint8_t i;
+	uint32_t late;
+	uint32_t overrun;
+	uint32_t mean;
+	uint32_t *hist;
+	struct profiler_statistics copy[PROFILER_STAGES];
+
+	disable_systick_interruption();
+	for (i = 0; i < PROFILER_STAGES; i++)
+		copy[i] = statistics[i];
+	late = late_ticks;
+	overrun = overrun_ticks;
+	enable_systick_interruption();
+
+	serial_wait_free_space(SERIAL_LOG_LINE_SIZE);
+	LOG_INFO("{\"period\":%" PRIu32 ",\"late\":%" PRIu32
+		 ",\"overrun\":%" PRIu32 "}",
+		 (uint32_t)PROFILER_TICK_CYCLES, late, overrun);
+	for (i = 0; i < PROFILER_STAGES; i++) {
+		hist = copy[i].histogram;
+		mean = copy[i].count ? copy[i].sum / copy[i].count : 0;
+		serial_wait_free_space(SERIAL_LOG_LINE_SIZE);
+		LOG_INFO("{\"stage\":\"%s\",\"count\":%" PRIu32
+			 ",\"min\":%" PRIu32 ",\"max\":%" PRIu32
+			 ",\"mean\":%" PRIu32 ",\"histogram\":[%" PRIu32
+			 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32
+			 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "]}",
+			 stage_names[i], copy[i].count, copy[i].min,
+			 copy[i].max, mean, hist[0], hist[1], hist[2], hist[3],
+			 hist[4], hist[5], hist[6], hist[7]);
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef __PROFILER_H
+#define __PROFILER_H
+
+#include <inttypes.h>
+
+#include "mmlib/logging.h"
+
+#include "platform.h"
+#include "serial.h"
+#include "setup.h"
+
+/** Number of histogram bins, evenly distributed along the SysTick period */
+#define PROFILER_HISTOGRAM_BINS 8
+
+/** SysTick period, in clock cycles */
+#define PROFILER_TICK_CYCLES (SYSCLK_FREQUENCY_HZ / SYSTICK_FREQUENCY_HZ)
+
+/** Maximum delay allowed between consecutive ticks, in clock cycles */
+#define PROFILER_LATE_CYCLES (PROFILER_TICK_CYCLES + PROFILER_TICK_CYCLES / 16)
+
+/**
+ * Profiled stages of the SysTick handler.
+ *
+ * - Start: gyroscope burst read start and clock tick.
+ * - Battery: battery voltage reading.
+ * - Distance: sensors distance readings (slow loop only).
+ * - Gyro: gyroscope readings.
+ * - Encoder: encoders and speed readings.
+ * - Estimation: gyroscope bias and collision detection.
+ * - Control: trajectory playback, control loop, tuning metrics and sensors
+ *   schedule.
+ * - Logging: data logs, telemetry and control records.
+ */
+enum profiler_stage {
+	PROFILER_START,
+	PROFILER_BATTERY,
+	PROFILER_DISTANCE,
+	PROFILER_GYRO,
+	PROFILER_ENCODER,
+	PROFILER_ESTIMATION,
+	PROFILER_CONTROL,
+	PROFILER_LOGGING,
+	PROFILER_TOTAL,
+	PROFILER_STAGES,
+};
+
+/**
+ * Clock cycles statistics of a profiled stage.
+ */
+struct profiler_statistics {
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+	uint32_t histogram[PROFILER_HISTOGRAM_BINS];
+};
+
+void profiler_tick_start(void);
+void profiler_stage_end(enum profiler_stage stage);
+void profiler_tick_end(void);
+void profiler_reset(void);
+void log_profiler(void);
+
+#endif /* __PROFILER_H */
@@ -1,37 +1,117 @@
 #include "serial.h"
 
 static mutex_t _send_lock;
-static volatile bool received;
+
+/**
+ * Transmission ring buffer, with a single producer and a single consumer.
+ *
+ * Indexes are free-running: `head` is only written by the producer and
+ * `tail` is only written by the consumer (the DMA interruption). Their
+ * difference is the number of bytes pending to be sent. The producer copies
+ * the data into the free space before publishing the new `head`, so no lock
+ * is needed. Sizes must be powers of two, so indexes wrap around with them.
+ */
+struct tx_ring {
+	char *buffer;
+	uint32_t size;
+	volatile uint32_t head;
+	volatile uint32_t tail;
+};
+
+_Static_assert(!(SERIAL_TX_BUFFER_SIZE & (SERIAL_TX_BUFFER_SIZE - 1)),
+	       "Serial transmission buffer size must be a power of two");
+_Static_assert(!(SERIAL_TELEMETRY_BUFFER_SIZE &
+		 (SERIAL_TELEMETRY_BUFFER_SIZE - 1)),
+	       "Serial telemetry buffer size must be a power of two");
+
+/**
+ * Transmission rings: log messages, from thread mode and produced by the
+ * `_send_lock` owner, and live telemetry, produced by the SysTick handler.
+ *
+ * Both are only drained by `dma1_channel2_isr()`, which owns `tx_sending`
+ * (the ring being transferred, `NULL` when idle), `tx_chunk`, `tx_last` and
+ * `tx_wrapped` (whether the last chunk was cut at the end of its buffer).
+ */
+static char log_buffer[SERIAL_TX_BUFFER_SIZE];
+static char telemetry_buffer[SERIAL_TELEMETRY_BUFFER_SIZE];
+static struct tx_ring log_ring = {log_buffer, SERIAL_TX_BUFFER_SIZE, 0, 0};
+static struct tx_ring telemetry_ring = {
+    telemetry_buffer, SERIAL_TELEMETRY_BUFFER_SIZE, 0, 0};
+static struct tx_ring *tx_sending;
+static struct tx_ring *tx_last;
+static uint32_t tx_chunk;
+static bool tx_wrapped;
+static volatile struct serial_statistics statistics;
+
+/**
+ * Reception ring buffer, written by circular DMA.
+ *
+ * `rx_write` is the free-running number of bytes received, tracked from the
+ * DMA position on half-transfer, transfer-complete and idle line
+ * interruptions. Received bytes are scanned for `'\0'` terminators and each
+ * complete command is queued as a slice of the ring buffer, and copied to
+ * `command_buffer` when taken to be processed.
+ */
 static char receive_buffer[RECEIVE_BUFFER_SIZE];
+static char command_buffer[RECEIVE_BUFFER_SIZE];
+static volatile uint16_t rx_position;
+static volatile uint32_t rx_write;
+static volatile uint32_t rx_command_start;
+static volatile struct receive_slice rx_commands[SERIAL_COMMANDS];
+static volatile uint8_t rx_commands_head;
+static volatile uint8_t rx_commands_tail;
+static bool rx_taken;
+static uint16_t rx_taken_size;
 
 /**
  * @brief Try to acquire the serial transfer lock.
  *
+ * The lock is only held while the data is appended to the transmission
+ * buffer: `serial_send()` releases it.
+ *
  * @return Whether the lock was acquired or not.
  */
 bool serial_acquire_transfer_lock(void)
 {
-	return (bool)mutex_trylock(&_send_lock);
+	if (mutex_trylock(&_send_lock))
+		return true;
+	statistics.busy++;
+	return false;
 }
 
 /**
- * @brief Send data through serial.
+ * @brief Start a DMA transfer of the next contiguous pending chunk of a ring.
+ *
+ * DMA is configured to read the pending bytes from the ring buffer, up to the
+ * end of the buffer. It then writes all those bytes to USART3 (Bluetooth).
  *
- * DMA is configured to read from `data` a number `size` of bytes. It then
- * writes all those bytes to USART3 (Bluetooth).
+ * Producers publish whole messages, so the pending bytes always end at a
+ * message boundary, unless they are cut at the end of the buffer.
  *
  * An interruption is generated when the transfer is complete.
  *
- * @param[in] data Data to send.
- * @param[in] size Size (number of bytes) to send.
+ * @param[in] ring Ring with bytes pending to be sent.
  */
-void serial_send(char *data, int size)
+static void serial_transmit(struct tx_ring *ring)
 {
+	uint32_t offset;
+	uint32_t pending;
+
+	offset = ring->tail % ring->size;
+	pending = ring->head - ring->tail;
+	tx_wrapped = pending > ring->size - offset;
+	if (tx_wrapped)
+		pending = ring->size - offset;
+	tx_sending = ring;
+	tx_last = ring;
+	tx_chunk = pending;
+
 	dma_channel_reset(DMA1, DMA_CHANNEL2);
 
 	dma_set_peripheral_address(DMA1, DMA_CHANNEL2, (uint32_t)&USART3_DR);
-	dma_set_memory_address(DMA1, DMA_CHANNEL2, (uint32_t)data);
-	dma_set_number_of_data(DMA1, DMA_CHANNEL2, size);
+	dma_set_memory_address(DMA1, DMA_CHANNEL2,
+			       (uint32_t)&ring->buffer[offset]);
+	dma_set_number_of_data(DMA1, DMA_CHANNEL2, pending);
 	dma_set_read_from_memory(DMA1, DMA_CHANNEL2);
 	dma_enable_memory_increment_mode(DMA1, DMA_CHANNEL2);
 	dma_set_peripheral_size(DMA1, DMA_CHANNEL2, DMA_CCR_PSIZE_8BIT);
@@ -46,14 +126,208 @@ void serial_send(char *data, int size)
 }
 
 /**
- * @brief Receive data from serial.
+ * @brief Start the transfer of the next pending chunk, if any.
  *
- * DMA is configured to read from USART3 (Bluetooth) a number `size` of bytes.
- * It writes all those bytes to `data`.
+ * Rings take turns when both have bytes pending, so neither can starve the
+ * other. Turns are only taken at message boundaries: if the last chunk was
+ * cut at the end of its buffer, the rest is sent from the same ring first, so
+ * messages and frames are never interleaved. Only called from
+ * `dma1_channel2_isr()`.
+ */
+static void serial_transmit_next(void)
+{
+	struct tx_ring *first = &log_ring;
+	struct tx_ring *second = &telemetry_ring;
+
+	if (tx_wrapped) {
+		serial_transmit(tx_last);
+		return;
+	}
+	if (tx_last == &log_ring) {
+		first = &telemetry_ring;
+		second = &log_ring;
+	}
+	if (first->head != first->tail)
+		serial_transmit(first);
+	else if (second->head != second->tail)
+		serial_transmit(second);
+}
+
+/**
+ * @brief Append data to a transmission ring, as its only producer.
  *
- * An interruption is generated when the transfer is complete.
+ * Data is copied to the free space and then published by advancing `head`,
+ * and the DMA interruption is set pending so it starts a transfer if it is
+ * idle. If there is not enough free space, the data is discarded as a whole.
+ *
+ * @param[in] ring Transmission ring.
+ * @param[in] data Data to send.
+ * @param[in] size Size (number of bytes) to send.
+ * @param[in,out] high_water Maximum number of bytes pending in the ring.
+ *
+ * @return Whether the data was queued or not.
+ */
+static bool tx_ring_push(struct tx_ring *ring, const char *data, int size,
+			 volatile uint32_t *high_water)
+{
+	uint32_t head;
+	uint32_t used;
+	uint32_t offset;
+	uint32_t first;
+
+	if (size <= 0)
+		return true;
+	head = ring->head;
+	used = head - ring->tail;
+	if ((uint32_t)size > ring->size - used)
+		return false;
+
+	offset = head % ring->size;
+	first = ring->size - offset;
+	if (first > (uint32_t)size)
+		first = size;
+	memcpy(&ring->buffer[offset], data, first);
+	memcpy(ring->buffer, data + first, size - first);
+	__dmb();
+	ring->head = head + size;
+
+	used += size;
+	if (used > *high_water)
+		*high_water = used;
+
+	nvic_set_pending_irq(NVIC_DMA1_CHANNEL2_IRQ);
+	return true;
+}
+
+/**
+ * @brief Send data through serial.
+ *
+ * Data is copied to the log transmission ring, so it never blocks and the
+ * caller can reuse `data` right after the call. It is sent as the DMA
+ * transfers drain the ring (see `dma1_channel2_isr()`).
+ *
+ * If there is not enough free space in the ring, the data is discarded as a
+ * whole and the overflow is counted.
+ *
+ * The serial transfer lock is released.
+ *
+ * @param[in] data Data to send.
+ * @param[in] size Size (number of bytes) to send.
+ */
+void serial_send(char *data, int size)
+{
+	if (!tx_ring_push(&log_ring, data, size, &statistics.high_water))
+		statistics.overflows++;
+	mutex_unlock(&_send_lock);
+}
+
+/**
+ * @brief Send live telemetry through serial.
+ *
+ * The telemetry ring has a single producer, the SysTick handler, so no lock
+ * is taken and frames are never discarded because a log message is being
+ * queued. If there is not enough free space in the ring, the data is
+ * discarded as a whole and the overflow is counted.
+ *
+ * @param[in] data Data to send.
+ * @param[in] size Size (number of bytes) to send.
+ */
+void serial_send_telemetry(char *data, int size)
+{
+	if (!tx_ring_push(&telemetry_ring, data, size,
+			  &statistics.telemetry_high_water))
+		statistics.telemetry_overflows++;
+}
+
+/**
+ * @brief Get the free space in the log transmission ring, in bytes.
+ *
+ * Senders that must not lose data wait for enough free space before calling
+ * `serial_send()`, as the DMA transfers drain the ring.
+ */
+uint32_t serial_free_space(void)
+{
+	return log_ring.size - (log_ring.head - log_ring.tail);
+}
+
+/**
+ * @brief Wait for free space in the log transmission ring.
+ *
+ * To be called from thread mode before each line of multi-line outputs, as
+ * `serial_send()` never waits and discards whole messages that do not fit.
+ *
+ * @param[in] size Free space to wait for, in bytes.
+ */
+void serial_wait_free_space(uint32_t size)
+{
+	while (serial_free_space() < size)
+		;
+}
+
+/**
+ * @brief Get the serial transmission statistics.
+ *
+ * @param[out] output Serial transmission statistics.
+ */
+void get_serial_statistics(struct serial_statistics *output)
+{
+	output->overflows = statistics.overflows;
+	output->busy = statistics.busy;
+	output->high_water = statistics.high_water;
+	output->telemetry_overflows = statistics.telemetry_overflows;
+	output->telemetry_high_water = statistics.telemetry_high_water;
+	output->receive_overruns = statistics.receive_overruns;
+}
+
+/**
+ * @brief Reset the serial transmission statistics.
  */
-static void serial_receive(void)
+void serial_reset_statistics(void)
+{
+	statistics.overflows = 0;
+	statistics.busy = 0;
+	statistics.high_water = 0;
+	statistics.telemetry_overflows = 0;
+	statistics.telemetry_high_water = 0;
+	statistics.receive_overruns = 0;
+}
+
+/**
+ * @brief Log the serial transmission statistics.
+ *
+ * - Messages discarded because the transmission buffer was full.
+ * - Messages discarded because the transfer lock was busy.
+ * - Maximum number of bytes pending to be sent (and buffer size).
+ * - Telemetry frames discarded because the telemetry buffer was full.
+ * - Maximum number of telemetry bytes pending to be sent (and buffer size).
+ * - Commands received but lost before being processed.
+ */
+void log_serial_statistics(void)
+{
+	struct serial_statistics output;
+
+	get_serial_statistics(&output);
+	LOG_INFO("{\"overflows\":%" PRIu32 ",\"busy\":%" PRIu32
+		 ",\"high_water\":%" PRIu32 ",\"size\":%d"
+		 ",\"telemetry_overflows\":%" PRIu32
+		 ",\"telemetry_high_water\":%" PRIu32 ",\"telemetry_size\":%d"
+		 ",\"receive_overruns\":%" PRIu32 "}",
+		 output.overflows, output.busy, output.high_water,
+		 SERIAL_TX_BUFFER_SIZE, output.telemetry_overflows,
+		 output.telemetry_high_water, SERIAL_TELEMETRY_BUFFER_SIZE,
+		 output.receive_overruns);
+}
+
+/**
+ * @brief Start receiving data from serial.
+ *
+ * DMA is configured to read from USART3 (Bluetooth) into `receive_buffer`, in
+ * circular mode, so reception never stops.
+ *
+ * Interruptions are generated on half-transfer and transfer complete, which
+ * guarantees the DMA position is sampled at least twice per lap.
+ */
+void serial_start_receive(void)
 {
 	dma_channel_reset(DMA1, DMA_CHANNEL3);
 
@@ -62,10 +336,12 @@ static void serial_receive(void)
 	dma_set_number_of_data(DMA1, DMA_CHANNEL3, RECEIVE_BUFFER_SIZE);
 	dma_set_read_from_peripheral(DMA1, DMA_CHANNEL3);
 	dma_enable_memory_increment_mode(DMA1, DMA_CHANNEL3);
+	dma_enable_circular_mode(DMA1, DMA_CHANNEL3);
 	dma_set_peripheral_size(DMA1, DMA_CHANNEL3, DMA_CCR_PSIZE_8BIT);
 	dma_set_memory_size(DMA1, DMA_CHANNEL3, DMA_CCR_MSIZE_8BIT);
 	dma_set_priority(DMA1, DMA_CHANNEL3, DMA_CCR_PL_HIGH);
 
+	dma_enable_half_transfer_interrupt(DMA1, DMA_CHANNEL3);
 	dma_enable_transfer_complete_interrupt(DMA1, DMA_CHANNEL3);
 
 	dma_enable_channel(DMA1, DMA_CHANNEL3);
@@ -73,74 +349,242 @@ static void serial_receive(void)
 	usart_enable_rx_dma(USART3);
 }
 
+/**
+ * @brief Queue a complete command received.
+ *
+ * Empty commands are ignored. Commands are lost (and counted as overruns) if
+ * the queue is full or if they do not fit in the reception buffer.
+ *
+ * @param[in] start Free-running index of the first command character.
+ * @param[in] size Command size, without the `'\0'` terminator.
+ */
+static void queue_command(uint32_t start, uint32_t size)
+{
+	volatile struct receive_slice *slice;
+
+	if (!size)
+		return;
+	if (size >= RECEIVE_BUFFER_SIZE ||
+	    (uint8_t)(rx_commands_head - rx_commands_tail) >= SERIAL_COMMANDS) {
+		statistics.receive_overruns++;
+		return;
+	}
+	slice = &rx_commands[rx_commands_head % SERIAL_COMMANDS];
+	slice->start = start;
+	slice->size = (uint16_t)size;
+	rx_commands_head++;
+}
+
+/**
+ * @brief Free-running number of bytes received, from the live DMA position.
+ *
+ * @param[out] position DMA write position in the reception buffer.
+ */
+static uint32_t received_bytes(uint16_t *position)
+{
+	*position = RECEIVE_BUFFER_SIZE -
+		    dma_get_number_of_data(DMA1, DMA_CHANNEL3);
+	return rx_write + (uint16_t)(*position - rx_position +
+				     RECEIVE_BUFFER_SIZE) %
+			      RECEIVE_BUFFER_SIZE;
+}
+
+/**
+ * @brief Track the DMA write position and parse the new bytes received.
+ *
+ * Executed from the reception interruptions.
+ */
+static void serial_receive_update(void)
+{
+	uint16_t position;
+	uint32_t write;
+	uint32_t index;
+
+	write = received_bytes(&position);
+	rx_position = position;
+
+	for (index = rx_write; index != write; index++) {
+		if (receive_buffer[index % RECEIVE_BUFFER_SIZE] != '\0')
+			continue;
+		queue_command(rx_command_start, index - rx_command_start);
+		rx_command_start = index + 1;
+	}
+	rx_write = write;
+}
+
+/**
+ * @brief Copy a queued command out of the reception buffer.
+ *
+ * The DMA keeps writing while the command is copied, so the live DMA position
+ * is checked after the copy: if more than `RECEIVE_BUFFER_SIZE` bytes were
+ * received since the command started, its first bytes were overwritten.
+ *
+ * @return Whether the copy is intact.
+ */
+static bool copy_command(uint32_t start, uint16_t size)
+{
+	uint16_t offset = start % RECEIVE_BUFFER_SIZE;
+	uint16_t first = RECEIVE_BUFFER_SIZE - offset;
+	uint16_t position;
+	uint32_t received;
+
+	if (first > size)
+		first = size;
+	memcpy(command_buffer, &receive_buffer[offset], first);
+	memcpy(&command_buffer[first], receive_buffer, size - first);
+	command_buffer[size] = '\0';
+
+	cm_disable_interrupts();
+	received = received_bytes(&position);
+	cm_enable_interrupts();
+	return received - start <= RECEIVE_BUFFER_SIZE;
+}
+
+/**
+ * @brief Get the oldest command received and not yet released.
+ *
+ * The command is copied to `command_buffer` the first time it is taken, and
+ * served from there until released, so it can be parsed while new data keeps
+ * arriving.
+ *
+ * A command is only intact if it is taken before `RECEIVE_BUFFER_SIZE` bytes
+ * are received from its first character (i.e.: the command itself and those
+ * sent after it, while the previous ones are processed). Otherwise it is
+ * discarded and counted as an overrun. Senders should wait for each command
+ * to be acknowledged before sending more than that.
+ *
+ * @param[out] command Command data and size.
+ *
+ * @return Whether there was a command pending to be processed.
+ */
+bool get_received_command(struct serial_command *command)
+{
+	volatile struct receive_slice *slice;
+
+	while (!rx_taken && rx_commands_head != rx_commands_tail) {
+		slice = &rx_commands[rx_commands_tail % SERIAL_COMMANDS];
+		rx_taken_size = slice->size;
+		rx_taken = copy_command(slice->start, slice->size);
+		if (rx_taken)
+			break;
+		statistics.receive_overruns++;
+		rx_commands_tail++;
+	}
+	if (!rx_taken)
+		return false;
+
+	command->data = command_buffer;
+	command->size = rx_taken_size;
+	return true;
+}
+
+/**
+ * @brief Release the oldest command received, once processed.
+ */
+void release_received_command(void)
+{
+	if (!rx_taken)
+		return;
+	rx_taken = false;
+	rx_commands_tail++;
+}
+
 /**
  * @brief DMA 1 channel 2 interruption routine.
  *
- * Executed on serial transfer complete. Clears the interruption flag, and
- * disables serial transfer DMA until next call to `serial_send()`.
+ * Executed on serial transfer complete, and set pending by the producers
+ * whenever they queue data. It is the only consumer of the transmission rings.
  *
- * It will also release the serial transfer lock.
+ * On transfer complete, it clears the interruption flag, disables serial
+ * transfer DMA and releases the chunk sent. If no transfer is in progress,
+ * the next pending chunk transfer is started. A pending data notification
+ * while a transfer is in progress is ignored: the data is picked up when the
+ * transfer completes.
  */
 void dma1_channel2_isr(void)
 {
-	if (dma_get_interrupt_flag(DMA1, DMA_CHANNEL2, DMA_TCIF))
+	if (tx_sending) {
+		if (!dma_get_interrupt_flag(DMA1, DMA_CHANNEL2, DMA_TCIF))
+			return;
 		dma_clear_interrupt_flags(DMA1, DMA_CHANNEL2, DMA_TCIF);
 
-	dma_disable_transfer_complete_interrupt(DMA1, DMA_CHANNEL2);
-	usart_disable_tx_dma(USART3);
-	dma_disable_channel(DMA1, DMA_CHANNEL2);
-	mutex_unlock(&_send_lock);
+		dma_disable_transfer_complete_interrupt(DMA1, DMA_CHANNEL2);
+		usart_disable_tx_dma(USART3);
+		dma_disable_channel(DMA1, DMA_CHANNEL2);
+
+		tx_sending->tail += tx_chunk;
+		tx_sending = NULL;
+	}
+	serial_transmit_next();
 }
 
 /**
  * @brief DMA 1 channel 3 interruption routine.
  *
- * Executed on serial receive complete. Clears the interruption flag, and
- * resets the receive DMA by calling `serial_receive()`.
- *
- * This function should never be reached. Commands should be processed before
- * on USART idle line interruption.
+ * Executed on serial receive half-transfer and transfer complete. Clears the
+ * interruption flags and parses the bytes received.
  **/
 void dma1_channel3_isr(void)
 {
+	if (dma_get_interrupt_flag(DMA1, DMA_CHANNEL3, DMA_HTIF))
+		dma_clear_interrupt_flags(DMA1, DMA_CHANNEL3, DMA_HTIF);
 	if (dma_get_interrupt_flag(DMA1, DMA_CHANNEL3, DMA_TCIF))
 		dma_clear_interrupt_flags(DMA1, DMA_CHANNEL3, DMA_TCIF);
 
-	dma_disable_transfer_complete_interrupt(DMA1, DMA_CHANNEL3);
-	usart_disable_rx_dma(USART3);
-	dma_disable_channel(DMA1, DMA_CHANNEL3);
-	LOG_ERROR("Receive buffer is full! Resetting...");
-	serial_receive();
+	serial_receive_update();
 }
 
 /**
  * @brief USART interruption routine.
  *
- * On RX interruption it will process the data received and, in case it finds
- * a `'\0'` character, the `process_command` function will be executed.
+ * On idle line interruption it will parse the bytes received, so commands are
+ * available as soon as the transmission stops.
  */
 void usart3_isr(void)
 {
 	/* Only execute on idle interrupt */
 	if (((USART_CR1(USART3) & USART_CR1_IDLEIE) != 0) &&
 	    usart_idle_line_detected(USART3)) {
-		received = true;
 		usart_clear_idle_line_detected(USART3);
-		serial_receive();
+		serial_receive_update();
 	}
 }
 
+/**
+ * @brief Whether there is a received command pending to be processed.
+ */
 bool get_received_command_flag(void)
 {
-	return received;
+	struct serial_command command;
+
+	return get_received_command(&command);
 }
 
+/**
+ * @brief Set the received command flag.
+ *
+ * Setting it to `false` releases the command being processed. Commands are
+ * flagged on reception, so setting it to `true` has no effect.
+ *
+ * @param[in] value Flag value.
+ */
 void set_received_command_flag(bool value)
 {
-	received = value;
+	if (!value)
+		release_received_command();
 }
 
+/**
+ * @brief Get the command being processed, as a `'\0'`-terminated string.
+ *
+ * An empty string is returned if there is no command pending.
+ */
 char *get_received_serial_buffer(void)
 {
-	return receive_buffer;
+	struct serial_command command;
+	static char empty[1];
+
+	if (!get_received_command(&command))
+		return empty;
+	return command.data;
 }
@@ -1,16 +1,97 @@
 #ifndef __SERIAL_H
 #define __SERIAL_H
 
+#include <inttypes.h>
+#include <string.h>
+
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/nvic.h>
 #include <libopencm3/cm3/sync.h>
 #include <libopencm3/stm32/usart.h>
 
 #include "mmlib/logging.h"
 #include "mylibopencm3.h"
 
+/**
+ * Reception ring buffer size, in bytes. A command must be taken before this
+ * many bytes are received from its first character, or it is overwritten and
+ * discarded (see `get_received_command()`).
+ */
 #define RECEIVE_BUFFER_SIZE 256
+#define SERIAL_COMMANDS 8
+
+/**
+ * Transmission buffers, in bytes: one for log messages and another one for
+ * the live telemetry streamed from the SysTick handler, large enough for the
+ * frames generated while a log chunk is transferred. Sizes must be powers of
+ * two and can be changed at build time (`make SERIAL_TX_BUFFER_SIZE=2048
+ * SERIAL_TELEMETRY_BUFFER_SIZE=1024`).
+ */
+#ifndef SERIAL_TX_BUFFER_SIZE
+#define SERIAL_TX_BUFFER_SIZE 1024
+#endif
+#ifndef SERIAL_TELEMETRY_BUFFER_SIZE
+#define SERIAL_TELEMETRY_BUFFER_SIZE 512
+#endif
+
+/**
+ * Free space waited for before each line of multi-line command outputs, in
+ * bytes, larger than any log line (see `serial_wait_free_space()`).
+ */
+#define SERIAL_LOG_LINE_SIZE 256
+
+/**
+ * Serial transmission statistics.
+ *
+ * - Messages discarded because the transmission buffer was full.
+ * - Messages discarded because the transfer lock was busy.
+ * - Maximum number of bytes pending to be sent in the transmission buffer.
+ * - Telemetry frames discarded because the telemetry buffer was full.
+ * - Maximum number of bytes pending to be sent in the telemetry buffer.
+ * - Commands received but lost before being processed.
+ */
+struct serial_statistics {
+	uint32_t overflows;
+	uint32_t busy;
+	uint32_t high_water;
+	uint32_t telemetry_overflows;
+	uint32_t telemetry_high_water;
+	uint32_t receive_overruns;
+};
+
+/**
+ * Received command, as a slice of the reception ring buffer.
+ *
+ * - Free-running index of the first command character.
+ * - Command size, without the `'\0'` terminator.
+ */
+struct receive_slice {
+	uint32_t start;
+	uint16_t size;
+};
+
+/**
+ * Received command handed out to be processed.
+ *
+ * - `'\0'`-terminated command string.
+ * - Command size, without the `'\0'` terminator.
+ */
+struct serial_command {
+	char *data;
+	uint16_t size;
+};
 
 bool serial_acquire_transfer_lock(void);
 void serial_send(char *data, int size);
+void serial_send_telemetry(char *data, int size);
+uint32_t serial_free_space(void);
+void serial_wait_free_space(uint32_t size);
+void get_serial_statistics(struct serial_statistics *output);
+void serial_reset_statistics(void);
+void log_serial_statistics(void);
+void serial_start_receive(void);
+bool get_received_command(struct serial_command *command);
+void release_received_command(void);
 bool get_received_command_flag(void);
 void set_received_command_flag(bool value);
 char *get_received_serial_buffer(void);
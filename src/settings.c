@@ -0,0 +1,103 @@
+#include "settings.h"
+
+#define SETTINGS_CRC_WORDS ((sizeof(struct settings) - sizeof(uint32_t)) / 4)
+
+/**
+ * @brief Calculate the CRC-32 of the settings, excluding the CRC itself.
+ */
+static uint32_t settings_crc(struct settings *settings)
+{
+	crc_reset();
+	return crc_calculate_block((uint32_t *)settings, SETTINGS_CRC_WORDS);
+}
+
+/**
+ * @brief Load the settings saved in flash, if any.
+ *
+ * To be called at boot, before any configuration is used (i.e.: before
+ * `kinematic_configuration()`). Settings with a different version or size
+ * or with a wrong CRC are discarded, and the defaults are kept. So are
+ * settings saved by a build with a different `SYSTICK_FREQUENCY_HZ`, as their
+ * control gains would be scaled for another loop frequency, and settings with
+ * sensors calibration constants out of the fixed point range (see
+ * `sensors_calibration_valid()`).
+ *
+ * @return Whether the settings were loaded.
+ */
+bool load_settings(void)
+{
+	uint8_t i;
+	struct settings settings;
+
+	if (storage_read(STORAGE_KEY_SETTINGS, (uint8_t *)&settings,
+			 sizeof(settings)) != sizeof(settings))
+		return false;
+	if (settings.version != SETTINGS_VERSION ||
+	    settings.size != sizeof(settings) ||
+	    settings.crc != settings_crc(&settings)) {
+		LOG_ERROR("Discarding invalid settings (version %d)",
+			  settings.version);
+		return false;
+	}
+	if (settings.systick_frequency != SYSTICK_FREQUENCY_HZ) {
+		LOG_ERROR("Discarding settings saved at %" PRIu32 " Hz",
+			  settings.systick_frequency);
+		return false;
+	}
+	for (i = 0; i < NUM_SENSOR; i++) {
+		if (!sensors_calibration_valid(settings.sensors_a[i],
+					       settings.sensors_b[i])) {
+			LOG_ERROR("Invalid sensor %d calibration", i);
+			return false;
+		}
+	}
+
+	set_micrometers_per_count(settings.micrometers_per_count);
+	set_control_constants(settings.control);
+	set_linear_speed_limit(settings.linear_speed_limit);
+	for (i = 0; i < NUM_SENSOR; i++)
+		set_sensors_calibration(i, settings.sensors_a[i],
+					settings.sensors_b[i]);
+	return true;
+}
+
+/**
+ * @brief Save the current settings in flash.
+ *
+ * Only the words which changed since the last save are written (see
+ * `storage_write()`).
+ *
+ * @return Flash state.
+ */
+uint32_t save_settings(void)
+{
+	uint8_t i;
+	struct settings settings;
+
+	memset(&settings, 0, sizeof(settings));
+	settings.version = SETTINGS_VERSION;
+	settings.size = sizeof(settings);
+	settings.systick_frequency = SYSTICK_FREQUENCY_HZ;
+	settings.micrometers_per_count = get_micrometers_per_count();
+	settings.control = get_control_constants();
+	settings.linear_speed_limit = get_linear_speed_limit();
+	for (i = 0; i < NUM_SENSOR; i++)
+		get_sensors_calibration(i, &settings.sensors_a[i],
+					&settings.sensors_b[i]);
+	settings.crc = settings_crc(&settings);
+
+	return storage_write(STORAGE_KEY_SETTINGS, (uint8_t *)&settings,
+			     sizeof(settings));
+}
+
+/**
+ * @brief Erase the settings saved in flash.
+ *
+ * Defaults will be used after the next reset.
+ *
+ * @return Flash state.
+ */
+uint32_t erase_settings(void)
+{
+	return storage_erase(STORAGE_KEY_SETTINGS);
+}
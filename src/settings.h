@@ -0,0 +1,46 @@
+#ifndef __SETTINGS_H
+#define __SETTINGS_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <libopencm3/stm32/crc.h>
+
+#include "mmlib/logging.h"
+
+#include "config.h"
+#include "detection.h"
+#include "storage.h"
+
+/** Increase whenever `struct settings` changes */
+#define SETTINGS_VERSION 2
+
+/**
+ * Tunable settings persisted in flash.
+ *
+ * - Version and size of the structure, to discard incompatible settings.
+ * - Control loop frequency the settings were saved with, as control gains
+ *   are scaled with it (see `CONTROL_FREQUENCY_SCALE`).
+ * - Locomotion, control and speed configuration (see `config.c`).
+ * - Sensors calibration constants (see `set_sensors_calibration()`).
+ * - CRC-32 of all the previous words, calculated with the CRC unit.
+ */
+struct settings {
+	uint16_t version;
+	uint16_t size;
+	uint32_t systick_frequency;
+	float micrometers_per_count;
+	struct control_constants control;
+	float linear_speed_limit;
+	float sensors_a[NUM_SENSOR];
+	float sensors_b[NUM_SENSOR];
+	uint32_t crc;
+};
+
+bool load_settings(void);
+uint32_t save_settings(void);
+uint32_t erase_settings(void);
+
+#endif /* __SETTINGS_H */
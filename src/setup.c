@@ -1,8 +1,17 @@
 #include "setup.h"
+#include "detection.h"
+#include "serial.h"
+#include "storage.h"
 
 /** Exception priorities */
 #define PRIORITY_FACTOR 16
 
+/** Sensors sweep timing, in TIM1 counter ticks (1 MHz) */
+#define SENSORS_TIMER_FREQUENCY_HZ 1000000
+#define SENSORS_SLOT_PERIOD 125
+#define SENSORS_SLOT_EMITTERS 1
+#define SENSORS_SLOT_ADC_TRIGGER 63
+
 /**
  * @brief Initial clock setup.
  *
@@ -52,6 +61,9 @@ static void setup_clock(void)
 	/* DMA */
 	rcc_periph_clock_enable(RCC_DMA1);
 
+	/* CRC (settings) */
+	rcc_periph_clock_enable(RCC_CRC);
+
 	/* Enable clock cycle counter */
 	dwt_enable_cycle_counter();
 }
@@ -64,7 +76,9 @@ static void setup_clock(void)
  *
  * Exception priorities:
  *
- * - TIM1_UP with priority 0.
+ * - DMA 1 channel 1 with priority 0.
+ * - SPI2 (gyroscope burst) with priority 0 with NVIC.
+ * - TIM2 and TIM4 (encoder edges) with priority 0 with NVIC.
  * - Systick priority to 1 with SCB.
  * - DMA 1 channel 2 with priority 2 with NVIC.
  * - DMA 1 channel 3 with priority 2 with NVIC.
@@ -72,10 +86,12 @@ static void setup_clock(void)
  *
  * Interruptions enabled:
  *
- * - TIM1 Update interrupt.
+ * - DMA 1 channel 1 interrupt.
+ * - SPI2 interrupt.
  * - DMA 1 channel 2 interrupt.
  * - DMA 1 channel 3 interrupt.
  * - USART3 interrupt.
+ * - TIM2 and TIM4 interrupts (capture interrupts enabled on demand).
  *
  * @note The priority levels are assigned on steps of 16 because the processor
  * implements only bits[7:4].
@@ -84,16 +100,22 @@ static void setup_clock(void)
  */
 static void setup_exceptions(void)
 {
-	nvic_set_priority(NVIC_TIM1_UP_IRQ, 0);
+	nvic_set_priority(NVIC_DMA1_CHANNEL1_IRQ, 0);
+	nvic_set_priority(NVIC_SPI2_IRQ, 0);
+	nvic_set_priority(NVIC_TIM2_IRQ, 0);
+	nvic_set_priority(NVIC_TIM4_IRQ, 0);
 	nvic_set_priority(NVIC_SYSTICK_IRQ, PRIORITY_FACTOR * 1);
 	nvic_set_priority(NVIC_DMA1_CHANNEL2_IRQ, PRIORITY_FACTOR * 2);
 	nvic_set_priority(NVIC_DMA1_CHANNEL3_IRQ, PRIORITY_FACTOR * 2);
 	nvic_set_priority(NVIC_USART3_IRQ, PRIORITY_FACTOR * 2);
 
-	nvic_enable_irq(NVIC_TIM1_UP_IRQ);
+	nvic_enable_irq(NVIC_DMA1_CHANNEL1_IRQ);
+	nvic_enable_irq(NVIC_SPI2_IRQ);
 	nvic_enable_irq(NVIC_DMA1_CHANNEL2_IRQ);
 	nvic_enable_irq(NVIC_DMA1_CHANNEL3_IRQ);
 	nvic_enable_irq(NVIC_USART3_IRQ);
+	nvic_enable_irq(NVIC_TIM2_IRQ);
+	nvic_enable_irq(NVIC_TIM4_IRQ);
 }
 
 /**
@@ -178,6 +200,8 @@ static void setup_usart(void)
 	usart_enable_idle_line_interrupt(USART3);
 
 	usart_enable(USART3);
+
+	serial_start_receive();
 }
 
 /**
@@ -240,6 +264,8 @@ void setup_spi_low_speed(void)
  * - Configure channels 1, 2, 3 and 4 as output GPIOs.
  * - Set output compare mode to PWM1 (output is active when the counter is
  *   less than the compare register contents and inactive otherwise.
+ * - Enable output compare preload, so new values are only applied on update
+ *   events (at the start of the next PWM period).
  * - Reset output compare value (set it to 0).
  * - Enable channels 1, 2, 3 and 4 outputs.
  * - Enable counter for TIM3.
@@ -262,6 +288,10 @@ static void setup_motor_driver(void)
 	timer_set_oc_mode(TIM3, TIM_OC2, TIM_OCM_PWM1);
 	timer_set_oc_mode(TIM3, TIM_OC3, TIM_OCM_PWM1);
 	timer_set_oc_mode(TIM3, TIM_OC4, TIM_OCM_PWM1);
+	timer_enable_oc_preload(TIM3, TIM_OC1);
+	timer_enable_oc_preload(TIM3, TIM_OC2);
+	timer_enable_oc_preload(TIM3, TIM_OC3);
+	timer_enable_oc_preload(TIM3, TIM_OC4);
 	timer_set_oc_value(TIM3, TIM_OC1, 0);
 	timer_set_oc_value(TIM3, TIM_OC2, 0);
 	timer_set_oc_value(TIM3, TIM_OC3, 0);
@@ -292,11 +322,10 @@ static void setup_motor_driver(void)
  */
 void setup_speaker(void)
 {
-	rcc_periph_reset_pulse(RST_TIM1);
-
 	/* Make sure to turn emitters off */
-	gpio_clear(GPIOA, GPIO8 | GPIO9);
-	gpio_clear(GPIOB, GPIO8 | GPIO9);
+	stop_sensors_sweep();
+
+	rcc_periph_reset_pulse(RST_TIM1);
 
 	timer_set_mode(TIM1, TIM_CR1_CKD_CK_INT, TIM_CR1_CMS_EDGE,
 		       TIM_CR1_DIR_UP);
@@ -319,6 +348,8 @@ void setup_speaker(void)
  * - Set the Auto-Reload Register (TIMx_ARR).
  * - Set the encoder interface mode counting on both TI1 and TI2 edges.
  * - Configure inputs (see note).
+ * - Enable input capture on channel 1, latching the counter on TI1 rising
+ *   edges to timestamp them at low speed (see `update_encoders()`).
  * - Enable counter.
  *
  * @param[in] timer_peripheral Timer register address base to configure.
@@ -334,6 +365,7 @@ static void configure_timer_as_quadrature_encoder(uint32_t timer_peripheral)
 	timer_slave_set_mode(timer_peripheral, 0x3);
 	timer_ic_set_input(timer_peripheral, TIM_IC1, TIM_IC_IN_TI1);
 	timer_ic_set_input(timer_peripheral, TIM_IC2, TIM_IC_IN_TI2);
+	timer_ic_enable(timer_peripheral, TIM_IC1);
 	timer_enable_counter(timer_peripheral);
 }
 
@@ -400,57 +432,58 @@ static void start_adc(uint32_t adc)
 }
 
 /**
- * @brief Setup for ADC 1: Four injected channels on scan mode.
+ * @brief Setup for ADC 1: Eight regular conversions on discontinuous mode.
  *
- * - Initialize channel_sequence structure to map physical channels
- *   versus software injected channels. The order to read the sensors is: left
- *   side, right side, left front, right front.
  * - Power off the ADC to be sure that does not run during configuration.
- * - Enable scan mode with single conversion mode triggered by software.
+ * - Enable scan mode with discontinuous mode, converting one channel of the
+ *   sequence on each TIM1 compare 1 event.
  * - Configure the alignment (right) and the sample time (13.5 cycles of ADC
  *   clock).
- * - Set injected sequence with `channel_sequence` structure.
  * - Start the ADC.
  *
- * @note This ADC reads phototransistor sensors measurements.
+ * The regular sequence maps the physical channels to the sweep slots, where
+ * each sensor is read twice, once with the emitter off and then with the
+ * emitter on. It is set before each sweep, as the sensors schedule requires
+ * (see `start_sensors_sweep()`).
+ *
+ * @note This ADC reads phototransistor sensors measurements. Results are
+ * moved to memory with DMA (see `start_sensors_sweep()`).
  *
  * @see Reference manual (RM0008) "Analog-to-digital converter" and in
- * particular "Scan mode" section.
+ * particular "Scan mode" and "Discontinuous mode" sections.
  *
  * @see Pinout section from project official documentation
  * (https://bulebule.readthedocs.io/)
  */
 static void setup_adc1(void)
 {
-	uint8_t channel_sequence[4] = {ADC_CHANNEL4, ADC_CHANNEL3, ADC_CHANNEL5,
-				       ADC_CHANNEL2};
-
 	adc_power_off(ADC1);
 	adc_enable_scan_mode(ADC1);
 	adc_set_single_conversion_mode(ADC1);
-	adc_enable_external_trigger_injected(ADC1, ADC_CR2_JEXTSEL_JSWSTART);
+	adc_enable_discontinuous_mode_regular(ADC1, 1);
+	adc_enable_external_trigger_regular(ADC1, ADC_CR2_EXTSEL_TIM1_CC1);
 	adc_set_right_aligned(ADC1);
 	adc_set_sample_time_on_all_channels(ADC1, ADC_SMPR_SMP_13DOT5CYC);
-	adc_set_injected_sequence(
-	    ADC1, sizeof(channel_sequence) / sizeof(channel_sequence[0]),
-	    channel_sequence);
 	start_adc(ADC1);
 }
 
 /**
- * @brief Setup for ADC 2: configured for regular conversion.
+ * @brief Setup for ADC 2: configured for continuous regular conversion.
  *
  * - Power off the ADC to be sure that does not run during configuration.
  * - Disable scan mode.
- * - Set single conversion mode triggered by software.
- * - Configure the alignment (right) and the sample time (13.5 cycles of ADC
- *   clock).
+ * - Set continuous conversion mode, started once by software.
+ * - Configure the alignment (right) and the sample time (239.5 cycles of ADC
+ *   clock, the battery is read through a high impedance voltage divider).
  * - Set regular sequence with `channel_sequence` structure.
- * - Start the ADC.
+ * - Start the ADC and the conversions.
  *
- * @note This ADC reads the battery status.
+ * @note This ADC reads the battery status. ADC2 has no DMA request, so the
+ * latest conversion is sampled on each SysTick (see
+ * `update_battery_voltage()`).
  *
- * @see Reference manual (RM0008) "Analog-to-digital converter".
+ * @see Reference manual (RM0008) "Analog-to-digital converter" and in
+ * particular "Continuous conversion mode" section.
  */
 static void setup_adc2(void)
 {
@@ -459,34 +492,43 @@ static void setup_adc2(void)
 	channel_sequence[0] = ADC_CHANNEL0;
 	adc_power_off(ADC2);
 	adc_disable_scan_mode(ADC2);
-	adc_set_single_conversion_mode(ADC2);
+	adc_set_continuous_conversion_mode(ADC2);
 	adc_disable_external_trigger_regular(ADC2);
 	adc_set_right_aligned(ADC2);
-	adc_set_sample_time_on_all_channels(ADC2, ADC_SMPR_SMP_13DOT5CYC);
+	adc_set_sample_time_on_all_channels(ADC2, ADC_SMPR_SMP_239DOT5CYC);
 	adc_set_regular_sequence(ADC2, 1, channel_sequence);
 	start_adc(ADC2);
+	adc_start_conversion_direct(ADC2);
 }
 
 /**
  * @brief TIM1 setup.
  *
- * The TIM1 generates an update event interruption that invokes the
- * function tim1_up_isr.
+ * The TIM1 drives the sensors sweep. Each TIM1 period is a sweep slot, in
+ * which a single phototransistor is read with its emitter either off or on
+ * (see `start_sensors_sweep()`).
  *
  * - Set TIM1 default values.
  * - Configure the base time (no clock division ratio, no aligned mode,
  *   direction up).
- * - Set clock division, prescaler and period parameters to get an update
- *   event with a frequency of 16 KHz. 16 interruptions by ms, 4 sensors with
- *   4 states.
+ * - Set clock division, prescaler and period parameters to get a slot
+ *   frequency of 8 KHz. 8 slots by ms, 4 sensors read with emitter off
+ *   and on.
  *
  *   \f$frequency = \frac{timerclock}{(preescaler + 1)(period + 1)}\f$
  *
- * - Enable the TIM1.
- * - Enable the interruption of type update event on the TIM1.
+ * - Configure compare 3 and 4 to generate DMA requests at the beginning of
+ *   each slot, to set the emitters state.
+ * - Configure compare 1 in PWM2 mode to trigger the ADC conversion once the
+ *   phototransistor reading is stable.
+ * - Start the sensors sweep and enable the TIM1.
  *
  * @note The TIM1 is conected to the APB2 prescaler.
  *
+ * @note Compare 1 output must be enabled (main output as well) for the event
+ * to trigger the ADC. The emitter pin (PA8) is not affected as it is
+ * configured as a general purpose output.
+ *
  * @see Reference manual (RM0008) "Advanced-control timers"
  */
 void setup_emitters(void)
@@ -496,10 +538,20 @@ void setup_emitters(void)
 	timer_set_mode(TIM1, TIM_CR1_CKD_CK_INT, TIM_CR1_CMS_EDGE,
 		       TIM_CR1_DIR_UP);
 	timer_set_clock_division(TIM1, 0x00);
-	timer_set_prescaler(TIM1, (rcc_apb2_frequency / 160000 - 1));
-	timer_set_period(TIM1, 10 - 1);
+	timer_set_prescaler(
+	    TIM1, (rcc_apb2_frequency / SENSORS_TIMER_FREQUENCY_HZ - 1));
+	timer_set_period(TIM1, SENSORS_SLOT_PERIOD - 1);
+
+	timer_set_oc_value(TIM1, TIM_OC3, SENSORS_SLOT_EMITTERS);
+	timer_set_oc_value(TIM1, TIM_OC4, SENSORS_SLOT_EMITTERS);
+	timer_set_oc_mode(TIM1, TIM_OC1, TIM_OCM_PWM2);
+	timer_set_oc_value(TIM1, TIM_OC1, SENSORS_SLOT_ADC_TRIGGER);
+	timer_enable_oc_output(TIM1, TIM_OC1);
+	timer_enable_break_main_output(TIM1);
+
+	start_sensors_sweep();
+	timer_enable_irq(TIM1, TIM_DIER_CC3DE | TIM_DIER_CC4DE);
 	timer_enable_counter(TIM1);
-	timer_enable_irq(TIM1, TIM_DIER_UIE);
 }
 
 /**
@@ -516,7 +568,7 @@ void setup(void)
 	setup_encoders();
 	setup_motor_driver();
 	setup_mpu();
+	storage_init();
 	setup_systick();
 	setup_emitters();
-	setup_adc1();
 }
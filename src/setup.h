@@ -1,6 +1,14 @@
 #ifndef __SETUP_H
 #define __SETUP_H
 
+/**
+ * The host simulator (`MMSIM_SIMULATION`) only uses the constants defined
+ * here, so it does not need libopencm3.
+ */
+#ifdef MMSIM_SIMULATION
+#include <stdbool.h>
+#include <stdint.h>
+#else
 #include <libopencm3/cm3/dwt.h>
 #include <libopencm3/cm3/nvic.h>
 #include <libopencm3/cm3/scb.h>
@@ -16,6 +24,7 @@
 #include "mmlib/mpu.h"
 
 #include "mylibopencm3.h"
+#endif
 
 /** Universal constants */
 #define MICROMETERS_PER_METER 1000000
@@ -45,13 +54,43 @@
 #define MOUSE_MOMENT_OF_INERTIA 0.000125
 #define MOUSE_WHEELS_SEPARATION 0.065
 #define MOUSE_MAX_ANGULAR_VELOCITY 20
+#define MOUSE_WHEEL_RADIUS 0.01
+
+/** Gyroscope sensitivity (full scale of 1000 degrees per second) */
+#define MPU_GYRO_LSB_PER_DPS 32.8
+
+/** Motors (Faulhaber 1524B009SR) and gears (15 to 60 teeth), SI units */
+#define MOTOR_RESISTANCE 10.6
+#define MOTOR_TORQUE_CONSTANT 0.00823
+#define MOTOR_BACK_EMF_CONSTANT 0.00823
+#define MOTOR_GEAR_RATIO 4.
 
 /** System clock frequency is set in `setup_clock` */
 #define SYSCLK_FREQUENCY_HZ 72000000
 #define SPEAKER_BASE_FREQUENCY_HZ 1000000
-#define SYSTICK_FREQUENCY_HZ 1000
 #define DRIVER_PWM_PERIOD 1024
 
+/**
+ * SysTick frequency, at which the fast control loop runs (encoders, gyroscope
+ * and motor control).
+ *
+ * The slow loop (distance readings, which are used for walls control, and
+ * data logging) runs at `SYSTICK_SLOW_FREQUENCY_HZ`, which should not be
+ * greater than the sensors sweep frequency (1 kHz).
+ *
+ * Both can be selected at build time (i.e.: `make SYSTICK_FREQUENCY_HZ=2000`).
+ */
+#ifndef SYSTICK_FREQUENCY_HZ
+#define SYSTICK_FREQUENCY_HZ 1000
+#endif
+#ifndef SYSTICK_SLOW_FREQUENCY_HZ
+#define SYSTICK_SLOW_FREQUENCY_HZ 1000
+#endif
+#define SYSTICK_SLOW_DIVIDER (SYSTICK_FREQUENCY_HZ / SYSTICK_SLOW_FREQUENCY_HZ)
+#if SYSTICK_FREQUENCY_HZ % SYSTICK_SLOW_FREQUENCY_HZ
+#error "SYSTICK_FREQUENCY_HZ must be a multiple of SYSTICK_SLOW_FREQUENCY_HZ"
+#endif
+
 /**
  * Maximum PWM period (should be <= DRIVER_PWM_PERIOD).
  *
@@ -66,7 +105,8 @@
  *
  * After reaching this period we consider there has been a collision. When a
  * collision occurs, the robot motor control stops working and the motor driver
- * is disabled.
+ * is disabled. The saturation reported is fed by the acceleration residuals
+ * detector (see `motor_driver_saturation()`).
  */
 #define MAX_MOTOR_DRIVER_SATURATION_PERIOD 0.01
 
@@ -92,14 +132,21 @@
  * The memory organization is based on a main memory block containing 64 pages
  * of 1 Kbyte (for medium-density devices), and an information block.
  *
- * The linker file was modified to reserve the last memory page for EEPROM.
- * FLASH_EEPROM_ADDRESS = FLASH_BASE + FLASH_EEPROM_PAGE_NUM * FLASH_PAGE_SIZE
+ * The linker file was modified to reserve the last memory pages for storage.
+ * FLASH_STORAGE_ADDRESS = FLASH_BASE + FLASH_STORAGE_PAGE_NUM * FLASH_PAGE_SIZE
  * FLASH_BASE = 0x08000000
- * FLASH_EEPROM_PAGE_NUM = 63
+ * FLASH_STORAGE_PAGE_NUM = 60
  * FLASH_PAGE_SIZE = 0x400 (1 Kbyte)
  *
+ * The maze, which used to be saved on a single page, is now saved on the
+ * log-structured storage (see `storage.c`). `FLASH_EEPROM_ADDRESS_MAZE` is
+ * kept as its identifier for `eeprom_flash_page()` and `eeprom_read_data()`.
+ *
  * @see Programming manual (PM0075) "Flash module organization"
  */
+#define FLASH_STORAGE_ADDRESS ((uint32_t)(0x0800f000))
+#define FLASH_STORAGE_PAGE_SIZE 1024
+#define FLASH_STORAGE_PAGES 4
 #define FLASH_EEPROM_ADDRESS_MAZE ((uint32_t)(0x0800fc00))
 
 void setup(void);
@@ -0,0 +1,235 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "maze_file.h"
+#include "mouse.h"
+
+static const char usage[] =
+	"Usage: benchmark [--jobs N] [--force F] [--timeout S] MAZE...\n"
+	"\n"
+	"Explore and solve competition mazes (.maz or text files) with the\n"
+	"simulated mouse, using all the host cores by default. One JSON line\n"
+	"is printed for each maze, in order, and a summary at the end.\n";
+
+struct options {
+	long jobs;
+	float force;
+	double timeout;
+	int first;
+};
+
+/** Result sent by a worker, small enough for pipe writes to be atomic */
+struct record {
+	uint32_t index;
+	bool loaded;
+	struct mouse_result result;
+};
+
+static double seconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int parse_options(int argc, char **argv, struct options *options)
+{
+	int i;
+
+	options->jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	options->force = 0.25;
+	options->timeout = 600.;
+	for (i = 1; i < argc && !strncmp(argv[i], "--", 2); i++) {
+		if (i + 1 >= argc)
+			return -1;
+		if (!strcmp(argv[i], "--jobs"))
+			options->jobs = strtol(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "--force"))
+			options->force = strtof(argv[++i], NULL);
+		else if (!strcmp(argv[i], "--timeout"))
+			options->timeout = strtod(argv[++i], NULL);
+		else
+			return -1;
+	}
+	if (i == argc)
+		return -1;
+	if (options->jobs < 1)
+		options->jobs = 1;
+	options->first = i;
+	return 0;
+}
+
+/**
+ * @brief Explore every `jobs` maze starting at `worker`, sending results.
+ */
+static void run_worker(int output, char **paths, uint32_t count, long worker,
+		       struct options *options)
+{
+	static struct flood maze;
+	struct record record;
+	uint32_t i;
+
+	for (i = worker; i < count; i += options->jobs) {
+		memset(&record, 0, sizeof(record));
+		record.index = i;
+		record.loaded = maze_load(&maze, paths[i]);
+		if (record.loaded)
+			mouse_explore(&maze, options->force, options->timeout,
+				      &record.result);
+		if (write(output, &record, sizeof(record)) != sizeof(record))
+			_exit(EXIT_FAILURE);
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief Print a path as a JSON string.
+ */
+static void print_path(const char *path)
+{
+	putchar('"');
+	for (; *path; path++) {
+		if (*path == '"' || *path == '\\')
+			putchar('\\');
+		putchar(*path);
+	}
+	putchar('"');
+}
+
+static void print_record(const char *path, struct record *record)
+{
+	struct mouse_result *result = &record->result;
+
+	printf("{\"maze\":");
+	print_path(path);
+	if (!record->loaded) {
+		printf(",\"loaded\":false}\n");
+		return;
+	}
+	printf(",\"success\":%s,\"collision\":%s,\"detected\":%s"
+	       ",\"cells\":%" PRIu16 ",\"position_error\":%.4f"
+	       ",\"calibration_time\":%.3f"
+	       ",\"exploration_time\":%.3f,\"run_time\":%.3f"
+	       ",\"shortest_time\":%.3f,\"decisions\":%" PRIu32
+	       ",\"cycles_per_decision\":%" PRIu64
+	       ",\"plan_cycles\":%" PRIu64 "}\n",
+	       result->success ? "true" : "false",
+	       result->collision ? "true" : "false",
+	       result->detected ? "true" : "false", result->cells,
+	       result->position_error, result->calibration_time,
+	       result->exploration_time, result->run_time / 1000.,
+	       result->shortest_time / 1000., result->decisions,
+	       result->decisions ? result->decision_cycles / result->decisions
+				 : 0,
+	       result->plan_cycles);
+}
+
+/**
+ * @brief Print the averages over the mazes successfully explored.
+ */
+static void print_summary(struct record *records, uint32_t count,
+			  double elapsed)
+{
+	uint64_t decisions = 0;
+	uint64_t cycles = 0;
+	uint64_t plan_cycles = 0;
+	double exploration = 0.;
+	double run = 0.;
+	uint32_t cells = 0;
+	uint32_t solved = 0;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		if (!records[i].loaded || !records[i].result.success)
+			continue;
+		solved++;
+		cells += records[i].result.cells;
+		exploration += records[i].result.exploration_time;
+		run += records[i].result.run_time / 1000.;
+		decisions += records[i].result.decisions;
+		cycles += records[i].result.decision_cycles;
+		plan_cycles += records[i].result.plan_cycles;
+	}
+	fprintf(stderr, "Solved %" PRIu32 "/%" PRIu32 " mazes in %.3f s\n",
+		solved, count, elapsed);
+	if (!solved)
+		return;
+	fprintf(stderr,
+		"Average: %.1f cells, %.3f s exploring, %.3f s run, "
+		"%" PRIu64 " cycles per decision, %" PRIu64
+		" cycles planning\n",
+		(double)cells / solved, exploration / solved, run / solved,
+		decisions ? cycles / decisions : 0, plan_cycles / solved);
+}
+
+/**
+ * @brief Benchmark entry point.
+ *
+ * The mouse and the simulated platform keep their state in static
+ * variables, as in the firmware, so mazes are distributed among forked
+ * worker processes instead of threads. Results are collected through a
+ * pipe and printed in the same order as the maze files.
+ */
+int main(int argc, char **argv)
+{
+	struct options options;
+	struct record record;
+	struct record *records;
+	uint32_t received = 0;
+	uint32_t failures = 0;
+	uint32_t count;
+	double start;
+	int pipes[2];
+	uint32_t i;
+	long worker;
+	pid_t pid;
+
+	if (parse_options(argc, argv, &options)) {
+		fputs(usage, stderr);
+		return EXIT_FAILURE;
+	}
+	count = argc - options.first;
+	if (options.jobs > count)
+		options.jobs = count;
+	records = calloc(count, sizeof(*records));
+	if (!records || pipe(pipes))
+		return EXIT_FAILURE;
+
+	start = seconds();
+	for (worker = 0; worker < options.jobs; worker++) {
+		pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			break;
+		}
+		if (pid == 0) {
+			close(pipes[0]);
+			run_worker(pipes[1], &argv[options.first], count,
+				   worker, &options);
+		}
+	}
+	close(pipes[1]);
+	while (read(pipes[0], &record, sizeof(record)) == sizeof(record)) {
+		records[record.index] = record;
+		received++;
+	}
+	while (wait(NULL) > 0)
+		;
+
+	for (i = 0; i < count; i++) {
+		print_record(argv[options.first + i], &records[i]);
+		if (!records[i].loaded || !records[i].result.success)
+			failures++;
+	}
+	print_summary(records, count, seconds() - start);
+	free(records);
+	if (received != count)
+		return EXIT_FAILURE;
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
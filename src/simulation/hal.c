@@ -0,0 +1,376 @@
+#include "hal.h"
+
+#define SIM_PERIOD (1. / SYSTICK_FREQUENCY_HZ)
+
+/** Distance from the mouse center to a wall considered a collision */
+#define SIM_COLLISION_MARGIN 0.02
+
+/**
+ * Gyroscope Z-axis bias, in LSB, drifting linearly with time (LSB per
+ * second), and uniform noise amplitude, in LSB.
+ */
+#define SIM_GYRO_BIAS 40.
+#define SIM_GYRO_BIAS_DRIFT 0.5
+#define SIM_GYRO_NOISE 8.
+
+/**
+ * Relative error of the encoder counts per meter traveled (e.g.: wheels
+ * diameter calibration error or tires wear), accumulating odometry error
+ */
+#define SIM_ODOMETRY_ERROR 0.03
+
+/** Maximum range of the distance sensors */
+#define SIM_SENSORS_RANGE 0.4
+
+/**
+ * Distance sensors position and orientation relative to the mouse center
+ * (X axis heading forward).
+ */
+static const struct sim_pose sensors[SIM_SENSORS] = {
+	{0.03, 0.02, PI / 4.},
+	{0.03, -0.02, -PI / 4.},
+	{0.04, 0.015, 0.},
+	{0.04, -0.015, 0.},
+};
+
+static struct flood *maze;
+static struct sim_pose pose;
+static double speed_left;
+static double speed_right;
+static double counts_left;
+static double counts_right;
+static int32_t applied_left;
+static int32_t applied_right;
+static uint32_t ticks;
+static uint32_t noise_state;
+static bool collided;
+
+/**
+ * @brief Check whether there is a wall or a post on a maze grid point.
+ *
+ * @param[in] x Point X coordinate, in meters.
+ * @param[in] y Point Y coordinate, in meters.
+ * @param[in] vertical Whether the point lies on a vertical grid line.
+ */
+static bool is_blocked(double x, double y, bool vertical)
+{
+	double along = vertical ? y : x;
+	double across = vertical ? x : y;
+	int line = (int)lround(across / CELL_DIMENSION);
+	int row = (int)floor(along / CELL_DIMENSION);
+	double offset = along - row * CELL_DIMENSION;
+	uint16_t cell;
+
+	if (row < 0 || row >= FLOOD_MAZE_SIZE || line <= 0 ||
+	    line >= FLOOD_MAZE_SIZE)
+		return true;
+	if (offset < WALL_WIDTH / 2. ||
+	    offset > CELL_DIMENSION - WALL_WIDTH / 2.)
+		return true;
+	if (vertical) {
+		cell = row * FLOOD_MAZE_SIZE + line - 1;
+		return flood_has_wall(maze, cell, FLOOD_EAST);
+	}
+	cell = (line - 1) * FLOOD_MAZE_SIZE + row;
+	return flood_has_wall(maze, cell, FLOOD_NORTH);
+}
+
+/**
+ * @brief Cast a ray through the maze grid lines to the first wall or post.
+ *
+ * @return Distance to the wall surface, in meters, up to the sensors range.
+ */
+static double ray_cast(double x, double y, double angle)
+{
+	double dx = cos(angle);
+	double dy = sin(angle);
+	double tx = INFINITY;
+	double ty = INFINITY;
+	double step_x = INFINITY;
+	double step_y = INFINITY;
+	double t;
+	bool vertical;
+
+	if (fabs(dx) > 1e-9) {
+		step_x = CELL_DIMENSION / fabs(dx);
+		tx = ((dx > 0 ? floor(x / CELL_DIMENSION) + 1
+			      : ceil(x / CELL_DIMENSION) - 1) *
+			      CELL_DIMENSION -
+		      x) /
+		     dx;
+	}
+	if (fabs(dy) > 1e-9) {
+		step_y = CELL_DIMENSION / fabs(dy);
+		ty = ((dy > 0 ? floor(y / CELL_DIMENSION) + 1
+			      : ceil(y / CELL_DIMENSION) - 1) *
+			      CELL_DIMENSION -
+		      y) /
+		     dy;
+	}
+	while (true) {
+		vertical = tx < ty;
+		t = vertical ? tx : ty;
+		if (t > SIM_SENSORS_RANGE)
+			return SIM_SENSORS_RANGE;
+		if (is_blocked(x + t * dx, y + t * dy, vertical))
+			return t - WALL_WIDTH / 2. / fabs(vertical ? dx : dy);
+		if (vertical)
+			tx += step_x;
+		else
+			ty += step_y;
+	}
+}
+
+/**
+ * @brief Check whether the mouse center is too close to a wall or a post.
+ */
+static bool is_colliding(void)
+{
+	int column = (int)floor(pose.x / CELL_DIMENSION);
+	int row = (int)floor(pose.y / CELL_DIMENSION);
+	double x = pose.x - column * CELL_DIMENSION;
+	double y = pose.y - row * CELL_DIMENSION;
+	uint16_t cell;
+
+	if (column < 0 || column >= FLOOD_MAZE_SIZE || row < 0 ||
+	    row >= FLOOD_MAZE_SIZE)
+		return true;
+	cell = row * FLOOD_MAZE_SIZE + column;
+	if ((x < SIM_COLLISION_MARGIN &&
+	     flood_has_wall(maze, cell, FLOOD_WEST)) ||
+	    (x > CELL_DIMENSION - SIM_COLLISION_MARGIN &&
+	     flood_has_wall(maze, cell, FLOOD_EAST)) ||
+	    (y < SIM_COLLISION_MARGIN &&
+	     flood_has_wall(maze, cell, FLOOD_SOUTH)) ||
+	    (y > CELL_DIMENSION - SIM_COLLISION_MARGIN &&
+	     flood_has_wall(maze, cell, FLOOD_NORTH)))
+		return true;
+	x = fmin(x, CELL_DIMENSION - x);
+	y = fmin(y, CELL_DIMENSION - y);
+	return hypot(x, y) < SIM_COLLISION_MARGIN;
+}
+
+/**
+ * @brief Reset the simulation: the mouse stands still on the start cell,
+ * heading north with its tail touching the back wall.
+ *
+ * @param[in] walls Maze to simulate, which must outlive the simulation.
+ */
+void hal_reset(struct flood *walls)
+{
+	maze = walls;
+	pose.x = CELL_DIMENSION / 2.;
+	pose.y = MOUSE_START_SHIFT;
+	pose.angle = PI / 2.;
+	speed_left = 0.;
+	speed_right = 0.;
+	counts_left = 0.;
+	counts_right = 0.;
+	applied_left = 0;
+	applied_right = 0;
+	ticks = 0;
+	noise_state = 1;
+	collided = false;
+}
+
+/**
+ * @brief Advance the physics one control loop period.
+ *
+ * Each motor applies a force from its voltage and back-EMF, with the same
+ * model used for the control feed-forward (see `feedforward_force()`), which
+ * accelerates the mouse mass and moment of inertia. The pose is integrated
+ * for a differential drive. After a collision the mouse stops moving.
+ */
+void hal_step(void)
+{
+	double force_left = feedforward_force(applied_left, speed_left);
+	double force_right = feedforward_force(applied_right, speed_right);
+	double linear_acceleration = (force_left + force_right) / MOUSE_MASS;
+	double angular_acceleration = (force_right - force_left) *
+				      MOUSE_WHEELS_SEPARATION / 2. /
+				      MOUSE_MOMENT_OF_INERTIA;
+	double tangential_acceleration =
+		angular_acceleration * MOUSE_WHEELS_SEPARATION / 2.;
+	double linear;
+	double angular;
+	double counts_per_meter = MICROMETERS_PER_METER /
+				  (double)MICROMETERS_PER_COUNT *
+				  (1. + SIM_ODOMETRY_ERROR);
+
+	ticks++;
+	if (collided)
+		return;
+	speed_left +=
+		(linear_acceleration - tangential_acceleration) * SIM_PERIOD;
+	speed_right +=
+		(linear_acceleration + tangential_acceleration) * SIM_PERIOD;
+	linear = (speed_left + speed_right) / 2.;
+	angular = (speed_right - speed_left) / MOUSE_WHEELS_SEPARATION;
+	pose.x += linear * cos(pose.angle + angular * SIM_PERIOD / 2.) *
+		  SIM_PERIOD;
+	pose.y += linear * sin(pose.angle + angular * SIM_PERIOD / 2.) *
+		  SIM_PERIOD;
+	pose.angle += angular * SIM_PERIOD;
+	counts_left += speed_left * SIM_PERIOD * counts_per_meter;
+	counts_right += speed_right * SIM_PERIOD * counts_per_meter;
+	if (is_colliding()) {
+		collided = true;
+		speed_left = 0.;
+		speed_right = 0.;
+	}
+}
+
+/**
+ * @brief Number of control loop periods simulated since the reset.
+ */
+uint32_t hal_ticks(void)
+{
+	return ticks;
+}
+
+/**
+ * @brief Simulated time since the reset, in seconds.
+ */
+double hal_time(void)
+{
+	return ticks * SIM_PERIOD;
+}
+
+bool hal_collision(void)
+{
+	return collided;
+}
+
+struct sim_pose hal_pose(void)
+{
+	return pose;
+}
+
+/**
+ * @brief Read the distance sensors.
+ *
+ * @param[out] distances Distance from each sensor to the closest wall or
+ * post in front of it, in meters.
+ */
+void hal_sensors_distance(float *distances)
+{
+	double c = cos(pose.angle);
+	double s = sin(pose.angle);
+	uint8_t i;
+
+	for (i = 0; i < SIM_SENSORS; i++)
+		distances[i] = ray_cast(
+			pose.x + sensors[i].x * c - sensors[i].y * s,
+			pose.y + sensors[i].x * s + sensors[i].y * c,
+			pose.angle + sensors[i].angle);
+}
+
+/**
+ * @brief Simulated clock cycle counter, at the system clock frequency.
+ */
+uint32_t read_cycle_counter(void)
+{
+	return ticks * (SYSCLK_FREQUENCY_HZ / SYSTICK_FREQUENCY_HZ);
+}
+
+uint16_t read_encoder_left(void)
+{
+	return (uint16_t)(int32_t)floor(counts_left);
+}
+
+uint16_t read_encoder_right(void)
+{
+	return (uint16_t)(int32_t)floor(counts_right);
+}
+
+/**
+ * @brief Deterministic uniform noise, from -1 to 1.
+ */
+static double noise(void)
+{
+	noise_state = noise_state * 1103515245 + 12345;
+	return (noise_state >> 8) / (double)(1 << 23) - 1.;
+}
+
+/**
+ * @brief Simulated gyroscope readings, with bias, drift and noise.
+ */
+void get_gyro_z_sample(struct gyro_z_sample *sample)
+{
+	double angular = (speed_right - speed_left) / MOUSE_WHEELS_SEPARATION;
+
+	sample->sequence = ticks;
+	sample->timestamp = read_cycle_counter();
+	sample->raw = (int16_t)lround(
+	    angular * 180. / PI * SIM_GYRO_LSB_PER_DPS + SIM_GYRO_BIAS +
+	    SIM_GYRO_BIAS_DRIFT * hal_time() + SIM_GYRO_NOISE * noise());
+}
+
+/**
+ * @brief Limit the power as the motor driver does.
+ *
+ * @see power_left()
+ */
+static int32_t saturate(int32_t power)
+{
+	if (power > MAX_PWM_PERIOD || power < -MAX_PWM_PERIOD)
+		return power > 0 ? MAX_PWM_PERIOD : -MAX_PWM_PERIOD;
+	return power;
+}
+
+void power_both(int32_t left, int32_t right)
+{
+	applied_left = saturate(left);
+	applied_right = saturate(right);
+}
+
+void power_left(int32_t power)
+{
+	applied_left = saturate(power);
+}
+
+void power_right(int32_t power)
+{
+	applied_right = saturate(power);
+}
+
+int32_t get_power_left(void)
+{
+	return applied_left;
+}
+
+int32_t get_power_right(void)
+{
+	return applied_right;
+}
+
+void drive_off(void)
+{
+	applied_left = 0;
+	applied_right = 0;
+}
+
+void drive_break(void)
+{
+	drive_off();
+}
+
+uint32_t motor_driver_saturation(void)
+{
+	return collision_detector_triggered() ? UINT32_MAX : 0;
+}
+
+void reset_motor_driver_saturation(void)
+{
+	reset_collision_detector();
+}
+
+float get_battery_voltage(void)
+{
+	return 4.;
+}
+
+float get_motor_driver_input_voltage(void)
+{
+	return MOTOR_DRIVER_INPUT_VOLTAGE;
+}
@@ -0,0 +1,47 @@
+#ifndef __HAL_H
+#define __HAL_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "feedforward.h"
+#include "flood.h"
+#include "motor.h"
+#include "platform.h"
+#include "voltage.h"
+
+/** Gyroscope sensitivity (full scale of 1000 degrees per second) */
+#define SIM_GYRO_LSB_PER_DPS 32.8
+
+/** Simulated distance sensors IDs */
+enum sim_sensor {
+	SIM_SENSOR_SIDE_LEFT,
+	SIM_SENSOR_SIDE_RIGHT,
+	SIM_SENSOR_FRONT_LEFT,
+	SIM_SENSOR_FRONT_RIGHT,
+	SIM_SENSORS,
+};
+
+/**
+ * Mouse pose, in meters and radians.
+ *
+ * The origin is the outer corner of the start cell, with the X axis heading
+ * east and the angle increasing counterclockwise.
+ */
+struct sim_pose {
+	double x;
+	double y;
+	double angle;
+};
+
+void hal_reset(struct flood *maze);
+void hal_step(void);
+uint32_t hal_ticks(void);
+double hal_time(void);
+bool hal_collision(void);
+struct sim_pose hal_pose(void);
+void hal_sensors_distance(float *distances);
+
+#endif /* __HAL_H */
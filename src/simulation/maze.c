@@ -0,0 +1,113 @@
+#include "maze.h"
+
+static const uint8_t walls[4] = {FLOOD_EAST, FLOOD_SOUTH, FLOOD_WEST,
+				 FLOOD_NORTH};
+static const int8_t offsets[4] = {1, -FLOOD_MAZE_SIZE, -1, FLOOD_MAZE_SIZE};
+
+/** Classic competition goal: the 2x2 cells in the center of the maze */
+static const uint16_t classic_goal[4] = {
+	(FLOOD_MAZE_SIZE / 2 - 1) * (FLOOD_MAZE_SIZE + 1),
+	(FLOOD_MAZE_SIZE / 2 - 1) * (FLOOD_MAZE_SIZE + 1) + 1,
+	(FLOOD_MAZE_SIZE / 2) * (FLOOD_MAZE_SIZE + 1) - 1,
+	(FLOOD_MAZE_SIZE / 2) * (FLOOD_MAZE_SIZE + 1),
+};
+
+/** Random generator state, see `random_next()` */
+static uint32_t random_state;
+
+/**
+ * @brief Return the next xorshift32 pseudo-random number.
+ *
+ * Used instead of `rand()` for the same mazes to be generated on any host.
+ */
+static uint32_t random_next(void)
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+static bool is_inside(uint16_t cell, uint8_t i)
+{
+	switch (walls[i]) {
+	case FLOOD_EAST:
+		return cell % FLOOD_MAZE_SIZE != FLOOD_MAZE_SIZE - 1;
+	case FLOOD_WEST:
+		return cell % FLOOD_MAZE_SIZE != 0;
+	case FLOOD_NORTH:
+		return cell < FLOOD_MAZE_AREA - FLOOD_MAZE_SIZE;
+	default:
+		return cell >= FLOOD_MAZE_SIZE;
+	}
+}
+
+/**
+ * @brief Set the classic goal cells, removing the walls between them.
+ */
+void maze_set_classic_goal(struct flood *maze)
+{
+	uint16_t cell;
+	uint8_t i;
+
+	for (i = 0; i < 4; i++)
+		flood_set_goal(maze, classic_goal[i]);
+	cell = classic_goal[0];
+	flood_set_open(maze, cell, FLOOD_EAST);
+	flood_set_open(maze, cell, FLOOD_NORTH);
+	flood_set_open(maze, cell + 1, FLOOD_NORTH);
+	flood_set_open(maze, cell + FLOOD_MAZE_SIZE, FLOOD_EAST);
+}
+
+/**
+ * @brief Generate a random perfect maze with the classic goal.
+ *
+ * Depth first backtracking from the start cell, so all cells are reachable
+ * and there is a single path between any two cells (except through the
+ * goal). As in competition mazes, the start cell is only open to the north.
+ *
+ * @param[out] maze Generated maze walls and goal.
+ * @param[in] seed Random seed, for repeatable mazes.
+ */
+void maze_generate(struct flood *maze, unsigned int seed)
+{
+	flood_cell_t stack[FLOOD_MAZE_AREA];
+	bool visited[FLOOD_MAZE_AREA] = {false};
+	uint8_t candidates[4];
+	uint16_t size = 0;
+	uint16_t cell;
+	uint16_t next;
+	uint8_t count;
+	uint8_t i;
+
+	random_state = seed * 2654435761u + 1;
+	if (!random_state)
+		random_state = 1;
+	flood_reset(maze);
+	for (cell = 0; cell < FLOOD_MAZE_AREA; cell++) {
+		flood_add_wall(maze, cell, FLOOD_EAST);
+		flood_add_wall(maze, cell, FLOOD_NORTH);
+	}
+
+	visited[0] = true;
+	visited[FLOOD_MAZE_SIZE] = true;
+	flood_set_open(maze, 0, FLOOD_NORTH);
+	stack[size++] = FLOOD_MAZE_SIZE;
+	while (size) {
+		cell = stack[size - 1];
+		count = 0;
+		for (i = 0; i < 4; i++)
+			if (is_inside(cell, i) && !visited[cell + offsets[i]])
+				candidates[count++] = i;
+		if (!count) {
+			size--;
+			continue;
+		}
+		i = candidates[random_next() % count];
+		next = cell + offsets[i];
+		flood_set_open(maze, cell, walls[i]);
+		visited[next] = true;
+		stack[size++] = (flood_cell_t)next;
+	}
+	maze_set_classic_goal(maze);
+}
@@ -0,0 +1,11 @@
+#ifndef __MAZE_H
+#define __MAZE_H
+
+#include <stdint.h>
+
+#include "flood.h"
+
+void maze_generate(struct flood *maze, unsigned int seed);
+void maze_set_classic_goal(struct flood *maze);
+
+#endif /* __MAZE_H */
@@ -0,0 +1,170 @@
+#include "maze_file.h"
+
+/** Binary `.maz` files: one byte per cell, in columns from the south west */
+#define MAZ_NORTH 0x01
+#define MAZ_EAST 0x02
+#define MAZ_SOUTH 0x04
+#define MAZ_WEST 0x08
+
+/** Text files: two lines per row of cells plus the south border */
+#define TEXT_LINES (2 * FLOOD_MAZE_SIZE + 1)
+#define TEXT_COLUMNS (4 * FLOOD_MAZE_SIZE + 1)
+#define TEXT_LINE_SIZE 256
+
+static bool load_maz(struct flood *maze, FILE *file)
+{
+	uint8_t cells[FLOOD_MAZE_AREA + 1];
+	uint16_t cell;
+	uint8_t value;
+	uint8_t x;
+	uint8_t y;
+
+	if (fread(cells, 1, sizeof(cells), file) != FLOOD_MAZE_AREA)
+		return false;
+	for (x = 0; x < FLOOD_MAZE_SIZE; x++) {
+		for (y = 0; y < FLOOD_MAZE_SIZE; y++) {
+			value = cells[x * FLOOD_MAZE_SIZE + y];
+			cell = x + y * FLOOD_MAZE_SIZE;
+			if (value & MAZ_NORTH)
+				flood_add_wall(maze, cell, FLOOD_NORTH);
+			if (value & MAZ_EAST)
+				flood_add_wall(maze, cell, FLOOD_EAST);
+			if (value & MAZ_SOUTH)
+				flood_add_wall(maze, cell, FLOOD_SOUTH);
+			if (value & MAZ_WEST)
+				flood_add_wall(maze, cell, FLOOD_WEST);
+		}
+	}
+	maze_set_classic_goal(maze);
+	return true;
+}
+
+/**
+ * @brief Character at a column, lines shorter than the maze being padded
+ * with spaces.
+ */
+static char at(const char *line, uint16_t column)
+{
+	if (column >= strlen(line))
+		return ' ';
+	return line[column];
+}
+
+/**
+ * @brief Parse a horizontal walls line, counting them from the north.
+ *
+ * Each line holds the walls north of a row of cells, but the last one, which
+ * is the south border.
+ */
+static void parse_walls(struct flood *maze, const char *line, uint8_t index)
+{
+	uint8_t row = FLOOD_MAZE_SIZE - 1 - index;
+	uint8_t x;
+
+	for (x = 0; x < FLOOD_MAZE_SIZE; x++) {
+		if (at(line, 4 * x + 2) != '-')
+			continue;
+		if (index < FLOOD_MAZE_SIZE)
+			flood_add_wall(maze, x + row * FLOOD_MAZE_SIZE,
+				       FLOOD_NORTH);
+		else
+			flood_add_wall(maze, x, FLOOD_SOUTH);
+	}
+}
+
+/**
+ * @brief Parse the vertical walls line of a row of cells.
+ *
+ * @return Whether a goal mark was found at any cell center.
+ */
+static bool parse_cells(struct flood *maze, const char *line, uint8_t row)
+{
+	bool goal = false;
+	uint16_t cell;
+	uint8_t x;
+
+	for (x = 0; x < FLOOD_MAZE_SIZE; x++) {
+		cell = x + row * FLOOD_MAZE_SIZE;
+		if (at(line, 4 * x) == '|')
+			flood_add_wall(maze, cell, FLOOD_WEST);
+		if (at(line, 4 * x + 4) == '|')
+			flood_add_wall(maze, cell, FLOOD_EAST);
+		if (at(line, 4 * x + 2) == 'G') {
+			flood_set_goal(maze, cell);
+			goal = true;
+		}
+	}
+	return goal;
+}
+
+/**
+ * @brief Load a text drawing, from the north border to the south border.
+ */
+static bool load_text(struct flood *maze, FILE *file)
+{
+	char line[TEXT_LINE_SIZE];
+	uint16_t number = 0;
+	bool goal = false;
+
+	while (fgets(line, sizeof(line), file)) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (number == TEXT_LINES) {
+			if (line[strspn(line, " ")])
+				return false;
+			continue;
+		}
+		if (!number && strlen(line) != TEXT_COLUMNS)
+			return false;
+		if (number % 2 == 0)
+			parse_walls(maze, line, number / 2);
+		else if (parse_cells(maze, line,
+				     FLOOD_MAZE_SIZE - 1 - number / 2))
+			goal = true;
+		number++;
+	}
+	if (number != TEXT_LINES)
+		return false;
+	if (!goal)
+		maze_set_classic_goal(maze);
+	return true;
+}
+
+static bool has_extension(const char *path, const char *extension)
+{
+	size_t length = strlen(path);
+	size_t size = strlen(extension);
+
+	return length >= size && !strcmp(path + length - size, extension);
+}
+
+/**
+ * @brief Load a competition maze file.
+ *
+ * Supported formats are binary `.maz` files, with one byte per cell (north,
+ * east, south and west walls in the lowest bits, by columns starting at the
+ * south west corner), and text drawings (any other extension), with `o` or
+ * `+` posts, `---` and `|` walls and an optional `G` mark on goal cells.
+ * Without goal marks, the goal is the classic 2x2 center.
+ *
+ * Only mazes of `FLOOD_MAZE_SIZE` are supported.
+ *
+ * @param[out] maze Loaded walls and goal.
+ * @param[in] path Maze file path.
+ *
+ * @return Whether the maze was loaded.
+ */
+bool maze_load(struct flood *maze, const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	bool loaded;
+
+	if (!file)
+		return false;
+	flood_reset(maze);
+	if (has_extension(path, ".maz"))
+		loaded = load_maz(maze, file);
+	else
+		loaded = load_text(maze, file);
+	fclose(file);
+	return loaded;
+}
@@ -0,0 +1,14 @@
+#ifndef __MAZE_FILE_H
+#define __MAZE_FILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "flood.h"
+#include "maze.h"
+
+bool maze_load(struct flood *maze, const char *path);
+
+#endif /* __MAZE_FILE_H */
@@ -0,0 +1,571 @@
+#include "mouse.h"
+
+#define PERIOD (1. / SYSTICK_FREQUENCY_HZ)
+
+/**
+ * Side walls correction gains, from the side offset to the angular velocity.
+ *
+ * The linear and angular loops use the firmware control constants (see
+ * `get_control_constants()`), but mmlib's move and side walls control code is
+ * not linked (it depends on the firmware sensors pipeline), so the walls
+ * correction and the moves below are a simplified version of it.
+ */
+#define SIM_KP_WALLS 40.
+#define SIM_KD_WALLS 12.
+
+/**
+ * Maximum side reading change per meter traveled for a wall to be considered
+ * parallel, discarding the perpendicular walls seen ahead by the diagonal
+ * side sensors
+ */
+#define SIDE_WALL_MAX_SLOPE 0.5
+
+/** Wall detection thresholds, at the cell entry border */
+#define SIDE_WALL_DISTANCE 0.13
+#define FRONT_WALL_DISTANCE 0.2
+
+/** Expected front sensors reading at the cell entry border */
+#define FRONT_ENTRY_DISTANCE (CELL_DIMENSION - 0.04 - WALL_WIDTH / 2.)
+
+static const uint8_t walls[4] = {FLOOD_EAST, FLOOD_SOUTH, FLOOD_WEST,
+				 FLOOD_NORTH};
+static const int8_t offsets[4] = {1, -FLOOD_MAZE_SIZE, -1, FLOOD_MAZE_SIZE};
+
+static struct flood explored;
+static const struct linear_profile *linear_profile;
+static const struct turn_profile *turn_profile_90;
+static const struct turn_profile *turn_profile_180;
+static float search_speed;
+
+static float target_linear;
+static float target_angular;
+static float last_target_linear;
+static float last_target_angular;
+static float linear_error;
+static float angular_error;
+static float last_linear_error;
+static float last_angular_error;
+static float traveled;
+static bool walls_control;
+static bool posts_control;
+static float last_side_left;
+static float last_side_right;
+static uint16_t last_left;
+static uint16_t last_right;
+static double deadline;
+
+static uint64_t nanoseconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * @brief Host CPU time stamp counter, or zero where not available.
+ */
+static uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/**
+ * @brief Angular velocity correction to keep centered between side walls.
+ *
+ * The side offset integrates the heading error as the mouse moves, so the
+ * offset change per meter traveled (proportional to the heading error) is
+ * used to damp the correction.
+ *
+ * @param[in] step Distance traveled since the previous correction.
+ */
+static float walls_correction(float step)
+{
+	float distances[SIM_SENSORS];
+	float max_change = SIDE_WALL_MAX_SLOPE * fabsf(step);
+	float last_offset = last_side_left - last_side_right;
+	bool parallel;
+	float left;
+	float right;
+	float offset;
+
+	hal_sensors_distance(distances);
+	left = distances[SIM_SENSOR_SIDE_LEFT];
+	right = distances[SIM_SENSOR_SIDE_RIGHT];
+	parallel = fabsf(left - last_side_left) <= max_change &&
+		   fabsf(right - last_side_right) <= max_change;
+	last_side_left = left;
+	last_side_right = right;
+	if (!walls_control || !parallel || step <= 0.)
+		return 0.;
+	if (left > SIDE_WALL_DISTANCE || right > SIDE_WALL_DISTANCE)
+		return 0.;
+	offset = left - right;
+	return SIM_KP_WALLS * offset +
+	       SIM_KD_WALLS * (offset - last_offset) / step;
+}
+
+/**
+ * @brief Correct the position within the cell at the wall posts.
+ *
+ * Only while crossing cells straight, when the position is measured from the
+ * entry border (see `wall_posts_update()`).
+ */
+static void posts_correction(void)
+{
+	float distances[SIM_SENSORS];
+	float correction;
+
+	if (!posts_control)
+		return;
+	hal_sensors_distance(distances);
+	if (wall_posts_update(distances[SIM_SENSOR_SIDE_LEFT],
+			      distances[SIM_SENSOR_SIDE_RIGHT], traveled,
+			      &correction))
+		traveled += correction;
+}
+
+/**
+ * @brief Run one control loop iteration and advance the physics.
+ *
+ * Measurements go through the same platform functions as the firmware:
+ * encoders, gyroscope samples and motor power. The linear and angular errors
+ * are accumulated as in mmlib's `motor_control()` (speed errors summed on
+ * each iteration, here distances divided by the period) and the control
+ * constants currently in use turn them into voltages, so configuration and
+ * tuning variant changes are exercised. The gyroscope bias estimate
+ * is refined whenever the wheels do not move and subtracted, rounded, as the
+ * firmware does (see `update_gyro_bias()`).
+ *
+ * @return Whether the simulation can go on (no collision and no timeout).
+ */
+static bool tick(void)
+{
+	struct gyro_z_sample sample;
+	uint16_t left = read_encoder_left();
+	uint16_t right = read_encoder_right();
+	float left_distance;
+	float right_distance;
+	float linear_power;
+	float angular_power;
+	int32_t left_power;
+	int32_t right_power;
+	float angular;
+	float step;
+	struct control_constants control = get_control_constants();
+	float scale = MAX_PWM_PERIOD / get_motor_driver_input_voltage();
+
+	left_distance = (int16_t)(left - last_left) *
+			get_micrometers_per_count() / MICROMETERS_PER_METER;
+	right_distance = (int16_t)(right - last_right) *
+			 get_micrometers_per_count() / MICROMETERS_PER_METER;
+	get_gyro_z_sample(&sample);
+	gyro_bias_update(sample.raw, left == last_left && right == last_right);
+	last_left = left;
+	last_right = right;
+	angular = (sample.raw - lroundf(get_gyro_bias())) /
+		  SIM_GYRO_LSB_PER_DPS * PI / 180.;
+
+	step = (left_distance + right_distance) / 2.;
+	traveled += step;
+	posts_correction();
+	linear_error += target_linear * PERIOD - step;
+	angular_error += (target_angular + walls_correction(step) - angular) *
+			 PERIOD;
+	collision_update(left_distance / PERIOD, right_distance / PERIOD,
+			 angular);
+
+	feedforward_power(target_linear,
+			  (target_linear - last_target_linear) / PERIOD,
+			  target_angular,
+			  (target_angular - last_target_angular) / PERIOD,
+			  &left_power, &right_power);
+	last_target_linear = target_linear;
+	last_target_angular = target_angular;
+
+	linear_power = (control.kp_linear * linear_error +
+			control.kd_linear * (linear_error - last_linear_error)) /
+		       PERIOD * scale;
+	angular_power =
+		(control.kp_angular * angular_error +
+		 control.kd_angular * (angular_error - last_angular_error)) /
+		PERIOD * scale;
+	last_linear_error = linear_error;
+	last_angular_error = angular_error;
+	power_both(left_power + (int32_t)(linear_power - angular_power),
+		   right_power + (int32_t)(linear_power + angular_power));
+	hal_step();
+	return !hal_collision() && !collision_detector_triggered() &&
+	       hal_time() < deadline;
+}
+
+/**
+ * @brief Move straight at the current speed for a distance.
+ *
+ * The distance traveled beyond the target is kept, so errors do not
+ * accumulate from one move to the next.
+ */
+static bool move_straight(float distance)
+{
+	walls_control = true;
+	while (traveled < distance)
+		if (!tick())
+			return false;
+	traveled -= distance;
+	return true;
+}
+
+/**
+ * @brief Cross a cell, from border to border, correcting at the wall posts.
+ */
+static bool move_cell(void)
+{
+	bool moving;
+
+	wall_posts_reset();
+	posts_control = true;
+	moving = move_straight(CELL_DIMENSION);
+	posts_control = false;
+	return moving;
+}
+
+/**
+ * @brief Accelerate or brake to a speed while moving some distance.
+ *
+ * @param[in] distance Distance to move, in meters.
+ * @param[in] speed Target speed, reached at the end of the distance when
+ * braking, or as soon as possible when accelerating. It is limited to the
+ * linear speed limit currently in use (see `get_linear_speed_limit()`).
+ */
+static bool move_to_speed(float distance, float speed)
+{
+	float acceleration = linear_profile->acceleration * PERIOD;
+	float deceleration = linear_profile->deceleration * PERIOD;
+	float remaining;
+
+	speed = fminf(speed, get_linear_speed_limit());
+	walls_control = true;
+	while (traveled < distance) {
+		remaining = distance - traveled;
+		if (target_linear < speed)
+			target_linear =
+				fminf(target_linear + acceleration, speed);
+		else if (braking_distance(linear_profile, target_linear,
+					  speed) >= remaining)
+			target_linear =
+				fmaxf(target_linear - deceleration, speed);
+		if (target_linear <= 0. && speed <= 0.)
+			break;
+		if (!tick())
+			return false;
+	}
+	target_linear = speed;
+	traveled = 0.;
+	return true;
+}
+
+/**
+ * @brief Follow a turn profile, indexing the generated tables on each tick.
+ *
+ * @param[in] profile Turn profile.
+ * @param[in] sign Positive to turn left, negative to turn right.
+ */
+static bool move_turn(const struct turn_profile *profile, float sign)
+{
+	uint16_t ticks = turn_profile_ticks(profile);
+	uint16_t i;
+
+	walls_control = false;
+	for (i = 0; i < ticks; i++) {
+		target_angular = sign * turn_angular_velocity(profile, i);
+		if (!tick())
+			return false;
+	}
+	target_angular = 0.;
+	traveled = 0.;
+	return true;
+}
+
+/**
+ * @brief Stop at the cell center, turn in place and go back to the border.
+ */
+static bool move_back(void)
+{
+	float speed = target_linear;
+
+	if (!move_to_speed(CELL_DIMENSION / 2., 0.))
+		return false;
+	if (!move_turn(turn_profile_180, 1.))
+		return false;
+	linear_error = 0.;
+	return move_to_speed(CELL_DIMENSION / 2., speed);
+}
+
+/**
+ * @brief Update a wall reading, either present or known to be missing.
+ */
+static void update_wall(uint16_t cell, uint8_t heading, bool present)
+{
+	if (present)
+		flood_incremental(&explored, cell, walls[heading]);
+	else
+		flood_set_open(&explored, cell, walls[heading]);
+}
+
+/**
+ * @brief Read the left, front and right walls of the cell being entered.
+ *
+ * @return Whether a front wall was detected.
+ */
+static bool read_walls(uint16_t cell, uint8_t heading)
+{
+	float distances[SIM_SENSORS];
+	float front;
+	bool wall;
+
+	hal_sensors_distance(distances);
+	front = (distances[SIM_SENSOR_FRONT_LEFT] +
+		 distances[SIM_SENSOR_FRONT_RIGHT]) /
+		2.;
+	update_wall(cell, (heading + 3) % 4,
+		    distances[SIM_SENSOR_SIDE_LEFT] < SIDE_WALL_DISTANCE);
+	update_wall(cell, (heading + 1) % 4,
+		    distances[SIM_SENSOR_SIDE_RIGHT] < SIDE_WALL_DISTANCE);
+	wall = front < FRONT_WALL_DISTANCE;
+	update_wall(cell, heading, wall);
+	return wall;
+}
+
+/**
+ * @brief Choose the next heading: the open neighbor closest to the goal,
+ * going straight on ties.
+ *
+ * @return The next heading, or the opposite heading on dead ends.
+ */
+static uint8_t choose(uint16_t cell, uint8_t heading)
+{
+	uint8_t candidates[3] = {heading, (heading + 1) % 4, (heading + 3) % 4};
+	flood_distance_t lowest = FLOOD_UNREACHABLE;
+	uint8_t best = (heading + 2) % 4;
+	flood_distance_t distance;
+	uint8_t i;
+
+	for (i = 0; i < 3; i++) {
+		if (flood_has_wall(&explored, cell, walls[candidates[i]]))
+			continue;
+		distance = explored.distances[cell + offsets[candidates[i]]];
+		if (distance < lowest) {
+			lowest = distance;
+			best = candidates[i];
+		}
+	}
+	return best;
+}
+
+/**
+ * @brief Align with the front wall before turning.
+ *
+ * When the front sensors read farther than expected at the cell border, the
+ * turn starts late by that distance.
+ */
+static bool align_front(void)
+{
+	float distances[SIM_SENSORS];
+	float front;
+
+	hal_sensors_distance(distances);
+	front = (distances[SIM_SENSOR_FRONT_LEFT] +
+		 distances[SIM_SENSOR_FRONT_RIGHT]) /
+		2.;
+	if (front <= FRONT_ENTRY_DISTANCE)
+		return true;
+	traveled = 0.;
+	return move_straight(front - FRONT_ENTRY_DISTANCE);
+}
+
+/**
+ * @brief Execute the move to the next heading.
+ *
+ * @return Whether the simulation can go on.
+ */
+static bool move_to(uint8_t heading, uint8_t next, bool front_wall)
+{
+	if (next == heading)
+		return move_cell();
+	if (next == (heading + 2) % 4)
+		return move_back();
+	if (front_wall && !align_front())
+		return false;
+	traveled = 0.;
+	if (!move_straight(turn_profile_90->before))
+		return false;
+	if (!move_turn(turn_profile_90, next == (heading + 3) % 4 ? 1. : -1.))
+		return false;
+	return move_straight(turn_profile_90->after);
+}
+
+/**
+ * @brief Stand still, as before moving, until the gyroscope bias is ready.
+ *
+ * Waits at most `SIM_CALIBRATION_TIMEOUT`, as `wait_gyro_bias_ready()`.
+ */
+static void calibrate_gyro(void)
+{
+	struct gyro_z_sample sample;
+
+	gyro_bias_reset();
+	power_both(0, 0);
+	while (!gyro_bias_ready() && hal_time() < SIM_CALIBRATION_TIMEOUT) {
+		get_gyro_z_sample(&sample);
+		gyro_bias_update(sample.raw, true);
+		hal_step();
+	}
+}
+
+static void reset_control(void)
+{
+	target_linear = 0.;
+	target_angular = 0.;
+	last_target_linear = 0.;
+	last_target_angular = 0.;
+	linear_error = 0.;
+	angular_error = 0.;
+	last_linear_error = 0.;
+	last_angular_error = 0.;
+	traveled = 0.;
+	last_left = read_encoder_left();
+	last_right = read_encoder_right();
+	reset_collision_detector();
+}
+
+/**
+ * @brief Longitudinal position error, from the true pose, at a cell border.
+ *
+ * @param[in] cell Cell being entered.
+ * @param[in] heading Heading of the mouse, entering the cell.
+ *
+ * @return Distance from the mouse center to the cell entry border, positive
+ * when beyond it, in meters.
+ */
+static float border_error(uint16_t cell, uint8_t heading)
+{
+	struct sim_pose pose = hal_pose();
+	double x = (cell % FLOOD_MAZE_SIZE) * CELL_DIMENSION;
+	double y = (cell / FLOOD_MAZE_SIZE) * CELL_DIMENSION;
+
+	switch (heading) {
+	case 0:
+		return pose.x - x;
+	case 1:
+		return y + CELL_DIMENSION - pose.y;
+	case 2:
+		return x + CELL_DIMENSION - pose.x;
+	default:
+		return pose.y - y;
+	}
+}
+
+/**
+ * @brief Explore a maze until reaching the goal.
+ *
+ * The mouse searches with the incremental flood fill: walls are read on
+ * each cell border and only the affected distances are updated. Moves are
+ * executed with the generated speed and turn profiles at the search speed,
+ * which is the turn speed for the selected force.
+ *
+ * Once the goal is reached, a time optimal run is planned on the explored
+ * maze, along with the shortest run for comparison.
+ *
+ * @param[in] maze Maze to explore (walls and goal).
+ * @param[in] force Force level, in newtons.
+ * @param[in] timeout Maximum simulated time, in seconds.
+ * @param[out] result Exploration results.
+ */
+void mouse_explore(struct flood *maze, float force, double timeout,
+		   struct mouse_result *result)
+{
+	static bool visited[FLOOD_MAZE_AREA];
+	struct plan_move moves[PLANNER_MAX_MOVES];
+	uint16_t cell = FLOOD_MAZE_SIZE;
+	uint8_t heading = 3;
+	uint16_t count;
+	uint64_t start_cycles;
+	uint64_t start;
+	bool front_wall;
+	uint8_t next;
+	uint16_t i;
+
+	memset(result, 0, sizeof(*result));
+	memset(visited, 0, sizeof(visited));
+	hal_reset(maze);
+	calibrate_gyro();
+	result->calibration_time = hal_time();
+	reset_control();
+	deadline = result->calibration_time + timeout;
+	linear_profile = get_linear_profile(force);
+	turn_profile_90 = get_turn_profile(force, TURN_90);
+	turn_profile_180 = get_turn_profile(force, TURN_180);
+	search_speed = turn_profile_90->linear_velocity;
+
+	flood_reset(&explored);
+	flood_add_wall(&explored, 0, FLOOD_EAST);
+	for (i = 0; i < FLOOD_MAZE_AREA; i++)
+		if (flood_is_goal(maze, i))
+			flood_set_goal(&explored, i);
+	flood_full(&explored);
+	visited[0] = true;
+	result->cells = 1;
+
+	if (!move_to_speed(CELL_DIMENSION - MOUSE_START_SHIFT, search_speed))
+		goto end;
+	while (!flood_is_goal(&explored, cell)) {
+		result->position_error += fabsf(border_error(cell, heading));
+		if (!visited[cell]) {
+			visited[cell] = true;
+			result->cells++;
+		}
+		start = nanoseconds();
+		start_cycles = cycles();
+		front_wall = read_walls(cell, heading);
+		next = choose(cell, heading);
+		result->decision_cycles += cycles() - start_cycles;
+		result->decision_nanoseconds += nanoseconds() - start;
+		result->decisions++;
+		viz_publish_state(&explored, cell, heading);
+		if (!move_to(heading, next, front_wall))
+			goto end;
+		if (next == (heading + 2) % 4)
+			cell -= offsets[heading];
+		else
+			cell += offsets[next];
+		heading = next;
+	}
+	result->success = move_to_speed(CELL_DIMENSION / 2., 0.);
+	result->cells++;
+
+end:
+	result->collision = hal_collision();
+	result->detected = collision_detector_triggered();
+	result->exploration_time = hal_time() - result->calibration_time;
+	if (result->decisions)
+		result->position_error /= result->decisions;
+	if (result->success) {
+		start_cycles = cycles();
+		result->run_time = plan_time_optimal(&explored, moves, &count);
+		result->plan_cycles = cycles() - start_cycles;
+		result->shortest_time = plan_shortest(&explored, moves, &count);
+	}
+	viz_publish_state(&explored, cell, heading);
+}
+
+/**
+ * @brief Maze as explored by the last `mouse_explore()` call.
+ */
+struct flood *mouse_explored(void)
+{
+	return &explored;
+}
@@ -0,0 +1,57 @@
+#ifndef __MOUSE_H
+#define __MOUSE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "collision.h"
+#include "flood.h"
+#include "gyro_bias.h"
+#include "hal.h"
+#include "kinematics.h"
+#include "planner.h"
+#include "viz.h"
+#include "wall_posts.h"
+
+/** Maximum time standing still to calibrate the gyroscope, in seconds */
+#define SIM_CALIBRATION_TIMEOUT 2.
+
+/**
+ * Results of an exploration.
+ *
+ * - Whether the goal was reached, whether the mouse collided and whether the
+ *   collision detector was triggered.
+ * - Number of different cells visited.
+ * - Mean longitudinal position error at the cell borders, in meters.
+ * - Simulated gyroscope calibration and exploration times, in seconds.
+ * - Estimated time of the time optimal and shortest runs, in milliseconds.
+ * - Number of search decisions and host nanoseconds and CPU cycles spent on
+ *   them (cycles are only available on x86 hosts).
+ * - Host CPU cycles spent planning the time optimal run.
+ */
+struct mouse_result {
+	bool success;
+	bool collision;
+	bool detected;
+	uint16_t cells;
+	float position_error;
+	double calibration_time;
+	double exploration_time;
+	uint32_t run_time;
+	uint32_t shortest_time;
+	uint32_t decisions;
+	uint64_t decision_nanoseconds;
+	uint64_t decision_cycles;
+	uint64_t plan_cycles;
+};
+
+void mouse_explore(struct flood *maze, float force, double timeout,
+		   struct mouse_result *result);
+struct flood *mouse_explored(void);
+
+#endif /* __MOUSE_H */
@@ -0,0 +1,123 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "maze.h"
+#include "mouse.h"
+#include "viz.h"
+
+static const char usage[] =
+	"Usage: simulator [--seed N] [--mazes N] [--force F] [--timeout S]\n"
+	"                 [--zmq ADDRESS] [--batch N]\n"
+	"\n"
+	"Explore random mazes, generated from consecutive seeds, with the\n"
+	"simulated mouse. One JSON line is printed for each maze.\n"
+	"\n"
+	"With --zmq, the exploration state is published for visualization,\n"
+	"batching N steps per frame (1 by default).\n";
+
+struct options {
+	unsigned int seed;
+	unsigned int mazes;
+	float force;
+	double timeout;
+	const char *zmq;
+	uint8_t batch;
+};
+
+static double seconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int parse_options(int argc, char **argv, struct options *options)
+{
+	int i;
+
+	options->seed = 0;
+	options->mazes = 1;
+	options->force = 0.25;
+	options->timeout = 600.;
+	options->zmq = NULL;
+	options->batch = 1;
+	for (i = 1; i < argc; i++) {
+		if (i + 1 >= argc)
+			return -1;
+		if (!strcmp(argv[i], "--seed"))
+			options->seed = strtoul(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "--mazes"))
+			options->mazes = strtoul(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "--force"))
+			options->force = strtof(argv[++i], NULL);
+		else if (!strcmp(argv[i], "--timeout"))
+			options->timeout = strtod(argv[++i], NULL);
+		else if (!strcmp(argv[i], "--zmq"))
+			options->zmq = argv[++i];
+		else if (!strcmp(argv[i], "--batch"))
+			options->batch = strtoul(argv[++i], NULL, 10);
+		else
+			return -1;
+	}
+	return 0;
+}
+
+static void print_result(unsigned int seed, struct mouse_result *result)
+{
+	printf("{\"seed\":%u,\"success\":%s,\"collision\":%s,\"detected\":%s"
+	       ",\"cells\":%" PRIu16 ",\"calibration_time\":%.3f"
+	       ",\"exploration_time\":%.3f,\"run_time\":%.3f,"
+	       "\"decision_ns\":%" PRIu64 "}\n",
+	       seed, result->success ? "true" : "false",
+	       result->collision ? "true" : "false",
+	       result->detected ? "true" : "false", result->cells,
+	       result->calibration_time, result->exploration_time,
+	       result->run_time / 1000., result->decisions
+		       ? result->decision_nanoseconds / result->decisions
+		       : 0);
+}
+
+/**
+ * @brief Native simulator entry point.
+ *
+ * The simulation runs as fast as possible: the physics step is advanced by
+ * the simulated control loop itself. The total simulated time per wall clock
+ * second is reported at the end on the standard error.
+ */
+int main(int argc, char **argv)
+{
+	static struct flood maze;
+	struct mouse_result result;
+	struct options options;
+	double simulated = 0.;
+	double start;
+	unsigned int failures = 0;
+	unsigned int i;
+
+	if (parse_options(argc, argv, &options)) {
+		fputs(usage, stderr);
+		return EXIT_FAILURE;
+	}
+	if (options.zmq && !viz_open(options.zmq, options.batch))
+		fprintf(stderr, "Visualization disabled\n");
+
+	start = seconds();
+	for (i = 0; i < options.mazes; i++) {
+		maze_generate(&maze, options.seed + i);
+		mouse_explore(&maze, options.force, options.timeout, &result);
+		viz_flush();
+		print_result(options.seed + i, &result);
+		simulated += result.exploration_time;
+		if (!result.success)
+			failures++;
+	}
+	fprintf(stderr, "Simulated %.1f s in %.3f s (%u failures)\n", simulated,
+		seconds() - start, failures);
+
+	viz_close();
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
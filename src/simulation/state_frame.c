@@ -0,0 +1,112 @@
+#include "state_frame.h"
+
+#define FRAME_TYPE_DELTA 'D'
+#define FRAME_TYPE_KEYFRAME 'K'
+
+static void write_uint16(uint8_t *buffer, uint16_t value)
+{
+	buffer[0] = value & 0xFF;
+	buffer[1] = value >> 8;
+}
+
+/**
+ * @brief Initialize the state frames for a maze size.
+ *
+ * The first frame is a keyframe, with all the cells.
+ *
+ * @param[out] frame State frame to initialize.
+ * @param[in] maze_size Number of cells per side.
+ * @param[in] max_steps Steps batched per frame, `buffer` must fit them.
+ * @param[in] distances Last distances sent, `maze_size ^ 2` bytes.
+ * @param[in] walls Last walls sent, `maze_size ^ 2` bytes.
+ * @param[in] buffer Frame buffer, of `STATE_FRAME_SIZE()` bytes.
+ */
+void state_frame_init(struct state_frame *frame, uint8_t maze_size,
+		      uint8_t max_steps, uint8_t *distances, uint8_t *walls,
+		      uint8_t *buffer)
+{
+	frame->maze_size = maze_size;
+	frame->area = maze_size * maze_size;
+	frame->distances = distances;
+	frame->walls = walls;
+	frame->buffer = buffer;
+	frame->sequence = 0;
+	frame->max_steps = max_steps ? max_steps : 1;
+	frame->keyframe = true;
+	state_frame_clear(frame);
+}
+
+/**
+ * @brief Start a new frame, after the previous one has been sent.
+ */
+void state_frame_clear(struct state_frame *frame)
+{
+	frame->buffer[0] = frame->keyframe ? FRAME_TYPE_KEYFRAME
+					   : FRAME_TYPE_DELTA;
+	frame->buffer[1] = frame->maze_size;
+	write_uint16(&frame->buffer[2], frame->sequence++);
+	frame->buffer[4] = 0;
+	frame->length = STATE_FRAME_HEADER_SIZE;
+	frame->steps = 0;
+}
+
+/**
+ * @brief Include all the cells in the next step.
+ *
+ * Subscribers joining late or losing a frame resynchronize on keyframes.
+ */
+void state_frame_request_keyframe(struct state_frame *frame)
+{
+	frame->keyframe = true;
+	if (!frame->steps)
+		frame->buffer[0] = FRAME_TYPE_KEYFRAME;
+}
+
+/**
+ * @brief Append a step to the current frame.
+ *
+ * Only the cells whose distance or walls changed since the previous step are
+ * encoded (all of them after a keyframe request), as little endian cell
+ * index, distance and walls.
+ *
+ * @param[in] frame State frame.
+ * @param[in] x Mouse cell coordinates.
+ * @param[in] y Mouse cell coordinates.
+ * @param[in] direction Mouse direction (`E`, `S`, `W` or `N`).
+ * @param[in] distances Current distances of all cells.
+ * @param[in] walls Current walls of all cells.
+ *
+ * @return Whether the frame is full and must be sent.
+ */
+bool state_frame_add_step(struct state_frame *frame, uint8_t x, uint8_t y,
+			  char direction, const uint8_t *distances,
+			  const uint8_t *walls)
+{
+	uint8_t *step = &frame->buffer[frame->length];
+	uint8_t *cells = step + STATE_FRAME_STEP_HEADER_SIZE;
+	uint16_t count = 0;
+	uint16_t cell;
+
+	for (cell = 0; cell < frame->area; cell++) {
+		if (!frame->keyframe &&
+		    distances[cell] == frame->distances[cell] &&
+		    walls[cell] == frame->walls[cell])
+			continue;
+		write_uint16(cells, cell);
+		cells[2] = distances[cell];
+		cells[3] = walls[cell];
+		cells += STATE_FRAME_CELL_SIZE;
+		count++;
+	}
+	memcpy(frame->distances, distances, frame->area);
+	memcpy(frame->walls, walls, frame->area);
+	frame->keyframe = false;
+
+	step[0] = x;
+	step[1] = y;
+	step[2] = direction;
+	write_uint16(&step[3], count);
+	frame->length = cells - frame->buffer;
+	frame->buffer[4] = ++frame->steps;
+	return frame->steps >= frame->max_steps;
+}
@@ -0,0 +1,55 @@
+#ifndef __STATE_FRAME_H
+#define __STATE_FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/** Frame header: type, maze size, sequence number and number of steps */
+#define STATE_FRAME_HEADER_SIZE 5
+
+/** Step header: X, Y, direction and number of changed cells */
+#define STATE_FRAME_STEP_HEADER_SIZE 5
+
+/** Changed cell: index, distance and walls */
+#define STATE_FRAME_CELL_SIZE 4
+
+/** Worst case step size, with every cell changed, for a maze area */
+#define STATE_FRAME_STEP_SIZE(area)                                            \
+	(STATE_FRAME_STEP_HEADER_SIZE + STATE_FRAME_CELL_SIZE * (area))
+
+/** Buffer size for frames batching up to `steps` steps */
+#define STATE_FRAME_SIZE(area, steps)                                          \
+	(STATE_FRAME_HEADER_SIZE + (steps)*STATE_FRAME_STEP_SIZE(area))
+
+/**
+ * Delta encoded state frames.
+ *
+ * Callers own the buffers, sized from their maze size with the macros above:
+ * `distances` and `walls` keep the last values sent for each cell and
+ * `buffer` holds the frame being built.
+ */
+struct state_frame {
+	uint8_t maze_size;
+	uint16_t area;
+	uint8_t *distances;
+	uint8_t *walls;
+	uint8_t *buffer;
+	size_t length;
+	uint16_t sequence;
+	uint8_t steps;
+	uint8_t max_steps;
+	bool keyframe;
+};
+
+void state_frame_init(struct state_frame *frame, uint8_t maze_size,
+		      uint8_t max_steps, uint8_t *distances, uint8_t *walls,
+		      uint8_t *buffer);
+bool state_frame_add_step(struct state_frame *frame, uint8_t x, uint8_t y,
+			  char direction, const uint8_t *distances,
+			  const uint8_t *walls);
+void state_frame_clear(struct state_frame *frame);
+void state_frame_request_keyframe(struct state_frame *frame);
+
+#endif /* __STATE_FRAME_H */
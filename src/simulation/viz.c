@@ -0,0 +1,111 @@
+#include "viz.h"
+
+#ifdef SIMULATION_ZMQ
+/** Frames between keyframes, for viewers joining late */
+#define VIZ_KEYFRAME_INTERVAL 64
+
+#define VIZ_MAX_BATCH 64
+
+static const char directions[4] = {'E', 'S', 'W', 'N'};
+
+static void *context;
+static void *publisher;
+
+static struct state_frame frame;
+static uint8_t sent_distances[FLOOD_MAZE_AREA];
+static uint8_t sent_walls[FLOOD_MAZE_AREA];
+static uint8_t buffer[STATE_FRAME_SIZE(FLOOD_MAZE_AREA, VIZ_MAX_BATCH)];
+#endif
+
+/**
+ * @brief Start publishing the simulation state for visualization.
+ *
+ * States are published on a ZMQ PUB socket, so the simulation never waits
+ * for a viewer. Without `SIMULATION_ZMQ` this function does nothing and the
+ * simulation runs without visualization.
+ *
+ * @param[in] address ZMQ endpoint to bind (i.e.: `tcp://127.0.0.1:6574`).
+ * @param[in] batch Steps batched per frame, up to 64.
+ *
+ * @return Whether the socket is ready.
+ */
+bool viz_open(const char *address, uint8_t batch)
+{
+#ifdef SIMULATION_ZMQ
+	if (batch > VIZ_MAX_BATCH)
+		batch = VIZ_MAX_BATCH;
+	state_frame_init(&frame, FLOOD_MAZE_SIZE, batch, sent_distances,
+			 sent_walls, buffer);
+	context = zmq_ctx_new();
+	publisher = zmq_socket(context, ZMQ_PUB);
+	if (zmq_bind(publisher, address) == 0)
+		return true;
+	viz_close();
+#endif
+	(void)address;
+	(void)batch;
+	return false;
+}
+
+/**
+ * @brief Publish the pending steps, if any.
+ *
+ * Frames are dropped when the viewer is not keeping up, in which case the
+ * next frame is a keyframe for the viewer to resynchronize.
+ */
+void viz_flush(void)
+{
+#ifdef SIMULATION_ZMQ
+	if (!publisher || !frame.steps)
+		return;
+	if (zmq_send(publisher, frame.buffer, frame.length, ZMQ_DONTWAIT) < 0 ||
+	    frame.sequence % VIZ_KEYFRAME_INTERVAL == 0)
+		state_frame_request_keyframe(&frame);
+	state_frame_clear(&frame);
+#endif
+}
+
+void viz_close(void)
+{
+#ifdef SIMULATION_ZMQ
+	viz_flush();
+	if (publisher)
+		zmq_close(publisher);
+	if (context)
+		zmq_ctx_destroy(context);
+	publisher = NULL;
+	context = NULL;
+#endif
+}
+
+/**
+ * @brief Publish the mouse position, distances and walls.
+ *
+ * Steps are delta encoded and batched as described in `state_frame.c`, with
+ * the walls unpacked and the distances saturated to one byte per cell.
+ */
+void viz_publish_state(struct flood *explored, uint16_t cell, uint8_t heading)
+{
+#ifdef SIMULATION_ZMQ
+	uint8_t distances[FLOOD_MAZE_AREA];
+	uint8_t walls[FLOOD_MAZE_AREA];
+	uint16_t i;
+
+	if (!publisher)
+		return;
+	for (i = 0; i < FLOOD_MAZE_AREA; i++) {
+		distances[i] = explored->distances[i] < 0xFF
+				       ? explored->distances[i]
+				       : 0xFF;
+		walls[i] = flood_cell_walls(explored, i);
+	}
+	if (state_frame_add_step(&frame, cell % FLOOD_MAZE_SIZE,
+				 cell / FLOOD_MAZE_SIZE, directions[heading],
+				 distances, walls))
+		viz_flush();
+#else
+	(void)explored;
+	(void)cell;
+	(void)heading;
+#endif
+}
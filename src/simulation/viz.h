@@ -0,0 +1,20 @@
+#ifndef __VIZ_H
+#define __VIZ_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef SIMULATION_ZMQ
+#include <zmq.h>
+#endif
+
+#include "flood.h"
+#include "state_frame.h"
+
+bool viz_open(const char *address, uint8_t batch);
+void viz_flush(void);
+void viz_close(void);
+void viz_publish_state(struct flood *explored, uint16_t cell,
+		       uint8_t heading);
+
+#endif /* __VIZ_H */
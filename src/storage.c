@@ -0,0 +1,451 @@
+#include "storage.h"
+
+#define BYTES_PER_WORD 4
+#define STORAGE_MAX_WORDS (STORAGE_MAX_SIZE / BYTES_PER_WORD)
+#define PAGE_WORDS (FLASH_STORAGE_PAGE_SIZE / BYTES_PER_WORD)
+#define PAGE_HEADER_WORDS 2
+#define ERASED_WORD 0xFFFFFFFF
+#define RECORD_CHECK_KEY 0xA5
+
+/**
+ * Log-structured storage over `FLASH_STORAGE_PAGES` flash pages.
+ *
+ * Only one page is active at a time. It starts with a header, which is the
+ * page sequence number followed by its bitwise negation, and then records are
+ * appended one after the other. Each record is a header word followed by a
+ * number of data words. The header contains:
+ *
+ * - Bits 0-7: key.
+ * - Bits 8-15: offset of the first data word within the value, in words.
+ * - Bits 16-23: number of data words (`0` erases the value).
+ * - Bits 24-31: check byte, covering the header fields and the data.
+ *
+ * An interrupted write leaves a record whose check byte does not match. At boot
+ * the records are walked forward from the page header: the first invalid one
+ * marks the end of the page, and the latest values are compacted into the
+ * next page, as the words after it may be partially programmed.
+ *
+ * Writes only append the words which changed. When the active page is full,
+ * the latest values are compacted into the next page (round-robin, for wear
+ * leveling), whose header is written last. The flash is locked again after
+ * each operation.
+ */
+#if STORAGE_KEYS * (STORAGE_MAX_WORDS + 1) > PAGE_WORDS - PAGE_HEADER_WORDS
+#error "Storage values do not fit in a single page"
+#endif
+
+static bool active;
+static uint8_t active_page;
+static uint32_t active_sequence;
+static uint16_t write_index;
+static bool damaged;
+static uint32_t current[STORAGE_MAX_WORDS];
+static uint32_t update[STORAGE_MAX_WORDS];
+
+/**
+ * @brief Return the address of a storage page.
+ */
+static uint32_t page_address(uint8_t page)
+{
+	return FLASH_STORAGE_ADDRESS + page * FLASH_STORAGE_PAGE_SIZE;
+}
+
+/**
+ * @brief Return a pointer to a word of a storage page.
+ */
+static uint32_t *page_words(uint8_t page, uint16_t index)
+{
+	return (uint32_t *)page_address(page) + index;
+}
+
+/**
+ * @brief Check whether a storage page has a valid header.
+ *
+ * @param[in] page Storage page.
+ * @param[out] sequence Page sequence number.
+ */
+static bool page_valid(uint8_t page, uint32_t *sequence)
+{
+	*sequence = *page_words(page, 0);
+	return *sequence != ERASED_WORD && *sequence == ~*page_words(page, 1);
+}
+
+/**
+ * @brief Calculate the check byte of a record.
+ */
+static uint8_t record_check(uint8_t key, uint8_t offset, uint8_t count,
+			    const uint32_t *words)
+{
+	uint8_t check = RECORD_CHECK_KEY ^ key ^ offset ^ count;
+	uint8_t i;
+
+	for (i = 0; i < count; i++)
+		check += (uint8_t)(words[i] ^ (words[i] >> 8) ^
+				   (words[i] >> 16) ^ (words[i] >> 24));
+	return check;
+}
+
+/**
+ * @brief Check whether a record is complete and its check byte matches.
+ *
+ * @param[in] page Storage page.
+ * @param[in] index Index of the record header in the page.
+ * @param[out] next Index of the word after the record.
+ */
+static bool record_valid(uint8_t page, uint16_t index, uint16_t *next)
+{
+	uint32_t header = *page_words(page, index);
+	uint8_t key = (uint8_t)header;
+	uint8_t offset = (uint8_t)(header >> 8);
+	uint8_t count = (uint8_t)(header >> 16);
+
+	*next = index + count + 1;
+	return key < STORAGE_KEYS && offset + count <= STORAGE_MAX_WORDS &&
+	       *next <= PAGE_WORDS &&
+	       (uint8_t)(header >> 24) ==
+		       record_check(key, offset, count,
+				    page_words(page, index + 1));
+}
+
+/**
+ * @brief Replay the records of a key to get its latest value.
+ *
+ * @param[in] page Storage page.
+ * @param[in] end Index of the first word after the last record in the page.
+ * @param[in] key Storage key.
+ * @param[out] words Latest value of the key.
+ *
+ * @return Size of the value, in words (`0` if not found).
+ */
+static uint16_t replay(uint8_t page, uint16_t end, uint8_t key,
+		       uint32_t *words)
+{
+	uint16_t index = PAGE_HEADER_WORDS;
+	uint16_t size = 0;
+	uint32_t header;
+	uint8_t offset;
+	uint8_t count;
+	uint32_t *data;
+
+	while (index < end) {
+		header = *page_words(page, index);
+		offset = (uint8_t)(header >> 8);
+		count = (uint8_t)(header >> 16);
+		data = page_words(page, index + 1);
+		index += count + 1;
+		if (index > end)
+			break;
+		if ((uint8_t)header != key ||
+		    offset + count > STORAGE_MAX_WORDS ||
+		    (uint8_t)(header >> 24) !=
+			record_check(key, offset, count, data))
+			continue;
+		if (!count)
+			size = 0;
+		while (size < offset)
+			words[size++] = 0;
+		memcpy(&words[offset], data, count * BYTES_PER_WORD);
+		if (offset + count > size)
+			size = offset + count;
+	}
+	return size;
+}
+
+/**
+ * @brief Program a flash word and verify that it is written.
+ *
+ * @return Flash state.
+ */
+static uint32_t program_word(uint32_t address, uint32_t word)
+{
+	uint32_t status;
+
+	flash_program_word(address, word);
+	status = flash_get_status_flags();
+	if (status != FLASH_SR_EOP)
+		return status;
+	if (*(uint32_t *)address != word)
+		return FLASH_WRONG_DATA_WRITTEN;
+	return RESULT_OK;
+}
+
+/**
+ * @brief Append a record to a storage page.
+ *
+ * @param[in] page Storage page.
+ * @param[in,out] index Index of the first free word in the page.
+ * @param[in] key Storage key.
+ * @param[in] offset Offset of the first data word within the value.
+ * @param[in] count Number of data words.
+ * @param[in] words Data words.
+ *
+ * @return Flash state.
+ */
+static uint32_t append_record(uint8_t page, uint16_t *index, uint8_t key,
+			      uint8_t offset, uint8_t count,
+			      const uint32_t *words)
+{
+	uint32_t address;
+	uint32_t status;
+	uint8_t i;
+
+	if (*index + count + 1 > PAGE_WORDS)
+		return STORAGE_FULL;
+	address = (uint32_t)page_words(page, *index);
+	*index += count + 1;
+
+	status = program_word(address,
+			      key | (offset << 8) | (count << 16) |
+				  (record_check(key, offset, count, words)
+				   << 24));
+	for (i = 0; i < count && status == RESULT_OK; i++)
+		status = program_word(address + (i + 1) * BYTES_PER_WORD,
+				      words[i]);
+	return status;
+}
+
+/**
+ * @brief Copy the latest values into the next page and make it active.
+ *
+ * This is the only operation which erases a page.
+ *
+ * @return Flash state.
+ */
+static uint32_t compact(void)
+{
+	uint8_t key;
+	uint8_t next;
+	uint16_t size;
+	uint16_t index = PAGE_HEADER_WORDS;
+	uint32_t sequence;
+	uint32_t status;
+
+	next = active ? (active_page + 1) % FLASH_STORAGE_PAGES : 0;
+	sequence = active ? active_sequence + 1 : 1;
+	if (sequence == ERASED_WORD)
+		sequence = 1;
+
+	flash_erase_page(page_address(next));
+	status = flash_get_status_flags();
+	if (status != FLASH_SR_EOP)
+		return status;
+
+	for (key = 0; active && key < STORAGE_KEYS; key++) {
+		size = replay(active_page, write_index, key, current);
+		if (!size)
+			continue;
+		status = append_record(next, &index, key, 0, size, current);
+		if (status != RESULT_OK)
+			return status;
+	}
+
+	status = program_word((uint32_t)page_words(next, 1), ~sequence);
+	if (status != RESULT_OK)
+		return status;
+	status = program_word((uint32_t)page_words(next, 0), sequence);
+	if (status != RESULT_OK)
+		return status;
+
+	active = true;
+	damaged = false;
+	active_page = next;
+	active_sequence = sequence;
+	write_index = index;
+	return RESULT_OK;
+}
+
+/**
+ * @brief Find the next run of words which changed.
+ *
+ * @param[in] size Size of the new value, in words.
+ * @param[in] stored Size of the stored value, in words.
+ * @param[in,out] start Index to start searching from and, on return, first
+ * word of the run.
+ * @param[out] end Index after the last word of the run.
+ *
+ * @return Whether a run was found.
+ */
+static bool next_run(uint16_t size, uint16_t stored, uint16_t *start,
+		     uint16_t *end)
+{
+	while (*start < size && *start < stored &&
+	       current[*start] == update[*start])
+		(*start)++;
+	if (*start >= size)
+		return false;
+	*end = *start + 1;
+	while (*end < size &&
+	       (*end >= stored || current[*end] != update[*end]))
+		(*end)++;
+	return true;
+}
+
+/**
+ * @brief Append the words of `update` which changed for a key.
+ *
+ * @param[in] key Storage key.
+ * @param[in] size Size of the new value, in words.
+ *
+ * @return Flash state, or `STORAGE_FULL` if the changes do not fit in the
+ * active page or it has an interrupted record (nothing is written in that
+ * case). On flash errors the record being appended is left interrupted, so
+ * the page is marked as damaged and the next write compacts it first.
+ */
+static uint32_t append_changes(uint8_t key, uint16_t size)
+{
+	uint16_t stored;
+	uint16_t start;
+	uint16_t end;
+	uint16_t needed = 0;
+	uint32_t status;
+	bool shrink;
+
+	stored = replay(active_page, write_index, key, current);
+	shrink = stored > size;
+	if (shrink) {
+		needed++;
+		stored = 0;
+	}
+	for (start = 0; next_run(size, stored, &start, &end); start = end)
+		needed += end - start + 1;
+	if (damaged || write_index + needed > PAGE_WORDS)
+		return STORAGE_FULL;
+
+	if (shrink) {
+		status = append_record(active_page, &write_index, key, 0, 0,
+				       update);
+		if (status != RESULT_OK) {
+			damaged = true;
+			return status;
+		}
+	}
+	for (start = 0; next_run(size, stored, &start, &end); start = end) {
+		status = append_record(active_page, &write_index, key, start,
+				       end - start, &update[start]);
+		if (status != RESULT_OK) {
+			damaged = true;
+			return status;
+		}
+	}
+	return RESULT_OK;
+}
+
+/**
+ * @brief Find the active storage page and its first free word.
+ *
+ * Records are walked forward from the page header. If one is interrupted
+ * (e.g.: power loss while appending it), the valid records before it are
+ * compacted into the next page. Should that fail, the compaction is retried
+ * on the next write.
+ *
+ * To be called once at boot.
+ */
+void storage_init(void)
+{
+	uint8_t page;
+	uint32_t sequence;
+	uint16_t next;
+
+	active = false;
+	damaged = false;
+	for (page = 0; page < FLASH_STORAGE_PAGES; page++) {
+		if (!page_valid(page, &sequence))
+			continue;
+		if (active && (int32_t)(sequence - active_sequence) <= 0)
+			continue;
+		active = true;
+		active_page = page;
+		active_sequence = sequence;
+	}
+	if (!active)
+		return;
+
+	write_index = PAGE_HEADER_WORDS;
+	while (write_index < PAGE_WORDS &&
+	       *page_words(active_page, write_index) != ERASED_WORD) {
+		if (!record_valid(active_page, write_index, &next)) {
+			damaged = true;
+			break;
+		}
+		write_index = next;
+	}
+	if (!damaged)
+		return;
+
+	flash_unlock();
+	compact();
+	flash_lock();
+}
+
+/**
+ * @brief Read the latest value stored for a key.
+ *
+ * @param[in] key Storage key.
+ * @param[out] data Buffer to save the value.
+ * @param[in] size Size of the buffer, in bytes.
+ *
+ * @return Number of bytes read (`0` if the key is not stored).
+ */
+uint16_t storage_read(uint8_t key, uint8_t *data, uint16_t size)
+{
+	uint16_t stored;
+
+	if (!active || key >= STORAGE_KEYS)
+		return 0;
+	stored = replay(active_page, write_index, key, current) *
+		 BYTES_PER_WORD;
+	if (size > stored)
+		size = stored;
+	memcpy(data, current, size);
+	return size;
+}
+
+/**
+ * @brief Store a value for a key.
+ *
+ * Only the words which changed since the latest value are appended, so small
+ * changes are cheap and no page is erased until the active one is full.
+ *
+ * @param[in] key Storage key.
+ * @param[in] data Value to store.
+ * @param[in] size Size of the value, in bytes.
+ *
+ * @return Flash state.
+ */
+uint32_t storage_write(uint8_t key, const uint8_t *data, uint16_t size)
+{
+	uint16_t words;
+	uint32_t status;
+
+	if (key >= STORAGE_KEYS || size > STORAGE_MAX_SIZE)
+		return STORAGE_INVALID;
+
+	words = (size + BYTES_PER_WORD - 1) / BYTES_PER_WORD;
+	memset(update, 0, sizeof(update));
+	if (size)
+		memcpy(update, data, size);
+
+	flash_unlock();
+	status = active ? RESULT_OK : compact();
+	if (status == RESULT_OK)
+		status = append_changes(key, words);
+	if (status == STORAGE_FULL) {
+		status = compact();
+		if (status == RESULT_OK)
+			status = append_changes(key, words);
+	}
+	flash_lock();
+	return status;
+}
+
+/**
+ * @brief Erase the value stored for a key.
+ *
+ * @param[in] key Storage key.
+ *
+ * @return Flash state.
+ */
+uint32_t storage_erase(uint8_t key)
+{
+	return storage_write(key, NULL, 0);
+}
@@ -0,0 +1,34 @@
+#ifndef __STORAGE_H
+#define __STORAGE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <libopencm3/stm32/flash.h>
+
+#include "eeprom.h"
+#include "setup.h"
+
+/** Storage keys */
+#define STORAGE_KEY_MAZE 0
+#define STORAGE_KEY_SETTINGS 1
+#define STORAGE_KEYS 2
+
+/**
+ * Maximum size of a stored value, in bytes.
+ *
+ * The latest values of all keys must fit in a single page (see `storage.c`).
+ */
+#define STORAGE_MAX_SIZE 256
+
+/** Storage results (see `RESULT_OK` and flash status flags) */
+#define STORAGE_FULL 0x100
+#define STORAGE_INVALID 0x200
+
+void storage_init(void);
+uint16_t storage_read(uint8_t key, uint8_t *data, uint16_t size);
+uint32_t storage_write(uint8_t key, const uint8_t *data, uint16_t size);
+uint32_t storage_erase(uint8_t key);
+
+#endif /* __STORAGE_H */
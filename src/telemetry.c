@@ -0,0 +1,257 @@
+#include "telemetry.h"
+
+#define TELEMETRY_FRAME_SIZE                                                   \
+	(TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_PAYLOAD_SIZE + TELEMETRY_CRC_SIZE)
+
+#define TELEMETRY_RECORDER_PAYLOAD_SIZE                                        \
+	(TELEMETRY_RECORDER_HEADER_SIZE +                                      \
+	 TELEMETRY_RECORDS_PER_FRAME * sizeof(struct telemetry_record))
+#define TELEMETRY_RECORDER_FRAME_SIZE                                          \
+	(TELEMETRY_HEADER_SIZE + TELEMETRY_RECORDER_PAYLOAD_SIZE +             \
+	 TELEMETRY_CRC_SIZE)
+
+static volatile bool enabled;
+static volatile bool recording;
+static volatile uint32_t recorded;
+static struct telemetry_record *records;
+
+_Static_assert(TELEMETRY_RECORDER_SIZE * sizeof(struct telemetry_record) <=
+		       WORKSPACE_SIZE,
+	       "Telemetry recorder does not fit the work area");
+
+/** CRC-16/CCITT-FALSE (polynomial 0x1021) table, processing 4 bits at once */
+static const uint16_t crc16_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef};
+
+/**
+ * @brief Enable telemetry frames generation.
+ */
+void telemetry_enable(void)
+{
+	enabled = true;
+}
+
+/**
+ * @brief Disable telemetry frames generation.
+ */
+void telemetry_disable(void)
+{
+	enabled = false;
+}
+
+/**
+ * @brief Calculate the CRC-16/CCITT-FALSE of a buffer.
+ *
+ * @param[in] data Data buffer.
+ * @param[in] size Size (number of bytes) of the buffer.
+ */
+static uint16_t crc16(const uint8_t *data, uint8_t size)
+{
+	uint16_t crc = 0xffff;
+
+	while (size--) {
+		crc = (crc << 4) ^ crc16_table[(crc >> 12) ^ (*data >> 4)];
+		crc = (crc << 4) ^ crc16_table[(crc >> 12) ^ (*data & 0x0f)];
+		data++;
+	}
+	return crc;
+}
+
+/**
+ * @brief Store a 16 bits value in little-endian order.
+ */
+static void put_uint16(uint8_t *buffer, uint16_t value)
+{
+	buffer[0] = (uint8_t)value;
+	buffer[1] = (uint8_t)(value >> 8);
+}
+
+/**
+ * @brief Store a 32 bits value in little-endian order.
+ */
+static void put_uint32(uint8_t *buffer, uint32_t value)
+{
+	put_uint16(buffer, (uint16_t)value);
+	put_uint16(buffer + 2, (uint16_t)(value >> 16));
+}
+
+/**
+ * @brief Complete a telemetry frame with its header and CRC.
+ *
+ * @param[in,out] frame Frame buffer, with the payload already set.
+ * @param[in] type Record type.
+ * @param[in] size Payload size, in bytes.
+ *
+ * @return Frame size, in bytes.
+ */
+static int complete_telemetry_frame(uint8_t *frame, enum telemetry_type type,
+				    uint8_t size)
+{
+	uint8_t length;
+
+	frame[0] = TELEMETRY_SYNC;
+	frame[1] = (uint8_t)type;
+	frame[2] = size;
+	put_uint32(&frame[3], read_cycle_counter());
+	length = TELEMETRY_HEADER_SIZE + size;
+	put_uint16(&frame[length], crc16(&frame[1], length - 1));
+	return length + TELEMETRY_CRC_SIZE;
+}
+
+/**
+ * @brief Send a control telemetry record, if enabled.
+ *
+ * To be called on every control loop iteration.
+ */
+void log_telemetry_control(void)
+{
+	struct gyro_z_sample gyro;
+	uint8_t frame[TELEMETRY_FRAME_SIZE];
+	uint8_t *payload = &frame[TELEMETRY_HEADER_SIZE];
+	int length;
+
+	if (!enabled)
+		return;
+
+	get_gyro_z_sample(&gyro);
+	put_uint16(&payload[0], read_encoder_left());
+	put_uint16(&payload[2], read_encoder_right());
+	put_uint16(&payload[4], (uint16_t)gyro.raw);
+	put_uint16(&payload[6], (uint16_t)get_power_left());
+	put_uint16(&payload[8], (uint16_t)get_power_right());
+	length = complete_telemetry_frame(frame, TELEMETRY_CONTROL, 10);
+	serial_send_telemetry((char *)frame, length);
+}
+
+/**
+ * @brief Send a sensors telemetry record, if enabled.
+ *
+ * Distances are calculated in fixed point from the latest complete sensors
+ * sweep.
+ */
+void log_telemetry_sensors(void)
+{
+	uint8_t i;
+	int32_t distance;
+	int32_t distances[NUM_SENSOR];
+	uint8_t frame[TELEMETRY_FRAME_SIZE];
+	uint8_t *payload = &frame[TELEMETRY_HEADER_SIZE];
+	int length;
+
+	if (!enabled)
+		return;
+
+	get_sensors_distances_fixed(distances);
+	for (i = 0; i < NUM_SENSOR; i++) {
+		distance = distances[i];
+		if (distance < 0)
+			distance = 0;
+		if (distance > UINT16_MAX)
+			distance = UINT16_MAX;
+		put_uint16(&payload[2 * i], (uint16_t)distance);
+	}
+	length = complete_telemetry_frame(frame, TELEMETRY_SENSORS,
+					  2 * NUM_SENSOR);
+	serial_send_telemetry((char *)frame, length);
+}
+
+/**
+ * @brief Start recording control records in RAM, discarding previous ones.
+ *
+ * Records are kept in the shared work area (see `workspace_claim()`), so any
+ * trajectory loaded is discarded.
+ */
+void telemetry_recorder_start(void)
+{
+	recording = false;
+	records = workspace_claim(WORKSPACE_RECORDER);
+	recorded = 0;
+	recording = true;
+}
+
+/**
+ * @brief Stop recording control records, keeping them for a dump.
+ */
+void telemetry_recorder_stop(void)
+{
+	recording = false;
+}
+
+/**
+ * @brief Record the control state in RAM, if the recorder is started.
+ *
+ * To be called on every control loop iteration. Records are stored as they
+ * are, formatting and framing is left for `telemetry_recorder_dump()`, so the
+ * cost is independent of the serial link load.
+ */
+void record_telemetry_control(void)
+{
+	struct gyro_z_sample gyro;
+	struct telemetry_record *record;
+
+	if (!recording || !workspace_owned(WORKSPACE_RECORDER))
+		return;
+
+	record = &records[recorded % TELEMETRY_RECORDER_SIZE];
+	get_gyro_z_sample(&gyro);
+	record->encoder_left = read_encoder_left();
+	record->encoder_right = read_encoder_right();
+	record->gyro_z_raw = gyro.raw;
+	record->power_left = (int16_t)get_power_left();
+	record->power_right = (int16_t)get_power_right();
+	recorded++;
+}
+
+/**
+ * @brief Send all the records kept in RAM as recorder telemetry frames.
+ *
+ * The recorder is stopped first. Frames are queued in the log transmission
+ * buffer as the serial DMA transfers drain it, so none is discarded for lack
+ * of space. Live telemetry is disabled during the dump, so it does not take
+ * turns with the dump on the serial link, and restored afterwards. Records are
+ * little-endian, as the control telemetry payload, so they are copied to the
+ * frames as they are. Nothing is sent if the work area was claimed by another
+ * owner since the recorder started.
+ */
+void telemetry_recorder_dump(void)
+{
+	uint8_t frame[TELEMETRY_RECORDER_FRAME_SIZE];
+	uint8_t *payload = &frame[TELEMETRY_HEADER_SIZE];
+	uint8_t *data = &payload[TELEMETRY_RECORDER_HEADER_SIZE];
+	uint32_t first;
+	uint32_t count;
+	uint32_t i;
+	int length;
+	bool live;
+
+	telemetry_recorder_stop();
+	if (!workspace_owned(WORKSPACE_RECORDER))
+		return;
+	live = enabled;
+	enabled = false;
+	first = 0;
+	if (recorded > TELEMETRY_RECORDER_SIZE)
+		first = recorded - TELEMETRY_RECORDER_SIZE;
+	for (; first < recorded; first += count) {
+		count = recorded - first;
+		if (count > TELEMETRY_RECORDS_PER_FRAME)
+			count = TELEMETRY_RECORDS_PER_FRAME;
+		put_uint32(&payload[0], first);
+		put_uint16(&payload[4], (uint16_t)count);
+		put_uint16(&payload[6], SYSTICK_FREQUENCY_HZ);
+		memset(data, 0, TELEMETRY_RECORDS_PER_FRAME *
+				    sizeof(struct telemetry_record));
+		for (i = 0; i < count; i++)
+			memcpy(&data[i * sizeof(struct telemetry_record)],
+			       &records[(first + i) % TELEMETRY_RECORDER_SIZE],
+			       sizeof(struct telemetry_record));
+		serial_wait_free_space(TELEMETRY_RECORDER_FRAME_SIZE);
+		while (!serial_acquire_transfer_lock())
+			;
+		length = complete_telemetry_frame(
+		    frame, TELEMETRY_RECORDER, TELEMETRY_RECORDER_PAYLOAD_SIZE);
+		serial_send((char *)frame, length);
+	}
+	enabled = live;
+}
@@ -0,0 +1,82 @@
+#ifndef __TELEMETRY_H
+#define __TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "detection.h"
+#include "motor.h"
+#include "platform.h"
+#include "serial.h"
+#include "setup.h"
+#include "workspace.h"
+
+/**
+ * Telemetry frames.
+ *
+ * - Synchronization byte, which never starts a text log line.
+ * - Record type (see `enum telemetry_type`).
+ * - Payload size, in bytes.
+ * - Clock cycle counter when the record was generated (32 bits).
+ * - Payload: little-endian packed fixed point fields.
+ * - CRC-16/CCITT-FALSE of all the previous bytes except the synchronization.
+ */
+#define TELEMETRY_SYNC 0xA5
+#define TELEMETRY_HEADER_SIZE 7
+#define TELEMETRY_CRC_SIZE 2
+#define TELEMETRY_MAX_PAYLOAD_SIZE 10
+
+/**
+ * Telemetry record types.
+ *
+ * - Control: left and right encoder counters (`uint16_t`), gyroscope Z-axis
+ *   raw reading (`int16_t`) and left and right motor power (`int16_t`).
+ * - Sensors: side left, side right, front left and front right distances, in
+ *   meters with `SENSORS_DISTANCE_Q` fractional bits (`uint16_t`, saturated).
+ * - Recorder: index of the first record since the recorder started
+ *   (`uint32_t`), number of valid records (`uint16_t`), recording frequency
+ *   in hertz (`uint16_t`) and `TELEMETRY_RECORDS_PER_FRAME` control records,
+ *   zero padded after the valid ones.
+ */
+enum telemetry_type {
+	TELEMETRY_CONTROL = 1,
+	TELEMETRY_SENSORS = 2,
+	TELEMETRY_RECORDER = 3,
+};
+
+/**
+ * Control records kept in RAM by the recorder, one per control loop
+ * iteration, with the same layout as the control telemetry payload.
+ *
+ * The recorder is circular: only the latest `TELEMETRY_RECORDER_SIZE` records
+ * are kept, so only the end of a run survives (256 ticks, or 0.256 s at the
+ * default 1 kHz control loop). It complements the data logs, which cover the
+ * whole run at a lower rate. Records live in the shared work area, so the
+ * recorder can be resized at build time as long as it fits in
+ * `WORKSPACE_SIZE` (`make TELEMETRY_RECORDER_SIZE=300`).
+ */
+#ifndef TELEMETRY_RECORDER_SIZE
+#define TELEMETRY_RECORDER_SIZE 256
+#endif
+#define TELEMETRY_RECORDS_PER_FRAME 16
+#define TELEMETRY_RECORDER_HEADER_SIZE 8
+
+struct telemetry_record {
+	uint16_t encoder_left;
+	uint16_t encoder_right;
+	int16_t gyro_z_raw;
+	int16_t power_left;
+	int16_t power_right;
+};
+
+void telemetry_enable(void);
+void telemetry_disable(void);
+void log_telemetry_control(void);
+void log_telemetry_sensors(void);
+void telemetry_recorder_start(void);
+void telemetry_recorder_stop(void);
+void record_telemetry_control(void);
+void telemetry_recorder_dump(void);
+
+#endif /* __TELEMETRY_H */
@@ -0,0 +1,220 @@
+#include "trajectory.h"
+
+static struct trajectory_setpoint *setpoints;
+static uint16_t length;
+static uint16_t loaded_count;
+static uint8_t loaded[(TRAJECTORY_MAX_SETPOINTS + 7) / 8];
+static volatile uint16_t played;
+static volatile bool playing;
+static float target_linear;
+static float target_angular;
+static struct tuning_metrics window;
+static struct tuning_metrics completed;
+static struct tuning_metrics total;
+static volatile uint32_t completed_windows;
+
+_Static_assert(TRAJECTORY_MAX_SETPOINTS * sizeof(struct trajectory_setpoint) <=
+		       WORKSPACE_SIZE,
+	       "Trajectory setpoints do not fit the work area");
+
+/**
+ * @brief Forget the setpoints loaded.
+ */
+static void reset_loaded(void)
+{
+	length = 0;
+	loaded_count = 0;
+	memset(loaded, 0, sizeof(loaded));
+}
+
+/**
+ * @brief Set a trajectory setpoint.
+ *
+ * Setpoints may be loaded in any order. The trajectory length is the highest
+ * index set, plus one, and the indexes loaded are tracked, so a trajectory
+ * with missing setpoints (e.g.: a chunk lost) is never played. They are
+ * kept in the shared work area (see `workspace_claim()`): loading a new
+ * trajectory after another owner claimed it starts from an empty one.
+ *
+ * @param[in] index Control loop iteration, from the start of the trajectory.
+ * @param[in] setpoint Linear and angular speeds.
+ *
+ * @return Whether the index fits in the buffer.
+ */
+bool trajectory_set_setpoint(uint16_t index,
+			     struct trajectory_setpoint setpoint)
+{
+	if (index >= TRAJECTORY_MAX_SETPOINTS || playing)
+		return false;
+	if (!workspace_owned(WORKSPACE_TRAJECTORY)) {
+		setpoints = workspace_claim(WORKSPACE_TRAJECTORY);
+		reset_loaded();
+	}
+	setpoints[index] = setpoint;
+	if (!(loaded[index / 8] & (1 << (index % 8)))) {
+		loaded[index / 8] |= 1 << (index % 8);
+		loaded_count++;
+	}
+	if (index >= length)
+		length = index + 1;
+	return true;
+}
+
+/**
+ * @brief Get the number of setpoints of the trajectory loaded.
+ */
+uint16_t trajectory_length(void)
+{
+	if (!workspace_owned(WORKSPACE_TRAJECTORY))
+		return 0;
+	return length;
+}
+
+/**
+ * @brief Get the number of setpoints missing below the trajectory length.
+ */
+uint16_t trajectory_missing(void)
+{
+	if (!workspace_owned(WORKSPACE_TRAJECTORY))
+		return 0;
+	return length - loaded_count;
+}
+
+/**
+ * @brief Discard the trajectory loaded.
+ */
+void trajectory_clear(void)
+{
+	if (!playing)
+		reset_loaded();
+}
+
+/**
+ * @brief Play back the next setpoint of the trajectory, if playing.
+ *
+ * To be called from the SysTick handler, before the control loop, so each
+ * setpoint is followed for exactly one iteration. The speeds measured since
+ * the previous setpoint are compared with it to accumulate the tracking
+ * errors (see `tuning_metrics_update()`). The mouse is stopped after the last
+ * setpoint.
+ */
+void update_trajectory(void)
+{
+	if (!playing)
+		return;
+
+	if (played) {
+		tuning_metrics_update(&window, target_linear,
+				      get_measured_linear_speed(),
+				      target_angular,
+				      get_measured_angular_speed());
+		tuning_metrics_update(&total, target_linear,
+				      get_measured_linear_speed(),
+				      target_angular,
+				      get_measured_angular_speed());
+		if (window.ticks >= TRAJECTORY_LOG_TICKS) {
+			completed = window;
+			memset(&window, 0, sizeof(window));
+			completed_windows++;
+		}
+	}
+	if (played >= length) {
+		set_target_linear_speed(0.);
+		set_target_angular_speed(0.);
+		playing = false;
+		return;
+	}
+	target_linear = setpoints[played].linear / TRAJECTORY_SPEED_SCALE;
+	target_angular = setpoints[played].angular / TRAJECTORY_SPEED_SCALE;
+	set_target_linear_speed(target_linear);
+	set_target_angular_speed(target_angular);
+	played++;
+}
+
+/**
+ * @brief Log the tracking errors of a part of the trajectory.
+ *
+ * @param[in] tick Control loop iteration at the end of the part.
+ * @param[in] metrics Tracking errors accumulated.
+ */
+static void log_trajectory_tracking(uint32_t tick,
+				    struct tuning_metrics *metrics)
+{
+	if (!metrics->ticks)
+		return;
+	serial_wait_free_space(SERIAL_LOG_LINE_SIZE);
+	LOG_INFO("{\"tick\":%" PRIu32 ",\"linear_rms\":%.4f,"
+		 "\"angular_rms\":%.4f,\"overshoot\":%.4f}",
+		 tick, sqrtf(metrics->linear_squared / metrics->ticks),
+		 sqrtf(metrics->angular_squared / metrics->ticks),
+		 metrics->overshoot);
+}
+
+/**
+ * @brief Log the tracking errors of the whole trajectory.
+ */
+static void log_trajectory_result(bool collision)
+{
+	uint32_t ticks = total.ticks ? total.ticks : 1;
+
+	serial_wait_free_space(SERIAL_LOG_LINE_SIZE);
+	LOG_INFO("{\"setpoints\":%u,\"played\":%u,\"linear_rms\":%.4f,"
+		 "\"angular_rms\":%.4f,\"overshoot\":%.4f,\"collision\":%s}",
+		 length, played, sqrtf(total.linear_squared / ticks),
+		 sqrtf(total.angular_squared / ticks), total.overshoot,
+		 collision ? "true" : "false");
+}
+
+/**
+ * @brief Log the tracking errors of the last part completed, if not logged.
+ *
+ * @param[in,out] logged Parts completed when last logged.
+ */
+static void log_completed_tracking(uint32_t *logged)
+{
+	if (*logged == completed_windows)
+		return;
+	*logged = completed_windows;
+	log_trajectory_tracking(*logged * TRAJECTORY_LOG_TICKS, &completed);
+}
+
+/**
+ * @brief Play back the trajectory loaded from the starting position.
+ *
+ * The mouse waits for the user first (see `tuning_prepare_move()`). While the
+ * SysTick handler plays back the setpoints, the tracking errors are logged
+ * every `TRAJECTORY_LOG_TICKS` iterations, and a summary at the end. The
+ * playback is aborted on collisions. Trajectories with missing setpoints are
+ * refused.
+ */
+void trajectory_run(void)
+{
+	uint32_t logged = 0;
+	bool collision = false;
+
+	if (!trajectory_length()) {
+		LOG_ERROR("No trajectory loaded");
+		return;
+	}
+	if (trajectory_missing()) {
+		LOG_ERROR("Trajectory missing %u setpoints", trajectory_missing());
+		return;
+	}
+	tuning_prepare_move();
+	memset(&window, 0, sizeof(window));
+	memset(&total, 0, sizeof(total));
+	completed_windows = 0;
+	played = 0;
+	playing = true;
+	while (playing) {
+		if (collision_detected()) {
+			playing = false;
+			collision = true;
+		}
+		log_completed_tracking(&logged);
+	}
+	reset_motion();
+	log_completed_tracking(&logged);
+	log_trajectory_tracking(total.ticks, &window);
+	log_trajectory_result(collision);
+}
@@ -0,0 +1,48 @@
+#ifndef __TRAJECTORY_H
+#define __TRAJECTORY_H
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "mmlib/control.h"
+#include "mmlib/logging.h"
+
+#include "collision.h"
+#include "serial.h"
+#include "setup.h"
+#include "tuning.h"
+#include "workspace.h"
+
+/**
+ * Setpoints of a trajectory, one per control loop iteration, loaded through
+ * serial before playing it back. They live in the shared work area, so the
+ * buffer can be resized at build time as long as it fits in `WORKSPACE_SIZE`
+ * (`make TRAJECTORY_MAX_SETPOINTS=768`).
+ */
+#ifndef TRAJECTORY_MAX_SETPOINTS
+#define TRAJECTORY_MAX_SETPOINTS 512
+#endif
+
+/** Setpoints fixed point scale: millimeters and milliradians per second */
+#define TRAJECTORY_SPEED_SCALE 1000.
+
+/** Control loop iterations per tracking error log while playing back */
+#define TRAJECTORY_LOG_TICKS 50
+
+/** Linear and angular speeds, with `TRAJECTORY_SPEED_SCALE` */
+struct trajectory_setpoint {
+	int16_t linear;
+	int16_t angular;
+};
+
+bool trajectory_set_setpoint(uint16_t index,
+			     struct trajectory_setpoint setpoint);
+uint16_t trajectory_length(void);
+uint16_t trajectory_missing(void);
+void trajectory_clear(void);
+void update_trajectory(void);
+void trajectory_run(void);
+
+#endif /* __TRAJECTORY_H */
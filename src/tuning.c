@@ -0,0 +1,222 @@
+#include "tuning.h"
+
+#define CONTROL_PARAMETER(field)                                               \
+	{ #field, offsetof(struct tuning_variant, control.field) }
+
+/** Variant parameters settable by name, as in `tuning add` commands */
+static const struct tuning_parameter {
+	const char *name;
+	size_t offset;
+} parameters[] = {
+	CONTROL_PARAMETER(kp_linear),
+	CONTROL_PARAMETER(kd_linear),
+	CONTROL_PARAMETER(kp_angular),
+	CONTROL_PARAMETER(kd_angular),
+	CONTROL_PARAMETER(kp_angular_front),
+	CONTROL_PARAMETER(ki_angular_front),
+	CONTROL_PARAMETER(kp_angular_side),
+	CONTROL_PARAMETER(ki_angular_side),
+	CONTROL_PARAMETER(kp_angular_diagonal),
+	CONTROL_PARAMETER(ki_angular_diagonal),
+	{"linear_speed_limit",
+	 offsetof(struct tuning_variant, linear_speed_limit)},
+};
+
+static struct tuning_variant variants[TUNING_MAX_VARIANTS];
+static uint8_t variants_count;
+static struct tuning_metrics session_metrics;
+static volatile bool metrics_enabled;
+
+/**
+ * @brief Get the control constants and speed limit currently in use.
+ */
+struct tuning_variant tuning_current_variant(void)
+{
+	struct tuning_variant variant;
+
+	variant.control = get_control_constants();
+	variant.linear_speed_limit = get_linear_speed_limit();
+	return variant;
+}
+
+/**
+ * @brief Set a variant parameter by name.
+ *
+ * @param[out] variant Variant to modify.
+ * @param[in] name Parameter name, a `struct control_constants` field or
+ * `linear_speed_limit`.
+ * @param[in] value Parameter value.
+ *
+ * @return Whether the parameter exists.
+ */
+bool tuning_set_parameter(struct tuning_variant *variant, const char *name,
+			  float value)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(parameters) / sizeof(parameters[0]); i++) {
+		if (strcmp(name, parameters[i].name))
+			continue;
+		*(float *)((char *)variant + parameters[i].offset) = value;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Queue a variant for the next tuning session.
+ *
+ * @return Whether the variant was queued (i.e.: the queue was not full).
+ */
+bool tuning_add_variant(struct tuning_variant variant)
+{
+	if (variants_count >= TUNING_MAX_VARIANTS)
+		return false;
+	variants[variants_count++] = variant;
+	return true;
+}
+
+/**
+ * @brief Get the number of variants queued.
+ */
+uint8_t tuning_variants(void)
+{
+	return variants_count;
+}
+
+/**
+ * @brief Discard all the variants queued.
+ */
+void tuning_clear(void)
+{
+	variants_count = 0;
+}
+
+/**
+ * @brief Accumulate the tracking errors of a control loop iteration.
+ *
+ * Overshoot is the highest linear speed measured above the highest target
+ * speed reached so far, so the lag while accelerating does not count.
+ *
+ * @param[in,out] metrics Metrics to update.
+ * @param[in] target_linear Target linear speed, in meters per second.
+ * @param[in] measured_linear Measured linear speed, in meters per second.
+ * @param[in] target_angular Target angular speed, in radians per second.
+ * @param[in] measured_angular Measured angular speed, in radians per second.
+ */
+void tuning_metrics_update(struct tuning_metrics *metrics,
+			   float target_linear, float measured_linear,
+			   float target_angular, float measured_angular)
+{
+	float linear_error = measured_linear - target_linear;
+	float angular_error = measured_angular - target_angular;
+
+	metrics->ticks++;
+	metrics->linear_squared += linear_error * linear_error;
+	metrics->angular_squared += angular_error * angular_error;
+	if (target_linear > metrics->max_target_linear)
+		metrics->max_target_linear = target_linear;
+	if (measured_linear - metrics->max_target_linear > metrics->overshoot)
+		metrics->overshoot =
+		    measured_linear - metrics->max_target_linear;
+}
+
+/**
+ * @brief Update the tuning metrics while a variant runs the test move.
+ *
+ * To be called from the SysTick handler, after the control loop.
+ */
+void update_tuning_metrics(void)
+{
+	if (!metrics_enabled)
+		return;
+	tuning_metrics_update(&session_metrics, get_target_linear_speed(),
+			      get_measured_linear_speed(),
+			      get_target_angular_speed(),
+			      get_measured_angular_speed());
+}
+
+/**
+ * @brief Log a summary row with the variant tested and its metrics.
+ */
+static void log_tuning_result(uint8_t index, bool collision)
+{
+	struct tuning_variant *variant = &variants[index];
+	uint32_t ticks = session_metrics.ticks ? session_metrics.ticks : 1;
+
+	LOG_INFO("{\"variant\":%u,\"kp_linear\":%.4f,\"kd_linear\":%.4f,"
+		 "\"kp_angular\":%.4f,\"kd_angular\":%.4f,"
+		 "\"linear_speed_limit\":%.3f,\"linear_rms\":%.4f,"
+		 "\"angular_rms\":%.4f,\"overshoot\":%.4f,\"time\":%.3f,"
+		 "\"posts_correction\":%.4f,\"collision\":%s}",
+		 index, variant->control.kp_linear, variant->control.kd_linear,
+		 variant->control.kp_angular, variant->control.kd_angular,
+		 variant->linear_speed_limit,
+		 sqrtf(session_metrics.linear_squared / ticks),
+		 sqrtf(session_metrics.angular_squared / ticks),
+		 session_metrics.overshoot,
+		 (float)session_metrics.ticks / SYSTICK_FREQUENCY_HZ,
+		 get_wall_posts_correction(), collision ? "true" : "false");
+}
+
+/**
+ * @brief Wait for the user and get ready to move from the starting position.
+ *
+ * As before exploring, the mouse waits for the user to place it in the
+ * starting position and signal with the front sensors. It then waits for the
+ * gyroscope bias estimate to be ready (see `gyro_bias_ready()`) and the
+ * control loop is enabled, with walls control disabled.
+ */
+void tuning_prepare_move(void)
+{
+	reset_motion();
+	disable_walls_control();
+	wait_front_sensor_close_signal(0.12);
+	wait_gyro_bias_ready(2.);
+	calibrate();
+	reset_collision_detector();
+	enable_motor_control();
+	set_starting_position();
+}
+
+/**
+ * @brief Run the test move with every variant queued.
+ *
+ * Each variant moves `cells` cells straight from the starting position, turns
+ * right and stops in the middle of the next cell. Before each variant the
+ * mouse waits for the user to place it back in the starting position (see
+ * `tuning_prepare_move()`).
+ *
+ * The wall posts are looked for along the straight, so the odometry error they
+ * measure is reported with the metrics (see `get_wall_posts_correction()`).
+ * Only a summary row is logged for each variant (see `log_tuning_result()`).
+ * The control constants and speed limit in use are restored at the end.
+ *
+ * @param[in] cells Number of cells of the straight.
+ */
+void tuning_run(int cells)
+{
+	struct tuning_variant saved = tuning_current_variant();
+	bool collision;
+	uint8_t i;
+
+	for (i = 0; i < variants_count; i++) {
+		set_control_constants(variants[i].control);
+		set_linear_speed_limit(variants[i].linear_speed_limit);
+		tuning_prepare_move();
+		memset(&session_metrics, 0, sizeof(session_metrics));
+		metrics_enabled = true;
+		wall_posts_set_border(MOUSE_START_SHIFT);
+		move_front_many(cells);
+		wall_posts_disable();
+		move(RIGHT);
+		stop_middle();
+		metrics_enabled = false;
+
+		collision = collision_detected();
+		reset_motion();
+		log_tuning_result(i, collision);
+	}
+	set_control_constants(saved.control);
+	set_linear_speed_limit(saved.linear_speed_limit);
+}
@@ -0,0 +1,56 @@
+#ifndef __TUNING_H
+#define __TUNING_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "mmlib/calibration.h"
+#include "mmlib/clock.h"
+#include "mmlib/control.h"
+#include "mmlib/hmi.h"
+#include "mmlib/logging.h"
+#include "mmlib/move.h"
+
+#include "collision.h"
+#include "config.h"
+#include "gyro_bias.h"
+#include "setup.h"
+#include "wall_posts.h"
+
+/** Maximum number of variants queued in a tuning session */
+#define TUNING_MAX_VARIANTS 16
+
+/** Maximum number of cells of the tuning session straight */
+#define TUNING_MAX_CELLS 15
+
+/** Control constants and speed limit tested in a tuning session */
+struct tuning_variant {
+	struct control_constants control;
+	float linear_speed_limit;
+};
+
+/** Error metrics accumulated while a variant runs the test move */
+struct tuning_metrics {
+	uint32_t ticks;
+	float linear_squared;
+	float angular_squared;
+	float max_target_linear;
+	float overshoot;
+};
+
+struct tuning_variant tuning_current_variant(void);
+bool tuning_set_parameter(struct tuning_variant *variant, const char *name,
+			  float value);
+bool tuning_add_variant(struct tuning_variant variant);
+uint8_t tuning_variants(void);
+void tuning_clear(void);
+void tuning_metrics_update(struct tuning_metrics *metrics,
+			   float target_linear, float measured_linear,
+			   float target_angular, float measured_angular);
+void update_tuning_metrics(void);
+void tuning_prepare_move(void);
+void tuning_run(int cells);
+
+#endif /* __TUNING_H */
@@ -1,10 +1,40 @@
 #include "voltage.h"
 
+static volatile uint16_t samples[VOLTAGE_FILTER_SIZE];
+static volatile uint32_t samples_sum;
+static volatile uint8_t sample_index;
+static volatile bool sampled;
+
+/**
+ * @brief Add the latest battery conversion to the moving average.
+ *
+ * ADC2 converts continuously, so reading its data register never waits. To
+ * be called on each SysTick. The buffer is filled with the first sample, so
+ * the average is meaningful from the first call.
+ */
+void update_battery_voltage(void)
+{
+	uint16_t bits = adc_read_regular(ADC2);
+	uint8_t i;
+
+	if (!sampled) {
+		for (i = 0; i < VOLTAGE_FILTER_SIZE; i++)
+			samples[i] = bits;
+		samples_sum = bits * VOLTAGE_FILTER_SIZE;
+		sampled = true;
+		return;
+	}
+	samples_sum += bits - samples[sample_index];
+	samples[sample_index] = bits;
+	sample_index = (sample_index + 1) % VOLTAGE_FILTER_SIZE;
+}
+
 /**
  * @brief Function to get battery voltage.
  *
- * This function reads the voltage of the battery from the register configured
- * on the ADC2.
+ * This function returns the moving average of the last
+ * `VOLTAGE_FILTER_SIZE` battery readings (see `update_battery_voltage()`),
+ * or the latest ADC2 conversion if the SysTick has not sampled it yet.
  *
  * The value is converted from bits to voltage taking into account that the
  * battery voltage is read through a voltage divider.
@@ -13,23 +43,28 @@
  */
 float get_battery_voltage(void)
 {
-	uint16_t battery_bits;
-
-	adc_start_conversion_direct(ADC2);
-	while (!adc_eoc(ADC2))
-		;
-	battery_bits = adc_read_regular(ADC2);
-	return battery_bits * ADC_LSB * VOLT_DIV_FACTOR;
+	if (!sampled)
+		return adc_read_regular(ADC2) * ADC_LSB * VOLT_DIV_FACTOR;
+	return (float)samples_sum / VOLTAGE_FILTER_SIZE * ADC_LSB *
+	       VOLT_DIV_FACTOR;
 }
 
 /**
  * @brief Function to get motor driver input voltage.
  *
- * In Bulebule, we assume the motor driver input voltage is constant.
+ * In Bulebule, the motor driver is fed from a regulated supply, so we assume
+ * its input voltage is constant. When the motor driver is powered directly
+ * from the battery (`MOTOR_DRIVER_BATTERY_POWERED`), the filtered battery
+ * voltage is returned instead, so the PWM computed from it compensates the
+ * battery sag.
  *
  *@return The motor driver input voltage in volts.
  */
 float get_motor_driver_input_voltage(void)
 {
+#ifdef MOTOR_DRIVER_BATTERY_POWERED
+	return get_battery_voltage();
+#else
 	return MOTOR_DRIVER_INPUT_VOLTAGE;
+#endif
 }
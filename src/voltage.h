@@ -1,10 +1,18 @@
 #ifndef __VOLTAGE_H
 #define __VOLTAGE_H
 
+#ifndef MMSIM_SIMULATION
 #include <libopencm3/stm32/adc.h>
+#endif
+
+#include <stdbool.h>
 
 #include "setup.h"
 
+/** Battery readings averaged, one per SysTick */
+#define VOLTAGE_FILTER_SIZE 32
+
+void update_battery_voltage(void);
 float get_battery_voltage(void);
 float get_motor_driver_input_voltage(void);
 
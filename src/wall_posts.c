@@ -0,0 +1,248 @@
+#include "wall_posts.h"
+
+/**
+ * Falling edge detection state of a side sensor.
+ *
+ * - Consecutive readings of a parallel wall and the last one, in meters.
+ * - Last reading and the position where it was taken, in meters.
+ */
+struct wall_posts_side {
+	uint32_t wall_samples;
+	float wall_reading;
+	float last_reading;
+	float last_position;
+};
+
+static struct wall_posts_side sides[2];
+static uint32_t detected;
+
+#ifndef MMSIM_SIMULATION
+static volatile bool enabled;
+static float origin;
+static volatile float corrected;
+static uint32_t last_sequence;
+#endif
+
+/**
+ * @brief Reset the edge detection, when the readings are not continuous.
+ */
+void wall_posts_reset(void)
+{
+	memset(sides, 0, sizeof(sides));
+}
+
+/**
+ * @brief Update a side sensor edge detection with a new reading.
+ *
+ * The side sensors point diagonally forward, so they see the side wall ahead
+ * of the mouse. Where the wall ends, past the post (see
+ * `WALL_POSTS_EDGE_SHIFT`), the reading jumps to the distance of whatever is
+ * behind. The readings of the parallel wall, before they bend as the post
+ * face is seen, tell how far ahead the edge was, regardless of the lateral
+ * offset of the mouse.
+ *
+ * @param[in,out] side Side sensor state.
+ * @param[in] reading Side sensor reading, in meters along its axis.
+ * @param[in] position Forward position, in meters from a cell border.
+ * @param[out] correction Position error at the edge, if detected.
+ *
+ * @return Whether a falling edge was detected.
+ */
+static bool update_side(struct wall_posts_side *side, float reading,
+			float position, float *correction)
+{
+	float max_change =
+		WALL_POSTS_MAX_SLOPE * fabsf(position - side->last_position);
+	bool edge = side->wall_samples >= WALL_POSTS_MIN_SAMPLES &&
+		    reading > WALL_POSTS_WALL_DISTANCE &&
+		    reading > side->last_reading + WALL_POSTS_EDGE_JUMP;
+	float expected;
+	float error = 0.;
+
+	if (edge) {
+		expected = WALL_POSTS_EDGE_SHIFT - WALL_POSTS_SENSOR_SHIFT -
+			   side->wall_reading * cosf(WALL_POSTS_SENSOR_ANGLE);
+		expected += CELL_DIMENSION *
+			    roundf((side->last_position - expected) /
+				   CELL_DIMENSION);
+		error = expected - side->last_position;
+	}
+	if (reading >= WALL_POSTS_WALL_DISTANCE) {
+		side->wall_samples = 0;
+	} else if (fabsf(reading - side->last_reading) <= max_change) {
+		side->wall_samples++;
+		side->wall_reading = reading;
+	}
+	side->last_reading = reading;
+	side->last_position = position;
+	if (!edge || fabsf(error) > WALL_POSTS_MAX_CORRECTION)
+		return false;
+	*correction = error;
+	detected++;
+	return true;
+}
+
+/**
+ * @brief Look for wall posts with the latest side sensors readings.
+ *
+ * Odometry only measures the distance traveled, accumulating errors along
+ * straights, while the wall posts are on the cell borders. When the falling
+ * edge of a side reading is detected at a post, the position where the edge
+ * was expected, modulo the cell dimension, is compared with the odometry.
+ *
+ * To be called on each new sensors reading while moving straight, with the
+ * position measured from a cell border. Readings from both sides may correct
+ * the position on the same tick, in which case the corrections accumulate.
+ *
+ * @param[in] side_left Left side sensor reading, in meters.
+ * @param[in] side_right Right side sensor reading, in meters.
+ * @param[in] position Forward position, in meters from a cell border.
+ * @param[out] correction Distance to add to the position, if detected.
+ *
+ * @return Whether a wall post was detected.
+ */
+bool wall_posts_update(float side_left, float side_right, float position,
+		       float *correction)
+{
+	float left = 0.;
+	float right = 0.;
+	bool found;
+
+	found = update_side(&sides[0], side_left, position, &left);
+	found |= update_side(&sides[1], side_right, position, &right);
+	if (found)
+		*correction = left + right;
+	return found;
+}
+
+/**
+ * @brief Number of wall posts used to correct the position since startup.
+ */
+uint32_t wall_posts_detected(void)
+{
+	return detected;
+}
+
+#ifndef MMSIM_SIMULATION
+/**
+ * @brief Forward distance traveled according to the encoders, in meters.
+ */
+static float odometry(void)
+{
+	return (get_encoder_left_count() + get_encoder_right_count()) / 2. *
+	       get_micrometers_per_count() / MICROMETERS_PER_METER;
+}
+
+/**
+ * @brief Forward position from the border when a snapshot was completed.
+ *
+ * The encoders are only read on each SysTick, so the position is moved back
+ * with the current speed by the time elapsed since the snapshot.
+ */
+static float snapshot_position(const struct sensors_snapshot *snapshot)
+{
+	float speed =
+		(get_encoder_left_speed() + get_encoder_right_speed()) / 2.;
+	uint32_t elapsed = read_cycle_counter() - snapshot->timestamp;
+
+	return get_wall_posts_position() -
+	       speed * elapsed / SYSCLK_FREQUENCY_HZ;
+}
+
+/**
+ * @brief Look for wall posts with the sensors snapshots published since the
+ * last call.
+ *
+ * To be called on each SysTick, after updating the encoders. Disabled by
+ * default: nothing is done until `wall_posts_set_border()` is called.
+ *
+ * More than one snapshot is published per SysTick, and the SysTick and the
+ * sensors sweep run at a fixed phase, so the newest snapshot alone could
+ * always be a front sensors half sweep. The history is walked from the last
+ * snapshot processed, oldest first, and only snapshots with fresh side
+ * readings are processed, as side readings carried over while the front
+ * sensors are scheduled would count as extra `WALL_POSTS_MIN_SAMPLES`.
+ */
+void update_wall_posts(void)
+{
+	const uint8_t side_sensors =
+		(1 << SENSOR_SIDE_LEFT_ID) | (1 << SENSOR_SIDE_RIGHT_ID);
+	struct sensors_snapshot history[WALL_POSTS_HISTORY];
+	struct sensors_snapshot *snapshot;
+	float correction;
+	float left;
+	float right;
+	uint8_t count;
+
+	if (!enabled)
+		return;
+	count = get_sensors_history(history, WALL_POSTS_HISTORY);
+	while (count--) {
+		snapshot = &history[count];
+		if ((int32_t)(snapshot->sequence - last_sequence) <= 0)
+			continue;
+		last_sequence = snapshot->sequence;
+		if ((snapshot->fresh & side_sensors) != side_sensors)
+			continue;
+		left = sensors_distance(SENSOR_SIDE_LEFT_ID,
+					snapshot->on[SENSOR_SIDE_LEFT_ID],
+					snapshot->off[SENSOR_SIDE_LEFT_ID]);
+		right = sensors_distance(SENSOR_SIDE_RIGHT_ID,
+					 snapshot->on[SENSOR_SIDE_RIGHT_ID],
+					 snapshot->off[SENSOR_SIDE_RIGHT_ID]);
+		if (wall_posts_update(left, right, snapshot_position(snapshot),
+				      &correction))
+			corrected += correction;
+	}
+}
+
+/**
+ * @brief Start correcting the position, from a known position in the cell.
+ *
+ * To be called by the move code when starting a straight move, with the
+ * mouse center on a cell border or, from the starting position, at
+ * `MOUSE_START_SHIFT` past it. Any later border is a whole number of cells
+ * ahead. Snapshots taken before the call are ignored.
+ *
+ * @param[in] position Forward position of the mouse center, in meters from
+ * the cell border behind it.
+ */
+void wall_posts_set_border(float position)
+{
+	enabled = false;
+	wall_posts_reset();
+	origin = odometry() - position;
+	corrected = 0.;
+	last_sequence = get_sensors_sequence();
+	enabled = true;
+}
+
+/**
+ * @brief Stop correcting the position (e.g.: before turning).
+ */
+void wall_posts_disable(void)
+{
+	enabled = false;
+}
+
+/**
+ * @brief Forward position from the border, corrected at the wall posts.
+ *
+ * The position the move code should rely on, instead of the encoders
+ * distance, to end straight moves at the cell borders, while enabled.
+ */
+float get_wall_posts_position(void)
+{
+	return odometry() - origin + corrected;
+}
+
+/**
+ * @brief Total correction applied at the wall posts since enabled.
+ *
+ * The odometry error measured along the straight move, in meters.
+ */
+float get_wall_posts_correction(void)
+{
+	return corrected;
+}
+#endif
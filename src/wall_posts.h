@@ -0,0 +1,67 @@
+#ifndef __WALL_POSTS_H
+#define __WALL_POSTS_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "setup.h"
+
+#ifndef MMSIM_SIMULATION
+#include "config.h"
+#include "detection.h"
+#include "encoders.h"
+#include "platform.h"
+#endif
+
+/**
+ * Side sensors position: distance they are mounted ahead of the mouse center,
+ * in meters, and angle of their axis from the heading, in radians.
+ */
+#define WALL_POSTS_SENSOR_SHIFT 0.03
+#define WALL_POSTS_SENSOR_ANGLE (PI / 4.)
+
+/**
+ * Forward position of the falling edges on the side walls surface, from the
+ * cell border, in meters. The post corner is half a wall width beyond the
+ * border, but the emitter beam is not a ray, so readings fall earlier. To be
+ * calibrated on the maze (the simulator sees the edges on the border).
+ */
+#define WALL_POSTS_EDGE_SHIFT 0.
+
+/** Side readings considered a wall, in meters along the sensor axis */
+#define WALL_POSTS_WALL_DISTANCE 0.15
+
+/**
+ * Maximum side reading change per meter traveled for a wall to be considered
+ * parallel, as the readings bend when the post face is seen
+ */
+#define WALL_POSTS_MAX_SLOPE 0.5
+
+/** Consecutive parallel wall readings needed before a falling edge */
+#define WALL_POSTS_MIN_SAMPLES 10
+
+/** Minimum reading increase of a falling edge, in meters */
+#define WALL_POSTS_EDGE_JUMP 0.04
+
+/** Larger position errors are discarded as false edges, in meters */
+#define WALL_POSTS_MAX_CORRECTION 0.04
+
+/**
+ * Snapshots read back on each SysTick, more than the half sweeps completed
+ * per SysTick (see `update_wall_posts()`)
+ */
+#define WALL_POSTS_HISTORY 4
+
+void wall_posts_reset(void);
+bool wall_posts_update(float side_left, float side_right, float position,
+		       float *correction);
+uint32_t wall_posts_detected(void);
+void update_wall_posts(void);
+void wall_posts_set_border(float position);
+void wall_posts_disable(void);
+float get_wall_posts_position(void);
+float get_wall_posts_correction(void);
+
+#endif /* __WALL_POSTS_H */
@@ -0,0 +1,31 @@
+#include "workspace.h"
+
+static uint32_t area[WORKSPACE_SIZE / sizeof(uint32_t)];
+static volatile enum workspace_owner current;
+
+/**
+ * @brief Claim the shared work area.
+ *
+ * The area is word aligned, so it can be cast to any structure or array that
+ * fits in `WORKSPACE_SIZE` bytes. Its contents are left as the previous owner
+ * left them.
+ *
+ * @param[in] owner New owner of the area.
+ *
+ * @return Start of the area.
+ */
+void *workspace_claim(enum workspace_owner owner)
+{
+	current = owner;
+	return area;
+}
+
+/**
+ * @brief Whether the shared work area is still owned by a given owner.
+ *
+ * @param[in] owner Owner to check.
+ */
+bool workspace_owned(enum workspace_owner owner)
+{
+	return current == owner;
+}
@@ -0,0 +1,31 @@
+#ifndef __WORKSPACE_H
+#define __WORKSPACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Shared work area, in bytes, for the large buffers that are never used at
+ * the same time: the telemetry recorder, the trajectory setpoints and the
+ * on-board benchmarks. It can be resized at build time
+ * (`make WORKSPACE_SIZE=4096`).
+ */
+#ifndef WORKSPACE_SIZE
+#define WORKSPACE_SIZE 3072
+#endif
+
+/**
+ * Work area owners. Claiming the area invalidates the contents of the
+ * previous owner.
+ */
+enum workspace_owner {
+	WORKSPACE_NONE = 0,
+	WORKSPACE_RECORDER = 1,
+	WORKSPACE_TRAJECTORY = 2,
+	WORKSPACE_BENCHMARK = 3,
+};
+
+void *workspace_claim(enum workspace_owner owner);
+bool workspace_owned(enum workspace_owner owner);
+
+#endif /* __WORKSPACE_H */